@@ -0,0 +1,56 @@
+#include "lexer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Lexer throughput in MB/s over a generated source of a few megabytes, a mix of declarations,
+// operators, string literals and comments like the programs in test/.
+static std::string generate(size_t bytes, const std::string &header = "", const std::string &fin = "fin") {
+    std::string source = header + "import \"outstream\";\n";
+    for (size_t i = 0; source.size() < bytes; ++i) {
+        std::string n = std::to_string(i);
+        source += fin + " step" + n + "(int a, string label) -> int {\n"
+                  "    int total = a * " + n + " + (a % 7) - 3;\n"
+                  "    for (int j = 0; j < total; j++) { total += j; }\n"
+                  "    if (total >= 100 && label == \"x\") return total / 2;\n"
+                  "    int[] values = [1, 2, 3, " + n + "];\n"
+                  "    println(label + \" \" + values[0..2]); // trailing comment\n"
+                  "    return values.length;\n"
+                  "}\n";
+    }
+    return source;
+}
+
+// streamed pulls the tokens one at a time through a TokenStream, the way the parser reads them
+static void measure(const char *name, const std::string &source, bool streamed = false) {
+    const int runs = 5;
+    double best = 0;
+    size_t tokens = 0;
+    for (int run = 0; run < runs; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        if (streamed) {
+            TokenStream stream(source);
+            for (tokens = 1; stream.consume().type != Token::Type::END_OF_FILE; ++tokens) {}
+        } else {
+            Lexer lexer(source);
+            tokens = lexer.tokenize().size();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::max(best, source.size() / elapsed.count() / (1 << 20));
+    }
+    std::printf("%s: %.1f MB source, %zu tokens, %.1f MB/s\n", name, source.size() / double(1 << 20), tokens, best);
+}
+
+int main(int argc, char *argv[]) {
+    const size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 8;
+    const std::string source = generate(megabytes << 20);
+    measure("lexer", source);
+    measure("lexer streamed", source, true);
+
+    // 50 #alias headers over a 1 MB source, one of them used for every fin
+    std::string header;
+    for (int i = 0; i < 49; ++i) header += "#alias \"alias" + std::to_string(i) + "\" as \"value" + std::to_string(i) + "\"\n";
+    header += "#alias \"fn\" as \"fin\"\n";
+    measure("lexer with 50 aliases", generate(1 << 20, header, "fn"));
+    return 0;
+}
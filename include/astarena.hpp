@@ -0,0 +1,96 @@
+#ifndef ASTARENA_HPP
+#define ASTARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator a whole AST is built in, so parsing or unlumping a program does not go to the heap
+// for every node and child list, and freeing them only counts down. The chunks go back to the heap
+// at once when the last allocation made from the arena is freed, so nodes that outlive the tree
+// they came from keep it all alive instead of dangling.
+class ASTArena {
+public:
+    // While a Scope is alive, the nodes and child lists made on this thread come from a new arena.
+    class Scope {
+    public:
+        Scope() : arena(new ASTArena), previous(current) { current = arena; }
+        ~Scope() {
+            current = previous;
+            arena->release();
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        ASTArena *arena;
+        ASTArena *previous;
+    };
+
+    static ASTArena *active() { return current; }
+
+    void *allocate(size_t bytes, size_t align) {
+        uintptr_t at = (reinterpret_cast<uintptr_t>(next) + align - 1) & ~(align - 1);
+        if (!next || at + bytes > reinterpret_cast<uintptr_t>(end)) {
+            grow(bytes + align);
+            at = (reinterpret_cast<uintptr_t>(next) + align - 1) & ~(align - 1);
+        }
+        next = reinterpret_cast<std::byte *>(at + bytes);
+        live++;
+        return reinterpret_cast<void *>(at);
+    }
+
+    void release() {
+        if (--live == 0) delete this;
+    }
+
+private:
+    static constexpr size_t CHUNK_SIZE = 64 << 10;
+    inline static thread_local ASTArena *current = nullptr;
+
+    std::vector<std::unique_ptr<std::byte[]>> chunks;
+    std::byte *next = nullptr;
+    std::byte *end = nullptr;
+    size_t live = 1; // allocations not freed yet, plus one for the Scope
+
+    ASTArena() = default;
+
+    void grow(size_t bytes) {
+        size_t size = bytes > CHUNK_SIZE ? bytes : CHUNK_SIZE;
+        next = chunks.emplace_back(new std::byte[size]).get();
+        end = next + size;
+    }
+};
+
+// Allocates from the arena active when it was made, or the heap outside any Scope. Copies of a
+// container go to the heap, since they may outlive every node of the arena.
+template <typename T>
+struct ASTAllocator {
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ASTArena *arena = ASTArena::active();
+
+    ASTAllocator() = default;
+    explicit ASTAllocator(ASTArena *arena) : arena(arena) {}
+    template <typename U>
+    ASTAllocator(const ASTAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) {
+        if (!arena) return std::allocator<T>().allocate(n);
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *p, size_t n) {
+        if (!arena) return std::allocator<T>().deallocate(p, n);
+        arena->release();
+    }
+
+    ASTAllocator select_on_container_copy_construction() const { return ASTAllocator(nullptr); }
+
+    template <typename U>
+    bool operator==(const ASTAllocator<U> &other) const { return arena == other.arena; }
+};
+
+#endif
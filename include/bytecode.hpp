@@ -0,0 +1,117 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include "executor.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Register based instruction set used by the VM engine.
+// R[x] is a register of the current frame, K[x] a constant of the current proto.
+enum class Op : uint8_t {
+    MOVE,           // R[a] = R[b]
+    LOADK,          // R[a] = K[b]
+    LOADI,          // R[a] = int(sx)
+    LOADNIL,        // R[a] = nil
+
+    GETGLOBAL,      // R[a] = env[names[b]]
+    SETGLOBAL,      // env.modify(names[b], R[a])
+    DEFGLOBAL,      // env.set(names[b], R[a])
+
+    ARITH,          // R[a] = R[b] <BinaryOp(sx)> R[c], dynamically typed
+    UNARY,          // R[a] = <BinaryOp(sx)> R[b], dynamically typed
+
+    ADDI,           // R[a] = R[b] + R[c], both known to be int
+    SUBI,
+    MULI,
+    DIVI,
+    MODI,
+    EQI,
+    LTI,
+    GTI,
+    LEI,
+    GEI,
+    ADDKI,          // R[a] = R[b] + sx, R[b] known to be int
+
+    JMP,            // pc += sx
+    JMPF,           // if !R[a] then pc += sx
+    JEQI,           // if R[a] == R[b] then pc += sx, both known to be int
+    JNEI,
+    JLTI,
+    JLEI,
+    JGTI,
+    JGEI,
+
+    CHECKTYPE,      // assert R[a] matches types[b]
+    CHECKSAME,      // assert R[b] has the type of R[a], names[c] is the field name if any
+
+    NEWARRAY,       // R[a] = [], element type Primitive(b)
+    APPEND,         // R[a].push(R[b])
+    APPENDRANGE,    // R[a].push(R[b]..R[c])
+    NEWSIZED,       // R[a] = Primitive(c)[R[b]]
+    INDEX,          // R[a] = R[b][R[c]]
+    INDEXN,         // R[a] = R[b][indices in R[c]]
+    SETINDEX,       // R[a][R[b]] = R[c]
+    SETINDEXN,      // R[a][indices in R[b]] = R[c]
+    ITERCHECK,      // assert R[a] is an array
+    LEN,            // R[a] = R[b].length
+
+    GETPROP,        // R[a] = R[b].names[c]
+    GETFIELD,       // R[a] = R[b].names[c], R[b] must be a struct
+    SETFIELD,       // R[a].names[b] = R[c]
+
+    NEWSTRUCT,      // R[a] = structInits[c]{ R[b] .. }
+    DEFSTRUCT,      // env.setType(structs[a])
+
+    CLOSURE,        // R[a] = protos[b] bound to the current env
+    NATIVE,         // R[a] = natives[b] linked against the current env
+    CALL,           // R[a] = R[b](R[b + 1] .. R[b + c])
+    RET,            // return R[a]
+    RETNIL,         // return nil
+
+    NDPUSH,         // R[a].push(R[b] or R[b][R[c] % len])
+    NDSTEP,         // advance index array R[a] through shape R[b]
+
+    ERROR,          // throw K[b]
+};
+
+struct Instr {
+    Op op;
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint16_t c = 0;
+    int32_t sx = 0;
+};
+
+struct StructInit {
+    std::string structName;
+    Symbol structSymbol;
+    std::vector<std::string> argNames; // empty for positional arguments
+};
+
+struct NativeDecl {
+    std::string name;
+    FunctionData funcData;
+};
+
+struct Proto {
+    std::string name;
+    std::vector<Instr> code;
+
+    std::vector<TypedValue> constants;
+    std::vector<std::string> names;
+    std::vector<Symbol> symbols; // names interned, at the same indices
+    std::vector<Type> types;
+    std::vector<std::shared_ptr<Proto>> protos;
+    std::vector<std::shared_ptr<StructType>> structs;
+    std::vector<StructInit> structInits;
+    std::vector<NativeDecl> natives;
+
+    FunctionData signature;
+    uint16_t maxRegs = 0;
+};
+
+std::string disassemble(const Proto &proto, int indent = 0);
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef CLOSURE_HPP
+#define CLOSURE_HPP
+
+#include "executor.hpp"
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Closure compiled engine: the AST is walked once and turned into a tree of
+// specialized callables, so running it never switches on node types or reparses strValue.
+
+struct Frame {
+    TypedValue *slots;
+    ENV env;
+    TypedValue ret;
+};
+
+using Expr = std::function<TypedValue(Frame &)>;
+using Cond = std::function<bool(Frame &)>;
+using Stmt = std::function<bool(Frame &)>; // true once a return statement ran
+
+struct CompiledProto {
+    std::string name;
+    FunctionData signature; // null for modules
+    Stmt body;
+    uint16_t slotCount = 0;
+};
+
+struct CompiledClosure {
+    std::shared_ptr<CompiledProto> proto;
+    ENV env;
+};
+
+class ClosureEngine;
+
+class ClosureCompiler {
+public:
+    ClosureCompiler(ClosureEngine &engine, Executor &executor) : engine(engine), executor(executor) {}
+
+    std::shared_ptr<CompiledProto> compileModule(const std::shared_ptr<ASTNode> &pragma);
+
+private:
+    struct Local {
+        std::string name;
+        uint16_t slot;
+        StaticType type;
+    };
+
+    struct FuncState {
+        std::shared_ptr<CompiledProto> proto;
+        FuncState *enclosing = nullptr;
+        std::vector<Local> locals;
+        std::vector<std::pair<size_t, uint16_t>> scopes;
+        std::vector<std::pair<uint16_t, StaticType>> selfRefs;
+        uint16_t nextSlot = 0;
+        int blockDepth = 0;
+        bool isModule = false;
+    };
+
+    // an expression together with what is known about where its value comes from
+    struct Operand {
+        Expr eval;
+        StaticType type = StaticType::Unknown;
+        std::optional<uint16_t> slot;
+        std::optional<int> constant;
+    };
+
+    ClosureEngine &engine;
+    Executor &executor;
+    FuncState *fs = nullptr;
+
+    uint16_t allocSlot();
+    uint16_t floor() const;
+    void beginScope();
+    void endScope();
+    const Local *resolveLocal(const std::string &ident) const;
+    bool capturesLocal(const std::string &ident) const;
+    bool definesGlobal() const;
+    void define(const std::string &ident, uint16_t slot, StaticType type);
+    Expr store(const std::string &ident, std::optional<uint16_t> slot, Expr value);
+
+    Stmt statement(const std::shared_ptr<ASTNode> &node);
+    Stmt block(const ASTChildren &nodes);
+    Stmt ifStatement(const std::shared_ptr<ASTNode> &node);
+    Stmt whileStatement(const std::shared_ptr<ASTNode> &node);
+    Stmt forStatement(const std::shared_ptr<ASTNode> &node);
+    Stmt function(const std::shared_ptr<ASTNode> &node);
+    Stmt nativeStatement(const std::shared_ptr<ASTNode> &node);
+    Stmt structDeclaration(const std::shared_ptr<ASTNode> &node);
+
+    Expr assignment(const std::shared_ptr<ASTNode> &node, StaticType &type);
+    Expr structAssignment(const std::shared_ptr<ASTNode> &node);
+    Expr ndarrayAssignment(const std::shared_ptr<ASTNode> &node);
+    Cond condition(const std::shared_ptr<ASTNode> &node);
+
+    Operand operand(const std::shared_ptr<ASTNode> &node);
+    Expr expr(const std::shared_ptr<ASTNode> &node, StaticType &type);
+    Expr expr(const std::shared_ptr<ASTNode> &node);
+    Expr binaryOp(const std::shared_ptr<ASTNode> &node, StaticType &type);
+    Expr call(const std::shared_ptr<ASTNode> &node);
+    Expr arrayLiteral(const std::shared_ptr<ASTNode> &node);
+    std::function<std::vector<int>(Frame &)> indices(const std::shared_ptr<ASTNode> &indicesNode);
+};
+
+class ClosureEngine {
+public:
+    explicit ClosureEngine(std::shared_ptr<ASTNode> root);
+    TypedValue run();
+
+    PFunction makeClosure(const std::shared_ptr<CompiledProto> &proto, ENV env);
+    TypedValue call(const CompiledClosure &closure, const std::vector<std::shared_ptr<TypedValue>> &args);
+    TypedValue call(const CompiledClosure &closure, Frame &caller, const std::vector<Expr> &args);
+
+private:
+    std::shared_ptr<ASTNode> root;
+    Executor executor;
+    ClosureCompiler compiler;
+    ENV globalEnv;
+
+    std::unordered_map<std::string, std::shared_ptr<ASTNode>> pragmas;
+    std::unordered_map<std::string, std::shared_ptr<CompiledProto>> modules;
+    std::unordered_map<std::string, PExportData> exportData;
+    std::vector<std::string> handlingModules;
+
+    void executePragma(const std::shared_ptr<ASTNode> &node, ENV env);
+    void handleImports(const ASTChildren &children, ENV env);
+    TypedValue invoke(const CompiledProto &proto, ENV env, TypedValue *slots, size_t argc);
+};
+
+#endif
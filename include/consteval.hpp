@@ -0,0 +1,38 @@
+#ifndef CONSTEVAL_HPP
+#define CONSTEVAL_HPP
+
+#include "optimizerutils.hpp"
+#include "parser.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Runs the calls to `const fin`s whose arguments are all literals, and the NDArray initializers that
+// call them, in the Executor before the program is lumped, and puts the value in their place as a
+// literal or array literal, so tables they build ship precomputed in the .lmp.
+// Each runs in a program of nothing but the structs and const fins of the fin's module, under a limit
+// on calls, loop iterations and call depth. A fin that reads anything else, prints, fails or goes past
+// the limit is left to run as usual, as is one returning a struct.
+// `const` asks for this itself, so it runs at every optimization level, -O0 included.
+class ConstEvaluator {
+public:
+    void evaluate(const std::shared_ptr<ASTNode> &root);
+
+private:
+    struct Module : ModuleInfo<Module> {
+        std::unordered_map<Symbol, std::shared_ptr<ASTNode>> fins; // const fins the module's name resolves to
+    };
+
+    std::unordered_map<std::string, Module> modules; // by file
+    std::unordered_map<std::string, std::shared_ptr<ASTNode>> results; // by module, callee and arguments
+
+    void visit(std::shared_ptr<ASTNode> &node, const Module &module);
+    std::pair<const ASTNode *, const Module *> resolve(const ASTNode &callee, const Module &module) const;
+    std::shared_ptr<ASTNode> call(const ASTNode &call, const Module &module);
+    std::shared_ptr<ASTNode> table(const ASTNode &ndarray, const Module &module);
+    bool constant(const ASTNode &expr, const Module &module, bool &calls) const;
+    std::shared_ptr<ASTNode> run(const Module &module, const std::shared_ptr<ASTNode> &statement);
+};
+
+#endif
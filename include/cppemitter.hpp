@@ -0,0 +1,106 @@
+#ifndef CPPEMITTER_HPP
+#define CPPEMITTER_HPP
+
+#include "executor.hpp"
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Ahead of time backend: translates a program and every pragma it imports into one C++ translation
+// unit that links against runtime/lumin_runtime. Types come from declarations and signatures, so
+// structs become C++ structs and arrays lumin::Array<T>, and type errors are reported while emitting.
+class CppEmitter {
+public:
+    explicit CppEmitter(std::shared_ptr<ASTNode> root);
+    std::string emit();
+
+private:
+    struct Value {
+        std::string code;
+        Type type;
+    };
+
+    struct Module {
+        std::shared_ptr<ASTNode> pragma;
+        std::string ns;
+        std::vector<std::string> imports; // pragma names of .lum imports
+        std::unordered_map<std::string, std::string> aliases;
+        bool outstream = false, filestream = false;
+        std::unordered_map<std::string, FunctionData> functions;
+        std::vector<std::shared_ptr<ASTNode>> functionNodes;
+        std::unordered_map<std::string, Type> globals;
+        std::vector<std::string> globalOrder;
+        std::vector<std::string> structs;
+        std::vector<std::string> exports;
+    };
+
+    // A fin declared inside a fin or block, emitted as a std::function in the scope it is declared in.
+    struct LocalFunction {
+        size_t depth; // scopes.size() where it was declared
+        std::string name;
+        FunctionData data;
+    };
+
+    struct StructInfo {
+        std::shared_ptr<StructType> type;
+        std::string cppName;
+    };
+
+    std::shared_ptr<ASTNode> root;
+    Executor executor;
+    std::vector<Module> modules;
+    std::unordered_map<std::string, size_t> moduleIndex;
+    std::unordered_map<std::string, StructInfo> structs;
+
+    Module *module = nullptr;
+    const _FunctionData *function = nullptr; // null while emitting module level code
+    std::vector<std::unordered_map<std::string, Type>> scopes;
+    std::vector<LocalFunction> localFunctions;
+    std::vector<Value> selfRefs;
+    std::ostringstream *out = nullptr;
+    int indent = 0;
+    int temps = 0;
+
+    [[noreturn]] static void fail(const std::string &msg);
+    void line(const std::string &text);
+    std::string temp();
+
+    void collect(Module &mod);
+    void order(size_t index, std::vector<size_t> &result, std::vector<int> &state);
+    void emitModule(std::ostringstream &code, Module &mod);
+    void emitFunction(std::ostringstream &code, const std::shared_ptr<ASTNode> &node);
+    void emitLocalFunction(const std::shared_ptr<ASTNode> &node);
+    void functionBody(const _FunctionData &fn);
+
+    std::string cppType(const Type &type) const;
+    std::string signature(const std::string &name, const _FunctionData &fn) const;
+    const StructInfo &structInfo(const std::string &name) const;
+
+    void statement(const std::shared_ptr<ASTNode> &node);
+    void body(const std::shared_ptr<ASTNode> &node);
+    void popScopes(size_t depth);
+    void declare(const std::string &ident, const Value &value, const std::shared_ptr<ASTNode> &valueNode);
+
+    Value expr(const std::shared_ptr<ASTNode> &node);
+    Value declaration(const std::shared_ptr<ASTNode> &node);
+    Value structAssignment(const std::shared_ptr<ASTNode> &node);
+    Value ndarrayAssignment(const std::shared_ptr<ASTNode> &node);
+    Value assignment(const std::shared_ptr<ASTNode> &node);
+    Value binaryOp(const std::shared_ptr<ASTNode> &node);
+    Value call(const std::shared_ptr<ASTNode> &node);
+    Value userCall(const _FunctionData &fn, const std::string &cppName, const std::shared_ptr<ASTNode> &node);
+    Value nativeCall(const std::string &name, const std::shared_ptr<ASTNode> &node);
+    Value read(const std::shared_ptr<ASTNode> &node);
+    Value arrayLiteral(const std::shared_ptr<ASTNode> &node);
+    std::string indices(const std::shared_ptr<ASTNode> &indicesNode);
+    std::string condition(const std::shared_ptr<ASTNode> &node);
+
+    const Type *lookup(const std::string &ident) const;
+    const _FunctionData *localFunction(const std::string &name) const;
+    const Module *importedModule(const std::shared_ptr<ASTNode> &node) const;
+    std::string bind(Value &value, std::string &prelude);
+};
+
+#endif
@@ -16,106 +16,301 @@
 #include <any>
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <type_traits>
 
 enum class BaseType { Int, Bool, String, Array, Function, Struct, ExportData, NIL };
 
+// What a compiling engine knows about a value's type ahead of running it.
+enum class StaticType : uint8_t { Unknown, Int, Bool, String };
+
 struct StructType;
 struct Struct;
 struct Function;
 struct ExportData;
 struct TypedValue;
-struct Type;
+class Type;
 struct Array;
+struct VMClosure;
+struct CompiledClosure;
+struct _FunctionData;
+class Environment;
+class Jit;
 
-struct Type {
+// Interned description of a type. Each distinct type exists once in the type table, so two Types
+// are the same type exactly when they point at the same descriptor.
+struct TypeInfo {
     BaseType kind;
-    std::string customName;
-    std::shared_ptr<Type> elementType;
+    std::string customName{}; // struct name, empty for every other kind
+    const TypeInfo *element = nullptr; // set for array<T>, the bare array type has none
+    mutable const TypeInfo *arrayOf = nullptr; // array<this>, created the first time it is asked for
+};
+
+class TypeTable {
+public:
+    static const TypeInfo *base(BaseType kind) {
+        static const TypeInfo bases[] = {
+            {BaseType::Int}, {BaseType::Bool}, {BaseType::String}, {BaseType::Array},
+            {BaseType::Function}, {BaseType::Struct}, {BaseType::ExportData}, {BaseType::NIL},
+        };
+        return &bases[static_cast<size_t>(kind)];
+    }
+
+    static const TypeInfo *named(const std::string &name) {
+        auto &structs = instance().structs;
+        auto it = structs.find(name);
+        if (it == structs.end())
+            it = structs.emplace(name, std::make_unique<TypeInfo>(TypeInfo{BaseType::Struct, name})).first;
+        return it->second.get();
+    }
+
+    static const TypeInfo *arrayOf(const TypeInfo *element) {
+        if (!element->arrayOf) {
+            auto &arrays = instance().arrays;
+            arrays.push_back(std::make_unique<TypeInfo>(TypeInfo{BaseType::Array, "", element}));
+            element->arrayOf = arrays.back().get();
+        }
+        return element->arrayOf;
+    }
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<TypeInfo>> structs;
+    std::vector<std::unique_ptr<TypeInfo>> arrays;
 
-    Type() : kind(BaseType::NIL) {}
-    Type(BaseType base) : kind(base) {}
-    Type(const std::string &name) : kind(BaseType::Struct), customName(name) {}
+    static TypeTable &instance() {
+        static TypeTable table;
+        return table;
+    }
+};
+
+// Handle to an interned TypeInfo, cheap to copy and compare.
+class Type {
+public:
+    Type() : info(TypeTable::base(BaseType::NIL)) {}
+    Type(BaseType base) : info(TypeTable::base(base)) {}
+    Type(const std::string &name) : info(TypeTable::named(name)) {}
     Type(Primitive prim) {
         switch (prim) {
-            case Primitive::INT: kind = BaseType::Int; break;
-            case Primitive::BOOL: kind = BaseType::Bool; break;
-            case Primitive::STRING: kind = BaseType::String; break;
+            case Primitive::INT: info = TypeTable::base(BaseType::Int); break;
+            case Primitive::BOOL: info = TypeTable::base(BaseType::Bool); break;
+            case Primitive::STRING: info = TypeTable::base(BaseType::String); break;
             default: throw std::runtime_error("Invalid primitive type - " + std::to_string(static_cast<int>(prim)));
         }
     }
 
+    BaseType kind() const { return info->kind; }
+    const std::string &name() const { return info->customName; }
+    bool hasElement() const { return info->element != nullptr; }
+    Type element() const { return info->element ? Type(info->element) : Type(); }
+
     bool match(BaseType base) const {
-        return kind == base;
+        return info->kind == base;
     }
 
+    // the bare array type stands for an array of unknown elements and matches nothing, itself included
     bool match(const Type &other) const {
-        if (kind != other.kind) return false;
-        if (kind == BaseType::Struct) return customName == other.customName;
-        if (kind == BaseType::Array) {
-            if (!elementType || !other.elementType) return false;
-            return elementType->match(*other.elementType);
-        }
-        return true;
+        return info == other.info && (info->kind != BaseType::Array || info->element);
     }
 
     Type array() const {
-        Type t(BaseType::Array);
-        t.elementType = std::make_shared<Type>(*this);
-        return t;
+        return Type(TypeTable::arrayOf(info));
     }
 
     std::string toString() const {
-        switch(kind) {
+        switch(info->kind) {
             case BaseType::Int: return "int";
             case BaseType::Bool: return "bool";
             case BaseType::String: return "string";
-            case BaseType::Array: return "array<" + (elementType ? elementType->toString() : std::string("?")) + ">";
+            case BaseType::Array: return "array<" + (info->element ? element().toString() : std::string("?")) + ">";
             case BaseType::Function: return "function";
-            case BaseType::Struct: return "struct: " + customName;
+            case BaseType::Struct: return "struct: " + info->customName;
             case BaseType::ExportData: return "exportData";
             case BaseType::NIL: return "nil";
         }
         return "unknown";
     }
+
+private:
+    const TypeInfo *info;
+
+    explicit Type(const TypeInfo *info) : info(info) {}
+};
+static_assert(sizeof(Type) == sizeof(void *));
+
+inline StaticType staticTypeOf(const Type &type) {
+    switch (type.kind()) {
+        case BaseType::Int: return StaticType::Int;
+        case BaseType::Bool: return StaticType::Bool;
+        case BaseType::String: return StaticType::String;
+        default: return StaticType::Unknown;
+    }
+}
+
+// Result type of evaluateBinaryOp, given the static type of its left operand.
+inline StaticType binaryResultType(BinaryOp op, StaticType lhs) {
+    if (lhs == StaticType::Unknown) return StaticType::Unknown;
+    if (lhs == StaticType::String)
+        return op == PLUS || op == MULTIPLY ? StaticType::String : StaticType::Unknown;
+    switch (op) {
+        case PLUS: case MINUS: case MULTIPLY: case DIVIDE: case MODULUS:
+            return StaticType::Int;
+        case COMPARISON: case LESS: case GREATER: case LESS_EQUAL: case GREATER_EQUAL:
+            return StaticType::Bool;
+        default:
+            return StaticType::Unknown;
+    }
+}
+
+// Heap values start with this header: an intrusive reference count and the kind of value, so a
+// TypedValue only has to hold a pointer to know what it refers to.
+struct Object {
+    uint32_t refs = 0;
+    const BaseType kind;
+
+    explicit Object(BaseType kind) : kind(kind) {}
+    Object(const Object &other) : kind(other.kind) {}
+    Object &operator=(const Object &) { return *this; }
+    virtual ~Object() = default;
 };
 
-struct Array {
-    Type elementType;
-    std::vector<TypedValue> elements;
+inline void retain(Object *obj) { ++obj->refs; }
+inline void release(Object *obj) {
+    if (--obj->refs == 0) delete obj;
+}
 
-    void add(const TypedValue &v);
+// Owning handle to a heap value, used where the code knows which kind of object it holds.
+template <typename T>
+class Ref {
+public:
+    Ref() = default;
+    Ref(std::nullptr_t) {}
+    explicit Ref(T *ptr) : ptr(ptr) {
+        if (ptr) retain(ptr);
+    }
+    Ref(const Ref &other) : Ref(other.ptr) {}
+    Ref(Ref &&other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+    ~Ref() {
+        if (ptr) release(ptr);
+    }
+
+    Ref &operator=(Ref other) noexcept {
+        std::swap(ptr, other.ptr);
+        return *this;
+    }
+
+    T *get() const { return ptr; }
+    T *operator->() const { return ptr; }
+    T &operator*() const { return *ptr; }
+    explicit operator bool() const { return ptr != nullptr; }
+    bool operator==(const Ref &other) const { return ptr == other.ptr; }
+
+private:
+    T *ptr = nullptr;
 };
-using PArray = std::shared_ptr<Array>;
-using PFunction = std::shared_ptr<Function>;
-using PStruct = std::shared_ptr<Struct>;
-using PExportData = std::shared_ptr<ExportData>;
 
+template <typename T, typename... Args>
+Ref<T> makeRef(Args &&...args) {
+    return Ref<T>(new T(std::forward<Args>(args)...));
+}
+
+using PArray = Ref<Array>;
+using PFunction = Ref<Function>;
+using PStruct = Ref<Struct>;
+using PExportData = Ref<ExportData>;
+
+// Old tagged union of every value, kept for native code written against it.
 using Value = std::variant<int, bool, std::nullptr_t, std::string,
                            PArray, PFunction, PStruct, PExportData>;
 
+// One tagged word: ints, bools and nil are immediates, anything else is an Object pointer whose
+// header carries the kind. Array element types and struct names live on the object, type()
+// rebuilds the full Type when a check needs it.
 struct TypedValue {
-    Value value;
-    Type type;
+    TypedValue() : bits(NilTag) {}
+    TypedValue(int value) : bits(static_cast<uint64_t>(static_cast<uint32_t>(value)) << 32 | IntTag) {}
+    TypedValue(bool value) : bits(static_cast<uint64_t>(value) << 32 | BoolTag) {}
+    TypedValue(const std::string &value);
+    TypedValue(const PArray &arr);
+    TypedValue(const PFunction &fn);
+    TypedValue(const PStruct &str);
+    TypedValue(const PExportData &ed);
+    TypedValue(const Value &value);
+
+    TypedValue(const TypedValue &other) : bits(other.bits) {
+        if (isObject()) retain(object());
+    }
+    TypedValue(TypedValue &&other) noexcept : bits(other.bits) { other.bits = NilTag; }
+    ~TypedValue() {
+        if (isObject()) release(object());
+    }
 
-    TypedValue(PExportData ed) : value(ed), type(Type(BaseType::ExportData)) {}
-    TypedValue(PFunction fn) : value(fn), type(Type(BaseType::Function)) {}
-    TypedValue(Value value, Type type) : value(value), type(type) {}
-    TypedValue(int value) : value(value), type(Type(Primitive::INT)) {}
-    TypedValue(bool value) : value(value), type(Type(Primitive::BOOL)) {}
-    TypedValue(const std::string &value) : value(value), type(Type(Primitive::STRING)) {}
-    TypedValue(const PArray arr, Type t) : value(arr), type(t) {}
-    TypedValue(const PStruct fn) : value(fn), type(Type(BaseType::Struct)) {}
-    explicit TypedValue() : value(nullptr), type(Type(BaseType::NIL)) {}
+    TypedValue &operator=(const TypedValue &other) {
+        if (other.isObject()) retain(other.object());
+        if (isObject()) release(object());
+        bits = other.bits;
+        return *this;
+    }
+    TypedValue &operator=(TypedValue &&other) noexcept {
+        std::swap(bits, other.bits);
+        return *this;
+    }
 
-    template <typename T>
-    T get() const {
-        return std::get<T>(value);
+    BaseType kind() const {
+        switch (bits & TagMask) {
+            case IntTag: return BaseType::Int;
+            case BoolTag: return BaseType::Bool;
+            case NilTag: return BaseType::NIL;
+            default: return object()->kind;
+        }
     }
+    bool is(BaseType base) const { return kind() == base; }
+    Type type() const;
+
+    // int, bool, std::string, nullptr_t, the P* handles and, for natives that still hold heap
+    // values in std::shared_ptr, std::shared_ptr<T> keeping the object alive
+    template <typename T>
+    T get() const;
 
     template <typename T>
-    std::shared_ptr<T> point() const {
-        return get<std::shared_ptr<T>>();
+    Ref<T> point() const {
+        return get<Ref<T>>();
     }
+
+    const std::string &str() const;
+    Value variant() const;
+
+private:
+    enum : uint64_t { ObjectTag = 0, IntTag = 1, BoolTag = 2, NilTag = 3, TagMask = 3 };
+    uint64_t bits;
+
+    explicit TypedValue(Object *obj) : bits(obj ? reinterpret_cast<uint64_t>(obj) : NilTag) {
+        if (obj) retain(obj);
+    }
+
+    bool isObject() const { return (bits & TagMask) == ObjectTag; }
+    Object *object() const { return reinterpret_cast<Object *>(bits); }
+    int32_t immediate() const { return static_cast<int32_t>(bits >> 32); }
+    void expect(BaseType base) const {
+        if (kind() != base) throw std::bad_variant_access();
+    }
+};
+static_assert(sizeof(TypedValue) == 8);
+
+struct String : Object {
+    static constexpr BaseType Kind = BaseType::String;
+    std::string value;
+
+    explicit String(std::string value) : Object(Kind), value(std::move(value)) {}
+};
+
+struct Array : Object {
+    static constexpr BaseType Kind = BaseType::Array;
+    Type elementType;
+    std::vector<TypedValue> elements;
+
+    Array() : Object(Kind) {}
+
+    void add(const TypedValue &v);
 };
 
 struct TypedIdentifier {
@@ -128,47 +323,62 @@ struct TypedIdentifier {
 struct Parameter {
     std::string ident;
     Type type;
-    bool vararg;
+    bool vararg = false;
 
-    Parameter(std::string &ident, Type type) : ident(ident), type(type) {}
+    Parameter(const std::string &ident, Type type) : ident(ident), type(type) {}
 };
 
-struct Function {
+struct Function : Object {
+    static constexpr BaseType Kind = BaseType::Function;
+    using Body = std::function<std::shared_ptr<TypedValue>(const std::vector<std::shared_ptr<TypedValue>>&)>;
+
+    Function(Body fn = nullptr) : Object(Kind), fn(std::move(fn)) {}
+
     std::function<std::shared_ptr<TypedValue>(const std::vector<std::shared_ptr<TypedValue>>&)> fn;
+    std::shared_ptr<VMClosure> closure; // set for functions compiled by the VM, lets it call them without fn
+    std::shared_ptr<CompiledClosure> compiled; // same for the closure engine
+    std::shared_ptr<_FunctionData> data; // set for tree walking functions, lets the JIT compile calls to them
+    std::shared_ptr<Environment> env;
 };
 
 struct _FunctionData {
     std::vector<Parameter> params;
     Type retType;
     std::shared_ptr<ASTNode> body;
+    uint32_t frameSize = 0; // slots the Resolver gave the parameters and locals, 0 if it never ran
+    bool returnsChecked = false; // the TypeChecker proved every return matches retType
 };
 using FunctionData = std::shared_ptr<_FunctionData>;
 
-struct Struct {
+struct Struct : Object {
+    static constexpr BaseType Kind = BaseType::Struct;
     const std::string name;
     const std::shared_ptr<StructType> type;
 
-    Struct(const std::string &name, std::shared_ptr<StructType> type) : name(name), type(type) {}
+    Struct(const std::string &name, std::shared_ptr<StructType> type) : Object(Kind), name(name), type(type) {}
 
-    std::vector<std::pair<std::string, TypedValue>> fields;
+    // in the order of the type's fields, a handful at most, so they are found by scanning the symbols
+    std::vector<std::pair<Symbol, TypedValue>> fields;
     std::vector<std::pair<std::string, std::any>> hiddenFields;
-private:
-    std::unordered_map<std::string, size_t> fieldIndexMap;
 
-public:
     void addField(const std::string &fieldName, const TypedValue &value) {
-        fieldIndexMap[fieldName] = fields.size();
-        fields.emplace_back(fieldName, value);
+        fields.emplace_back(Symbols::intern(fieldName), value);
     }
 
     void addHiddenField(const std::string &fieldName, const std::any &value) {
         hiddenFields.emplace_back(fieldName, value);
     }
 
+    TypedValue *findField(Symbol fieldName) {
+        for (auto &[name, value] : fields)
+            if (name == fieldName) return &value;
+        return nullptr;
+    }
+
     TypedValue& getField(const std::string &fieldName) {
-        auto it = fieldIndexMap.find(fieldName);
-        if (it == fieldIndexMap.end()) throw std::runtime_error("Field not found: " + fieldName);
-        return fields[it->second].second;
+        TypedValue *field = findField(Symbols::intern(fieldName));
+        if (!field) throw std::runtime_error("Field not found: " + fieldName);
+        return *field;
     }
 
     std::any& getHiddenField(const std::string &fieldName) {
@@ -179,19 +389,18 @@ public:
     }
 
     void setField(const std::string &fieldName, const TypedValue &value) {
-        auto it = fieldIndexMap.find(fieldName);
-        if (it == fieldIndexMap.end()) throw std::runtime_error("Field not found: " + fieldName);
-        fields[it->second].second = value;
+        getField(fieldName) = value;
     }
 };
 
 struct StructType {
     std::string name;
-    StructType(const std::string &name) : name(name) {}
-    std::vector<std::pair<std::string, Type>> fields;
+    Type instanceType;
+    StructType(const std::string &name) : name(name), instanceType(name) {}
+    std::vector<std::pair<Symbol, Type>> fields;
     
     bool match(Type type) const {
-        return type.kind == BaseType::Struct && type.customName == name;
+        return type.match(instanceType);
     }
 };
 
@@ -208,17 +417,30 @@ using NativeFunc = std::function<ReturnValue(std::shared_ptr<Environment>, Execu
 
 class Environment {
 public:
-    explicit Environment(std::shared_ptr<Environment> parent = nullptr) : parent(parent) {}
+    explicit Environment(std::shared_ptr<Environment> parent = nullptr, uint32_t frameSize = 0)
+        : parent(parent), frame(frameSize) {}
 
-    std::stack<TypedValue> selfRefStack;
+    std::stack<TypedValue, std::vector<TypedValue>> selfRefStack;
     std::unordered_map<std::string, NativeFunc> nativeInqueries;
     void registerNative(const std::string &name, NativeFunc func) {
         if(parent != nullptr) throw std::runtime_error("Cannot set native functions on a non-root environment");
         nativeInqueries[name] = func;
     }
 
-    void set(const std::string &name, const TypedValue &val) { variables[name] = val; }
-    void setType(const std::string &name, const std::shared_ptr<StructType> &type) { structTypes[name] = type; }
+    // Variables are keyed by the Symbol of their name, the string overloads intern it first.
+    void set(Symbol name, const TypedValue &val) {
+        auto [it, inserted] = slots.try_emplace(name, static_cast<uint32_t>(values.size()));
+        if (!inserted) {
+            values[it->second] = val;
+            return;
+        }
+        names.push_back(name);
+        values.push_back(val);
+        declared |= nameBit(name);
+    }
+    void set(const std::string &name, const TypedValue &val) { set(Symbols::intern(name), val); }
+    void setType(Symbol name, const std::shared_ptr<StructType> &type) { structTypes[name] = type; }
+    void setType(const std::string &name, const std::shared_ptr<StructType> &type) { setType(Symbols::intern(name), type); }
 
     void pushSelfRef(const TypedValue &val) { selfRefStack.push(val); }
     void popSelfRef() {
@@ -231,60 +453,190 @@ public:
     }
     bool hasSelfRef() const { return !selfRefStack.empty(); }
 
-    std::shared_ptr<StructType> getType(const std::string &name) {
-        if (structTypes[name]) return structTypes[name];
-        if (parent) return parent->getType(name);
+    std::shared_ptr<StructType> getType(Symbol name) {
+        for (Environment *env = this; env; env = env->parent.get()) {
+            auto it = env->structTypes.find(name);
+            if (it != env->structTypes.end() && it->second) return it->second;
+        }
         return nullptr;
     }
+    std::shared_ptr<StructType> getType(const std::string &name) { return getType(Symbols::intern(name)); }
+
+    void modify(Symbol name, const TypedValue &val) {
+        for (Environment *env = this; env; env = env->parent.get()) {
+            auto it = env->slots.find(name);
+            if (it == env->slots.end()) continue;
+            env->values[it->second] = val;
+            return;
+        }
+        root()->set(name, val);
+    }
+    void modify(const std::string &name, const TypedValue &val) { modify(Symbols::intern(name), val); }
+
+    bool has(Symbol name) const { return slots.find(name) != slots.end(); }
+    bool has(const std::string &name) const { return has(Symbols::intern(name)); }
 
-    void modify(const std::string &name, const TypedValue &val) {
-        if (variables.find(name) != variables.end()) variables[name] = val;
-        else if (parent) return parent->modify(name, val);
-        else variables[name] = val;
+    TypedValue get(Symbol name) {
+        uint16_t depth;
+        uint32_t slot;
+        if (TypedValue *val = lookup(name, depth, slot)) return *val;
+        throw std::runtime_error("Undefined variable: " + Symbols::name(name));
+    }
+    TypedValue get(const std::string &name) { return get(Symbols::intern(name)); }
+
+    // Inline cache support. A variable keeps its slot for the lifetime of its environment, and
+    // declared holds one bit per name so a cached lookup can skip environments without hashing.
+    static uint64_t nameBit(Symbol name) { return uint64_t(1) << (name & 63); }
+    bool mayHave(uint64_t bit) const { return declared & bit; }
+
+    TypedValue *lookup(Symbol name, uint16_t &depth, uint32_t &slot) {
+        depth = 0;
+        for (Environment *env = this; env; env = env->parent.get(), ++depth) {
+            if (!env->mayHave(nameBit(name))) continue;
+            auto it = env->slots.find(name);
+            if (it == env->slots.end()) continue;
+            slot = it->second;
+            return &env->values[slot];
+        }
+        return nullptr;
     }
 
-    bool has(const std::string &name) const { return variables.find(name) != variables.end(); }
+    TypedValue *at(uint32_t slot, Symbol name) {
+        return slot < values.size() && names[slot] == name ? &values[slot] : nullptr;
+    }
 
-    TypedValue get(const std::string &name) {
-        if (variables.find(name) != variables.end()) return variables[name];
-        if (parent) return parent->get(name);
-        throw std::runtime_error("Undefined variable: " + name);
+    // Every environment is the frame of one function call or module, resolved locals live in its
+    // frame and are reached by walking address.depth parents up.
+    TypedValue &local(const ASTNode::Address &address) {
+        Environment *env = this;
+        for (uint16_t depth = address.depth; depth; --depth) env = env->parent.get();
+        return env->frame[address.slot];
     }
 
     std::shared_ptr<Environment> parent;
+    std::vector<TypedValue> frame;
 
 private:
-    std::unordered_map<std::string, TypedValue> variables;
-    std::unordered_map<std::string, std::shared_ptr<StructType>> structTypes;
+    std::unordered_map<Symbol, uint32_t> slots;
+    std::vector<Symbol> names; // keys of slots, by slot
+    std::vector<TypedValue> values;
+    uint64_t declared = 0;
+    std::unordered_map<Symbol, std::shared_ptr<StructType>> structTypes;
+
+    Environment *root() {
+        Environment *env = this;
+        while (env->parent) env = env->parent.get();
+        return env;
+    }
 };
 
 using ENV = std::shared_ptr<Environment>;
 
-struct ExportData {
-    ExportData(const std::string &fileName) : fileName(fileName) {}
+struct ExportData : Object {
+    static constexpr BaseType Kind = BaseType::ExportData;
+    ExportData(const std::string &fileName) : Object(Kind), fileName(fileName) {}
 
-    std::unordered_map<std::string, std::pair<ENV, std::string>> exports;
+    std::unordered_map<Symbol, ENV> exports;
     std::string fileName;
 
-    void addExport(const std::string &name, ENV env) {
-        exports[name] = { env, name };
+    void addExport(Symbol name, ENV env) {
+        exports[name] = env;
     }
 
-    TypedValue getExportedValue(const std::string &name) {
+    TypedValue getExportedValue(Symbol name) {
         auto it = exports.find(name);
-        if (it == exports.end()) throw std::runtime_error("Export not found: " + name);
-        return it->second.first->get(it->second.second);
+        if (it == exports.end()) throw std::runtime_error("Export not found: " + Symbols::name(name));
+        return it->second->get(name);
     }
 };
 
+inline TypedValue::TypedValue(const std::string &value) : TypedValue(static_cast<Object *>(new String(value))) {}
+
+inline TypedValue::TypedValue(const PArray &arr) : TypedValue(static_cast<Object *>(arr.get())) {}
+inline TypedValue::TypedValue(const PFunction &fn) : TypedValue(static_cast<Object *>(fn.get())) {}
+inline TypedValue::TypedValue(const PStruct &str) : TypedValue(static_cast<Object *>(str.get())) {}
+inline TypedValue::TypedValue(const PExportData &ed) : TypedValue(static_cast<Object *>(ed.get())) {}
+
+inline TypedValue::TypedValue(const Value &value) : TypedValue() {
+    std::visit([this](const auto &alt) {
+        if constexpr (!std::is_same_v<std::decay_t<decltype(alt)>, std::nullptr_t>) *this = TypedValue(alt);
+    }, value);
+}
+
+inline Type TypedValue::type() const {
+    switch (kind()) {
+        case BaseType::Array: return static_cast<const Array *>(object())->elementType.array();
+        case BaseType::Struct: {
+            auto str = static_cast<const Struct *>(object());
+            return str->type ? str->type->instanceType : Type(str->name);
+        }
+        default: return Type(kind());
+    }
+}
+
+inline const std::string &TypedValue::str() const {
+    expect(BaseType::String);
+    return static_cast<const String *>(object())->value;
+}
+
+template <typename T>
+struct IsSharedPtr : std::false_type {};
+template <typename T>
+struct IsSharedPtr<std::shared_ptr<T>> : std::true_type {};
+
+template <typename T>
+T TypedValue::get() const {
+    if constexpr (std::is_same_v<T, int>) {
+        expect(BaseType::Int);
+        return immediate();
+    } else if constexpr (std::is_same_v<T, bool>) {
+        expect(BaseType::Bool);
+        return immediate() != 0;
+    } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+        expect(BaseType::NIL);
+        return nullptr;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        return str();
+    } else if constexpr (IsSharedPtr<T>::value) {
+        using U = typename T::element_type;
+        Ref<U> ref = get<Ref<U>>();
+        return std::shared_ptr<U>(ref.get(), [ref](U *) {});
+    } else {
+        using U = std::remove_pointer_t<decltype(std::declval<T>().get())>;
+        expect(U::Kind);
+        return T(static_cast<U *>(object()));
+    }
+}
+
+inline Value TypedValue::variant() const {
+    switch (kind()) {
+        case BaseType::Int: return get<int>();
+        case BaseType::Bool: return get<bool>();
+        case BaseType::String: return str();
+        case BaseType::Array: return get<PArray>();
+        case BaseType::Function: return get<PFunction>();
+        case BaseType::Struct: return get<PStruct>();
+        case BaseType::ExportData: return get<PExportData>();
+        case BaseType::NIL: break;
+    }
+    return nullptr;
+}
+
 class Executor {
 public:
-    explicit Executor(std::shared_ptr<ASTNode> root);
-    void printArray(std::ostream *out, const std::shared_ptr<Array> &arr);
-    void printStruct(std::ostream *out, const std::shared_ptr<Struct> &st);
+    explicit Executor(std::shared_ptr<ASTNode> root, bool enableJit = false);
+    void printArray(std::ostream *out, const PArray &arr);
+    void printStruct(std::ostream *out, const PStruct &st);
     void printValue(std::ostream *out, const TypedValue &val);
     TypedValue run();
 
+    // What the main module's top level left in a variable, once run() has returned.
+    TypedValue global(Symbol name) { return globalEnv->get(name); }
+    void define(Symbol name, const TypedValue &value) { globalEnv->set(name, value); }
+    // Makes run() throw once it has made more than steps calls and loop iterations in total, or nested
+    // calls deeper than depth, for running code that may never finish before it is trusted.
+    void limit(size_t steps, size_t depth) { budget = Budget{steps, depth}; }
+
     template <typename T, typename... Cases>
     T extract(const Value &val, Cases &&...cases) {
         return std::visit(overloaded{
@@ -293,7 +645,7 @@ public:
         }, val);
     }
 
-    std::vector<int> getIndices(const std::shared_ptr<Array> &arr,
+    std::vector<int> getIndices(const PArray &arr,
                                 const std::shared_ptr<ASTNode> &indicesNode,
                                 ENV env) {
         std::vector<int> indices;
@@ -318,14 +670,14 @@ public:
         return indices;
     }
 
-    TypedValue handleArrayAccess(const std::shared_ptr<Array> &arr, std::shared_ptr<ASTNode> indicesNode, ENV env);
+    TypedValue handleArrayAccess(const PArray &arr, std::shared_ptr<ASTNode> indicesNode, ENV env);
 
-    void handleArrayAssignment(const std::shared_ptr<Array> &arr,
+    void handleArrayAssignment(const PArray &arr,
                                std::shared_ptr<ASTNode> indicesNode,
                                ENV env,
                                std::shared_ptr<ASTNode> valNode);
 
-    TypedValue processArrayOperation(const std::shared_ptr<Array> &arr,
+    TypedValue processArrayOperation(const PArray &arr,
                                 std::shared_ptr<ASTNode> indicesNode,
                                 ENV env,
                                 std::optional<std::shared_ptr<ASTNode>> valNode);
@@ -334,40 +686,65 @@ public:
     bool getBoolValue(const TypedValue &val);
     std::string getStringValue(const TypedValue &val);
 
-    TypedValue arrayOperation(const std::shared_ptr<Array> &arr, const std::vector<int> &indices);
-    TypedValue arrayOperation(const std::shared_ptr<Array> &arr, const std::vector<int> &indices, std::shared_ptr<ASTNode> valNode, ENV env);
+    TypedValue arrayOperation(const PArray &arr, const std::vector<int> &indices);
+    TypedValue arrayOperation(const PArray &arr, const std::vector<int> &indices, std::shared_ptr<ASTNode> valNode, ENV env);
+    TypedValue arrayOperation(const PArray &arr, const std::vector<int> &indices, const TypedValue &val);
+    TypedValue evaluateBinaryOp(const TypedValue &lhs, const TypedValue &rhs, BinaryOp op);
+    TypedValue evaluateUnaryOp(const TypedValue &operand, BinaryOp op);
     TypedValue evaluateExpression(std::shared_ptr<ASTNode> node, ENV env);
 
+    PFunction createNativeFunction(std::string name, FunctionData funcData, ENV env);
+    FunctionData executeFunctionDefinition(std::shared_ptr<ASTNode> node, ENV env);
+    TypedValue evaluateReadProperty(const TypedValue &target, Symbol property);
+    TypedValue primitiveValue(const Primitive val);
+
 private:
     std::shared_ptr<ASTNode> root;
     ENV globalEnv;
+    std::shared_ptr<Jit> jit; // null unless enabled and supported
+    std::vector<TypedValue> constants; // STRING literals, indexed by the node's cache slot
+
+    struct Budget {
+        size_t steps; // calls and loop iterations left
+        size_t depth; // calls that may still be nested
+    };
+    std::optional<Budget> budget; // unset unless limit() was called
+    void spend(bool call);
 
     std::unordered_map<std::string, PExportData> exportData; 
     std::unordered_map<std::string, std::shared_ptr<ASTNode>> pragmas;
     std::vector<std::string> handlingModules;
 
-    std::shared_ptr<Function> createNativeFunction(std::string name, FunctionData funcData, ENV env);
-
     TypedValue handleNDArrayAssignment(std::shared_ptr<ASTNode> node, ENV env);
     void handleStructDeclaration(std::shared_ptr<ASTNode> node, ENV env);
     TypedValue handleStructAssignment(std::shared_ptr<ASTNode> node, ENV env);
 
-    void handleImports(std::vector<std::shared_ptr<ASTNode>> children, ENV env);
+    void handleImports(const ASTChildren &children, ENV env);
 
     void executePragma(std::shared_ptr<ASTNode> node, ENV env);
 
-    void executePragmas(std::vector<std::shared_ptr<ASTNode>> children, ENV env);
-
-    FunctionData executeFunctionDefinition(std::shared_ptr<ASTNode> node, ENV env);
+    void executePragmas(const ASTChildren &children, ENV env);
 
     ReturnValue executeNode(std::shared_ptr<ASTNode> node, ENV env, bool extraBit = false);
 
-    ReturnValue executeBlock(const std::vector<std::shared_ptr<ASTNode>> &nodes, ENV env);
+    ReturnValue executeBlock(const ASTChildren &nodes, ENV env);
     TypedValue handleReadAssignment(std::shared_ptr<ASTNode> node, ENV env, std::shared_ptr<ASTNode> valNode);
-    TypedValue evaluateReadProperty(const TypedValue &target, const std::string &property);
-    TypedValue primitiveValue(const Primitive val);
     TypedValue handleAssignment(std::shared_ptr<ASTNode> node, ENV env, Primitive primVal, bool modify);
-    std::shared_ptr<Function> createFunction(FunctionData funcData, ENV closureEnv);
+    PFunction createFunction(FunctionData funcData, ENV closureEnv);
+    TypedValue callFunction(const FunctionData &funcData, const ENV &closureEnv,
+                            const std::vector<std::shared_ptr<TypedValue>> &args, bool argsChecked);
+    void declare(const ASTNode &node, const ENV &env, const TypedValue &val);
+
+    // quickened paths of evaluateExpression, each node caches what it saw last time it ran
+    TypedValue &lookupCached(ASTNode &node, const ENV &env);
+    TypedValue &structField(ASTNode &readNode, const PStruct &str);
+    TypedValue evaluateQuickBinaryOp(ASTNode &node, const TypedValue &lhs, const TypedValue &rhs);
 };
 
+const std::unordered_map<std::string, std::function<void(ENV, Executor*)>>& getImportMaps();
+
+// Type checks arguments laid out in args[0..argc) and packs varargs in place, args must have room for every parameter.
+void checkArgument(const Parameter &param, const TypedValue &arg);
+void bindArguments(const _FunctionData &funcData, TypedValue *args, size_t argc);
+
 #endif
@@ -0,0 +1,45 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include "executor.hpp"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Baseline x86-64 JIT for the tree walking interpreter. Calls are counted per FUNCTION body and back
+// edges per loop node; once hot, regions that only touch int values (and the bools their comparisons
+// produce) are compiled to native code. Anything else keeps running in the interpreter.
+class Jit {
+public:
+    static constexpr uint32_t HOT_CALLS = 100;
+    static constexpr uint32_t HOT_BACK_EDGES = 1000;
+
+    struct Region;
+
+    Jit();
+    ~Jit();
+
+    // only Linux x86-64 can run the generated code
+    static bool supported();
+
+    // false means the call has to be interpreted, otherwise result holds the return value
+    bool call(const FunctionData &funcData, const ENV &env,
+              const std::vector<std::shared_ptr<TypedValue>> &args, TypedValue &result);
+
+    Region *loop(const ASTNode *node);
+    // called after every iteration, true means the rest of the loop ran natively
+    bool backEdge(Region *region, const std::shared_ptr<ASTNode> &node, const ENV &env);
+
+private:
+    std::unordered_map<const ASTNode *, std::unique_ptr<Region>> regions;
+
+    Region *region(const ASTNode *node);
+    Region *compileFunction(const FunctionData &funcData, const ENV &env);
+    bool compileLoop(Region &region, const std::shared_ptr<ASTNode> &node, const ENV &env);
+    bool guard(const Region &region, const ENV &env) const;
+
+    friend class RegionCompiler;
+};
+
+#endif
@@ -1,12 +1,17 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include "sourcefile.hpp"
 #include <unordered_map>
+#include <array>
+#include <deque>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
-enum BinaryOp {
+enum BinaryOp : uint8_t {
     PLUS,
     MINUS,
     MULTIPLY,
@@ -24,7 +29,7 @@ enum BinaryOp {
     BITWISE_XOR,
 };
 
-enum class Primitive {
+enum class Primitive : uint8_t {
     NONE,
 
     INT,
@@ -32,8 +37,10 @@ enum class Primitive {
     STRING,
 };
 
+// A token does not own its text, value views the source file of the Lexer that made it, or that
+// Lexer's arena for string literals with escapes, so it is only valid while the Lexer is alive.
 struct Token {
-    enum class Type {
+    enum class Type : uint8_t {
         END_OF_FILE,
 
         SEMICOLON,
@@ -85,35 +92,95 @@ struct Token {
         IDENTIFIER,
         KEYWORD,
         PRIMITIVE,
-    } type;
-    std::string value;
-    size_t lineIndex;
-    size_t colIndex;
-
-    BinaryOp binopValue;
-    Primitive primitiveValue;
+    };
+    std::string_view value;
+    uint32_t lineIndex;
+    uint32_t colIndex;
+
+    Type type;
+    BinaryOp binopValue = PLUS;
+    Primitive primitiveValue = Primitive::NONE;
 };
+static_assert(sizeof(Token) == 32);
 
 class Lexer {
 public:
-    Lexer(const std::string &source);
+    explicit Lexer(SourceFile file);
+    explicit Lexer(std::string source) : Lexer(SourceFile(std::move(source))) {}
+    Lexer(const Lexer &) = delete;
+    Lexer &operator=(const Lexer &) = delete;
+
     std::vector<Token> tokenize();
 
-    std::unordered_map<std::string, std::string> aliases;
+    // Appends the tokens of the next lexeme, returns false once it has appended END_OF_FILE.
+    bool scan(std::vector<Token> &tokens);
 
 private:
-    std::string source;
+    // lets the alias table be searched with a string_view of the source
+    struct WordHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    // The tokens an #alias expands to, lexed once from the replacement by a Lexer kept alive for them.
+    struct Alias {
+        std::unique_ptr<Lexer> lexer;
+        std::vector<Token> tokens;
+    };
+    std::unordered_map<std::string, Alias, WordHash, std::equal_to<>> aliases;
+
+    SourceFile file;
+    std::string_view source; // file.text()
+    std::deque<std::string> strings; // unescaped string literals, deque so they never move
     size_t current = 0;
-    size_t lineIndex = 1;
-    size_t colIndex = 1;
+    bool headersRead = false;
+
+    // Lines are only counted when a token or error asks where it is, by finding the newlines between
+    // the last offset located and the new one. Offsets are asked for in increasing order.
+    size_t located = 0;
+    size_t lineStart = 0;
+    uint32_t lineIndex = 1;
 
     char peek(size_t n = 0) const;
     char consume();
-    void selfUpd(std::vector<Token> *tokens, const std::string &value, Token::Type type, unsigned long tokenLine, unsigned long tokenCol, int by);
-    void pushSelfUpd(std::vector<Token> *tokens, const std::string &value, Token::Type type, unsigned long tokenLine, unsigned long tokenCol, int by);
-    void simplitiveBinOp(std::vector<Token> *tokens, const std::string &value, Token::Type type, unsigned long tokenLine, unsigned long tokenCol);
+    void locate(size_t offset);
+    uint32_t column(size_t offset) const { return static_cast<uint32_t>(offset - lineStart + 1); }
+    [[noreturn]] void error(const std::string &msg);
+    std::string_view text(size_t start) const { return std::string_view(source).substr(start, current - start); }
+    void selfUpd(std::vector<Token> *tokens, std::string_view value, Token::Type type, uint32_t tokenLine, uint32_t tokenCol, int by);
+    void pushSelfUpd(std::vector<Token> *tokens, std::string_view value, Token::Type type, uint32_t tokenLine, uint32_t tokenCol, int by);
+    bool scanOperator(std::vector<Token> &tokens, uint32_t tokenLine, uint32_t tokenCol);
+    void simplitiveBinOp(std::vector<Token> *tokens, std::string_view value, Token::Type type, uint32_t tokenLine, uint32_t tokenCol);
     bool skipWhitespace();
+    void readHeaders();
     void applyHeader(const std::string &header);
 };
 
+// Pulls tokens from a Lexer as the parser asks for them. Only the lookahead is kept, in a ring
+// buffer, so a source is never held as a whole vector of tokens. Past the end it keeps returning
+// END_OF_FILE. Tokens view the source owned by the stream, so they must not outlive it.
+class TokenStream {
+public:
+    static constexpr size_t LOOKAHEAD = 8; // peek(n) needs n < LOOKAHEAD
+
+    explicit TokenStream(SourceFile file) : lexer(std::move(file)) {}
+    explicit TokenStream(std::string source) : lexer(std::move(source)) {}
+
+    Token peek(size_t n = 0);
+    Token consume();
+
+private:
+    Lexer lexer;
+    std::array<Token, LOOKAHEAD> ring{};
+    size_t head = 0;
+    size_t count = 0;
+
+    // what the last Lexer::scan produced and is not in the ring yet
+    std::vector<Token> pending;
+    size_t pendingPos = 0;
+    bool ended = false;
+
+    void fill(size_t n);
+};
+
 #endif
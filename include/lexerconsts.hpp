@@ -1,30 +1,19 @@
 #ifndef LEXER_CONSTS_H
 #define LEXER_CONSTS_H
 
-#include <unordered_map>
+#include <array>
+#include <string_view>
 #include "lexer.hpp"
 
-const std::unordered_map<std::string, Token::Type> operators = {
-    {"&&", Token::Type::AND}, {"||", Token::Type::OR},
-    {"==", Token::Type::COMPARISON}, {"=", Token::Type::EQUAL},
-    {"->", Token::Type::ARROW}, {"&", Token::Type::BITWISE_AND},
-    {"|", Token::Type::BITWISE_OR}, {"^", Token::Type::BITWISE_XOR},
-    {"~", Token::Type::BITWISE_NOT}, {"*", Token::Type::MULTIPLY},
-    //{"-", Token::Type::MINUS}, {"+", Token::Type::PLUS},
-    {"/", Token::Type::DIVIDE}, {"%", Token::Type::MODULUS},
-    {"!", Token::Type::NOT}, {"..", Token::Type::RANGE},
-    {"<", Token::Type::LESS}, {">", Token::Type::GREATER},
-    {"<=", Token::Type::LESS_EQUAL}, {">=", Token::Type::GREATER_EQUAL},
-    {";", Token::Type::SEMICOLON}, {",", Token::Type::COMMA},
-    {"(", Token::Type::LPAREN}, {")", Token::Type::RPAREN},
-    {"[", Token::Type::LBRACKET}, {"]", Token::Type::RBRACKET},
-    {"{", Token::Type::LBRACE}, {"}", Token::Type::RBRACE},
-    {"?", Token::Type::QUESTION_MARK}, {":", Token::Type::COLON},
-    // {"@", Token::Type::SELF_REFERENCE}, 
-    {".", Token::Type::READ}, {"...", Token::Type::SPREAD},
+// Keywords and primitive type names. An identifier is looked up through a perfect hash of its
+// length and first and last characters, the static_assert below fails if a new word collides.
+struct Word {
+    std::string_view text;
+    Token::Type type;
+    Primitive primitive = Primitive::NONE;
 };
 
-const std::unordered_map<std::string, Token::Type> keywords = {
+constexpr Word words[] = {
     {"if", Token::Type::KEYWORD}, {"else", Token::Type::KEYWORD},
     {"while", Token::Type::KEYWORD}, {"return", Token::Type::KEYWORD},
     {"void", Token::Type::KEYWORD}, {"fin", Token::Type::KEYWORD},
@@ -32,20 +21,33 @@ const std::unordered_map<std::string, Token::Type> keywords = {
     {"import", Token::Type::KEYWORD}, {"export", Token::Type::KEYWORD},
     {"false", Token::Type::KEYWORD}, {"true", Token::Type::KEYWORD},
     {"as", Token::Type::KEYWORD}, {"native", Token::Type::KEYWORD},
-    {"link", Token::Type::KEYWORD},
-};
+    {"link", Token::Type::KEYWORD}, {"const", Token::Type::KEYWORD},
 
-const std::unordered_map<std::string, Primitive> primitives = {
-    {"int", Primitive::INT},
-    {"bool", Primitive::BOOL},
-    {"string", Primitive::STRING},
+    {"int", Token::Type::PRIMITIVE, Primitive::INT},
+    {"bool", Token::Type::PRIMITIVE, Primitive::BOOL},
+    {"string", Token::Type::PRIMITIVE, Primitive::STRING},
 };
 
-const std::unordered_map<std::string, BinaryOp> binopMap = {
-    {"+", PLUS}, {"-", MINUS}, {"*", MULTIPLY}, {"/", DIVIDE}, {"%", MODULUS},
-    {"&", BITWISE_AND}, {"|", BITWISE_OR}, {"^", BITWISE_XOR}, {"~", BITWISE_NOT},
-    {"!", NOT}, {"==", COMPARISON}, {"<", LESS}, {">", GREATER},
-    {"<=", LESS_EQUAL}, {">=", GREATER_EQUAL},
-};
+constexpr size_t wordHash(std::string_view s) {
+    return (s.size() + static_cast<unsigned char>(s.front()) + 3 * static_cast<unsigned char>(s.back())) & 63;
+}
+
+constexpr std::array<int8_t, 64> wordTable = [] {
+    std::array<int8_t, 64> table{};
+    table.fill(-1);
+    for (size_t i = 0; i < std::size(words); ++i) table[wordHash(words[i].text)] = static_cast<int8_t>(i);
+    return table;
+}();
+
+static_assert([] {
+    for (size_t i = 0; i < std::size(words); ++i)
+        if (wordTable[wordHash(words[i].text)] != static_cast<int8_t>(i)) return false;
+    return true;
+}(), "two keywords share a wordHash slot");
+
+constexpr const Word *findWord(std::string_view s) {
+    int8_t i = wordTable[wordHash(s)];
+    return i >= 0 && words[i].text == s ? &words[i] : nullptr;
+}
 
-#endif 
\ No newline at end of file
+#endif
@@ -0,0 +1,69 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "parser.hpp"
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class TypeChecker;
+
+// Rewrites the parsed program before it is lumped, so the .lmp and every engine only see what is
+// left. Level 1 runs the first pass, level 2 all of them:
+//  - folding: operators whose operands are all literals become a literal, and the arms of an if or
+//    while with a literal condition that can never run and the statements after a return are dropped
+//  - inlining: a call to a small fin, whose body only returns an expression over its parameters,
+//    becomes that expression, across modules too
+//  - unused literals: a declaration of a literal that nothing in its module names is dropped
+//  - loop invariants: an expression a loop cannot change, and that can neither fail nor have effects,
+//    is computed once before the loop in a temporary
+//  - tree shaking: once the checker accepts the program, what nothing can reach is dropped, see TreeShaker
+// Only rewrites that every engine agrees on are made: an operation that would fail or overflow
+// while running is left for the engine to report.
+class Optimizer {
+public:
+    explicit Optimizer(int level) : level(level) {}
+
+    void optimize(const std::shared_ptr<ASTNode> &root);
+
+private:
+    // What running a loop or a fin may change. The fins it calls are listed rather than followed.
+    struct Effects {
+        std::unordered_set<Symbol> names; // assigned, besides a fin's own locals
+        std::vector<const ASTNode *> calls;
+        bool memory = false; // a field or element may be assigned
+        bool unknown = false; // calls something that cannot be followed
+    };
+    using Scopes = std::vector<std::unordered_set<Symbol>>;
+
+    int level;
+    std::unordered_map<Symbol, size_t> uses; // how often each name is read or assigned in the module
+    std::unordered_set<Symbol> declared; // every name the program declares, in any module
+    std::unordered_map<const ASTNode *, Effects> fins; // by FUNCTION node
+    size_t temporaries = 0;
+
+    void visit(std::shared_ptr<ASTNode> &node);
+    void keep(std::shared_ptr<ASTNode> &node);
+    void statements(ASTChildren &list, size_t from, bool block);
+    void foldBinaryOp(std::shared_ptr<ASTNode> &node);
+    void foldUnaryOp(std::shared_ptr<ASTNode> &node);
+
+    void inlineCalls(std::shared_ptr<ASTNode> &node, const TypeChecker &checker);
+    std::shared_ptr<ASTNode> inlined(const ASTNode &call, const ASTNode &function, const TypeChecker &checker);
+
+    void hoistLoops(std::shared_ptr<ASTNode> &node, const TypeChecker &checker);
+    void hoist(std::shared_ptr<ASTNode> &node, const Effects &effects, const TypeChecker &checker, ASTChildren &temps);
+    bool invariant(const ASTNode &expr, const Effects &effects, const TypeChecker &checker) const;
+    std::shared_ptr<ASTNode> temporary(const std::shared_ptr<ASTNode> &expr, Primitive primitive, ASTChildren &temps);
+    Effects loopEffects(const ASTNode &loop, const TypeChecker &checker);
+    const Effects &finEffects(const ASTNode &function, const TypeChecker &checker);
+    void collectEffects(const ASTNode &node, Effects &effects, Scopes *scopes, const TypeChecker &checker) const;
+    void collectDeclared(const ASTNode &node);
+
+    void countUses(const std::shared_ptr<ASTNode> &node);
+    void dropUnused(ASTChildren &list, size_t from);
+    void dropUnusedIn(const std::shared_ptr<ASTNode> &node);
+};
+
+#endif
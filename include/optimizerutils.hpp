@@ -0,0 +1,44 @@
+#ifndef OPTIMIZER_UTILS_H
+#define OPTIMIZER_UTILS_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "parser.hpp"
+
+// An int, bool or string literal, a negated number, or a non-empty array literal of literals.
+// Evaluating one can neither fail nor have effects.
+bool isLiteral(const ASTNode &node);
+
+// A literal every value of which has the type primitive, so declaring a primitive with it cannot fail.
+bool isLiteralOf(const ASTNode &node, Primitive primitive);
+
+// What the passes that look across modules know of each one, Module adds the pass's own state.
+template <typename Module>
+struct ModuleInfo {
+    std::shared_ptr<ASTNode> pragma;
+    std::unordered_map<Symbol, Module *> aliases; // .lum imports
+};
+
+// Adds the module of pragma, with each .lum import alias that accept(alias symbol) allows. The
+// PRAGMAs of a program list imports before the modules importing them, so added in that order every
+// alias finds its module.
+template <typename Module, typename Accept>
+Module &addModule(std::unordered_map<std::string, Module> &modules, const std::shared_ptr<ASTNode> &pragma,
+                  Accept accept) {
+    Module &module = modules[pragma->strValue()];
+    module.pragma = pragma;
+    for (const auto &import : pragma->children[0]->children) {
+        if (import->children.empty() || !accept(import->children[0]->symbol)) continue;
+        if (auto it = modules.find(import->strValue()); it != modules.end())
+            module.aliases[import->children[0]->symbol] = &it->second;
+    }
+    return module;
+}
+
+template <typename Module>
+Module &addModule(std::unordered_map<std::string, Module> &modules, const std::shared_ptr<ASTNode> &pragma) {
+    return addModule(modules, pragma, [](Symbol) { return true; });
+}
+
+#endif
@@ -2,6 +2,8 @@
 #define PARSER_H
 
 #include "lexer.hpp"
+#include "symbol.hpp"
+#include "astarena.hpp"
 #include <unordered_map>
 #include <memory>
 #include <vector>
@@ -10,8 +12,13 @@
 #include <sstream>
 #include <functional>
 
+struct ASTNode;
+using ASTChildren = std::vector<std::shared_ptr<ASTNode>, ASTAllocator<std::shared_ptr<ASTNode>>>;
+
+// Laid out so the fields every walk reads come first and the payloads only some kinds use share
+// space. Names and literal text are interned, a node holds their Symbol instead of a string.
 struct ASTNode {
-    enum class Type {
+    enum class Type : uint8_t {
         PROGRAM,
         PRAGMA,
 
@@ -51,30 +58,81 @@ struct ASTNode {
         IMPORT_BLOCK,
     } type;
 
-    uint8_t valueType;
-    BinaryOp binopValue;
-    std::string strValue;
-
-    std::string retType;
-
+    BinaryOp binopValue = PLUS;
     Primitive primitiveValue = Primitive::NONE;
 
-    std::vector<std::shared_ptr<ASTNode>> children;
+    // Set by the TypeChecker on nodes whose runtime type checks it proved can never fail, which the
+    // tree walking interpreter then skips. Never serialized or cloned.
+    bool typeChecked = false;
+
+    // Set by the parser on a FUNCTION declared `const fin`, see ConstEvaluator. Never serialized or cloned.
+    bool constant = false;
+
+    Symbol symbol = 0; // the name or literal text, see strValue()
+    uint32_t line = 0; // source line in the file of the enclosing PRAGMA, 0 if unknown
+
+    union {
+        int32_t intValue = 0; // NUMBER and BOOL: the value, converted once when parsed or unlumped
+        uint32_t frameSize; // FUNCTION and PRAGMA: how many slots the Resolver gave their frame
+    };
+    Symbol retSymbol = 0; // FUNCTION: the return type, see retType()
+
+    ASTChildren children;
+
+    const std::string &strValue() const { return Symbols::name(symbol); }
+    const std::string &retType() const { return Symbols::name(retSymbol); }
+
+    // What the tree walking interpreter rewrites a node into after running it. Guards that fail drop a
+    // node back to GENERIC, see Executor::evaluateExpression. Never serialized or cloned.
+    enum class Quick : uint8_t {
+        NONE,
+        GENERIC,
+        CACHED, // IDENTIFIER: depth and slot, READ: shape and field index, STRING: constant slot
+
+        INT_ADD,
+        INT_SUB,
+        INT_MUL,
+        INT_DIV,
+        INT_MOD,
+        INT_EQ,
+        INT_LESS,
+        INT_GREATER,
+        INT_LESS_EQUAL,
+        INT_GREATER_EQUAL,
+    };
+
+    struct InlineCache {
+        Quick quick = Quick::NONE;
+        uint16_t depth = 0;
+        uint32_t slot = 0;
+        const void *shape = nullptr;
+    } cache;
+
+    // Where the Resolver put the variable a node declares or reads: how many frames up the
+    // environment chain and which slot of that frame. Globals and imports stay UNRESOLVED and are
+    // looked up by name.
+    static constexpr uint32_t UNRESOLVED = UINT32_MAX;
+    struct Address {
+        uint16_t depth = 0;
+        uint32_t slot = UNRESOLVED;
+    } address;
 
     std::shared_ptr<ASTNode> clone() const {
-        auto node = std::make_shared<ASTNode>();
+        auto node = std::allocate_shared<ASTNode>(ASTAllocator<ASTNode>());
         node->type = type;
-        node->valueType = valueType;
         node->binopValue = binopValue;
-        node->strValue = strValue;
-        node->retType = retType;
+        node->symbol = symbol;
+        node->retSymbol = retSymbol;
         node->primitiveValue = primitiveValue;
+        node->line = line;
+        node->intValue = intValue;
         for (const auto &child : children) {
             node->children.push_back(child->clone());
         }
         return node;
     }
 };
+static_assert(sizeof(ASTNode) <= 80);
 
 class Parser;
 using KwHandler = std::function<std::shared_ptr<ASTNode>(Parser*, int)>;
@@ -82,41 +140,27 @@ using KWMAP = std::unordered_map<std::string, KwHandler>;
 
 class Parser {
 public:
-    explicit Parser(const std::vector<Token> &tokens, std::string fileName)
-        : tokens(tokens), fileName(fileName), kwMap(initKwMap()), current(0) {}
+    explicit Parser(TokenStream &tokens, std::string fileName)
+        : tokens(tokens), fileName(fileName), kwMap(initKwMap()) {}
 
+    // The PROGRAM node: a PRAGMA for every module, each import's before the module importing it.
+    // Imported modules are parsed on worker threads, see ModuleLoader in parser.cpp.
     std::shared_ptr<ASTNode> parseProgram();
 
-    void addPragma(const std::shared_ptr<ASTNode>& programNode,
-                   const std::vector<Token> &tokens,
-                   const std::string &fileName);
-
-    Parser* parent = nullptr;
-
-    void saveParsedFile(const std::string &fileLoc) { 
-        if(parent != nullptr) return parent->saveParsedFile(fileLoc);
-        parsedFiles.push_back(fileLoc);
-    }
-    bool isFileParsed(const std::string &fileLoc) const {
-        for(const auto &file : parsedFiles) {
-            if(file == fileLoc) return true;
-        }
-        return false;
-    }
+    // The PRAGMA node of this parser's file alone, and the .lum files it imports in order.
+    std::shared_ptr<ASTNode> parsePragma();
+    std::vector<std::string> importedFiles() const;
 
 private:
-    const std::vector<Token> &tokens;
-    size_t current = 0;
+    TokenStream &tokens;
 
     std::shared_ptr<ASTNode> importBlock, exportBlock;
 
-    std::vector<std::string> parsedFiles;
-
     std::string fileName;
     KWMAP kwMap;
 
-    const Token &peek(size_t n = 0) const;
-    const Token &consume(int amount = 1);
+    Token peek(size_t n = 0) const;
+    Token consume(int amount = 1);
     bool match(Token::Type type, int offset = 0);
     bool matchMultiple(Token::Type type, int amount);
     Token expectMultiple(const std::vector<Token::Type> &types, const std::string &err);
@@ -124,8 +168,6 @@ private:
 
     void error(const std::string &msg) const;
 
-    std::shared_ptr<ASTNode> parseWithPragma(const std::shared_ptr<ASTNode> &programNode, const std::string &currentFile, const std::vector<Token> &currentTokens);
-
     std::shared_ptr<ASTNode> parseArrayLiteral();
     std::shared_ptr<ASTNode> parseArrayLiteralIfBracket();
     std::shared_ptr<ASTNode> parseOptionalArraySize(bool &isArray);
@@ -2,14 +2,23 @@
 #define PARSER_UTILS_H
 
 #include <string>
+#include <string_view>
+#include <optional>
 #include "parser.hpp"
 
 std::string typeToString(Token::Type type);
 std::string astToString(const std::shared_ptr<ASTNode> &node, int indent);
 
-std::shared_ptr<ASTNode> makeTypedNode(ASTNode::Type t, int valueType);
+// line of the token the parser consumed last, nodes made while parsing are stamped with it
+extern thread_local uint32_t parsingLine;
+
 std::shared_ptr<ASTNode> makeNode(ASTNode::Type t);
+// for nodes made after parsing, stamped with the line of the code they stand for
+std::shared_ptr<ASTNode> makeNode(ASTNode::Type t, uint32_t line, Symbol symbol = 0);
 
 std::string astTypeToString(ASTNode::Type type);
 
+// Value of a NUMBER literal's text, whose fraction is dropped. Empty when it does not fit an int.
+std::optional<int32_t> parseNumberLiteral(std::string_view text);
+
 #endif
\ No newline at end of file
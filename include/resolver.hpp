@@ -0,0 +1,48 @@
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#include "parser.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Lexical addressing for the tree walking interpreter. Every variable declared in a function, or in
+// a block of a module, gets a slot in that function's or module's frame, and the nodes declaring or
+// reading it are given its ASTNode::Address. Module level declarations are globals and keep their
+// names, so an unresolved tree still runs, just through name lookups.
+class Resolver {
+public:
+    void resolve(const std::shared_ptr<ASTNode> &root);
+
+private:
+    struct Local {
+        std::string name;
+        uint32_t slot;
+    };
+
+    struct Frame {
+        ASTNode *owner; // FUNCTION or PRAGMA the frame size is written to
+        std::vector<Local> locals;
+        std::vector<size_t> scopes; // locals.size() when each open block began
+        int blockDepth = 0;
+        bool isModule = false;
+    };
+
+    std::vector<Frame> frames;
+
+    void pushFrame(ASTNode &owner, bool isModule);
+    void popFrame();
+    void beginScope();
+    void endScope();
+
+    void declare(ASTNode &node);
+    void use(ASTNode &node);
+
+    void visit(const std::shared_ptr<ASTNode> &node);
+    void visitChildren(const std::shared_ptr<ASTNode> &node, size_t from = 0);
+    void function(const std::shared_ptr<ASTNode> &node);
+    void forStatement(const std::shared_ptr<ASTNode> &node);
+    void assignment(const std::shared_ptr<ASTNode> &node);
+};
+
+#endif
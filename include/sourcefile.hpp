@@ -0,0 +1,35 @@
+#ifndef SOURCEFILE_HPP
+#define SOURCEFILE_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+// The text of a source file, mapped into memory when the file allows it and read into a string
+// otherwise (pipes, files whose size the kernel does not report). Either way it is loaded once and
+// never copied again: the Lexer takes it over and its tokens view text() directly.
+class SourceFile {
+public:
+    // nullopt when the file cannot be opened, with errno left set
+    static std::optional<SourceFile> open(const std::string &path);
+
+    // a source that only exists in memory, like an #alias replacement
+    explicit SourceFile(std::string text) : buffer(std::move(text)), view(buffer) {}
+
+    SourceFile(SourceFile &&other) noexcept;
+    SourceFile(const SourceFile &) = delete;
+    SourceFile &operator=(const SourceFile &) = delete;
+    ~SourceFile();
+
+    std::string_view text() const { return view; }
+
+private:
+    SourceFile() = default;
+
+    std::string buffer; // the text when it is not mapped
+    void *mapping = nullptr;
+    size_t mappedSize = 0;
+    std::string_view view;
+};
+
+#endif
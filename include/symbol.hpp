@@ -0,0 +1,64 @@
+#ifndef SYMBOL_HPP
+#define SYMBOL_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Names interned once for the whole run. Every distinct name gets a 32-bit Symbol, so environments,
+// struct fields and exports key on integers instead of hashing the name at every use. Symbol 0 is
+// the empty name, what an ASTNode holds until it is given one.
+using Symbol = uint32_t;
+
+// Modules are parsed on several threads, so interning takes a lock. Names are stored in blocks that
+// never move once allocated, which lets name() read without one: a thread only ever holds Symbols
+// that intern() returned after the name was stored.
+class Symbols {
+public:
+    static Symbol intern(std::string_view name) {
+        auto &table = instance();
+        std::lock_guard lock(table.mutex);
+        auto it = table.ids.find(name);
+        if (it != table.ids.end()) return it->second;
+
+        Symbol symbol = table.count;
+        if (symbol >> BLOCK_BITS >= table.blocks.size()) throw std::runtime_error("Too many distinct names");
+        auto &block = table.blocks[symbol >> BLOCK_BITS];
+        if (!block) block = std::make_unique<std::string[]>(BLOCK_SIZE);
+        const std::string &stored = block[symbol & (BLOCK_SIZE - 1)] = name;
+        table.ids.emplace(stored, symbol);
+        table.count++;
+        return symbol;
+    }
+
+    static const std::string &name(Symbol symbol) {
+        return instance().blocks[symbol >> BLOCK_BITS][symbol & (BLOCK_SIZE - 1)];
+    }
+
+private:
+    static constexpr uint32_t BLOCK_BITS = 12;
+    static constexpr uint32_t BLOCK_SIZE = 1 << BLOCK_BITS;
+
+    std::mutex mutex;
+    std::array<std::unique_ptr<std::string[]>, 4096> blocks; // by symbol, 16M names in all
+    std::unordered_map<std::string_view, Symbol> ids; // views the blocks
+    Symbol count = 0;
+
+    Symbols() {
+        blocks[0] = std::make_unique<std::string[]>(BLOCK_SIZE);
+        ids.emplace(blocks[0][0], 0);
+        count = 1;
+    }
+
+    static Symbols &instance() {
+        static Symbols symbols;
+        return symbols;
+    }
+};
+
+#endif
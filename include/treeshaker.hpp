@@ -0,0 +1,37 @@
+#ifndef TREESHAKER_HPP
+#define TREESHAKER_HPP
+
+#include "optimizerutils.hpp"
+#include "parser.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Drops the fins, structs and declarations of a literal, in every module, that nothing run from the
+// main module's top level or main can reach, along with their exports, so the .lmp and the start of
+// every engine only carry what the program uses. Every other top level statement is kept and what it
+// names is reached. A name reaches the declarations of that name in its own module, and a READ on an
+// import alias the export of that name in the imported module. An alias used any other way reaches
+// all of the module's exports.
+class TreeShaker {
+public:
+    void shake(const std::shared_ptr<ASTNode> &root);
+
+private:
+    struct Module : ModuleInfo<Module> {
+        std::unordered_map<Symbol, std::vector<const ASTNode *>> declarations; // that can be dropped
+        std::unordered_set<Symbol> live;
+    };
+
+    std::unordered_map<std::string, Module> modules; // by file
+    std::vector<std::pair<Module *, const ASTNode *>> pending; // reached but not yet walked
+
+    void reach(Module &module, Symbol name);
+    void walk(Module &module, const ASTNode &node);
+    void drop(Module &module);
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef TYPECHECKER_HPP
+#define TYPECHECKER_HPP
+
+#include "executor.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Static checking pass run over the whole program, every pragma included, before any engine starts.
+// It infers the types of expressions from literals, declarations and signatures, reports the type
+// errors it can prove, and sets ASTNode::typeChecked on assignments, calls and functions whose
+// runtime checks can never fail. Anything it cannot infer is left to those runtime checks.
+class TypeChecker {
+public:
+    // Returns the errors found, each formatted as "file:line: message".
+    std::vector<std::string> check(const std::shared_ptr<ASTNode> &root);
+
+    // The fin a call proven by the last check runs, null for every other call.
+    const ASTNode *callee(const ASTNode &call) const;
+
+    // Whether expr, built from nothing but literals, operators, struct fields and the parameters of
+    // function, always has function's return type while each parameter holds its declared type.
+    bool returnsDeclaredType(const ASTNode &function, const ASTNode &expr) const;
+
+    // The type the last check proved expr has every time it is evaluated, empty when it is not known.
+    std::optional<Type> expressionType(const ASTNode &expr) const;
+
+private:
+    using Static = std::optional<Type>; // empty when the type is only known while running
+
+    struct Symbol {
+        Static type;
+        const ASTNode *function = nullptr; // FUNCTION node describing a fin or native's signature
+        bool native = false;
+    };
+
+    struct FunctionScope {
+        Type retType;
+        bool returnsChecked = true;
+    };
+
+    // Filled in while checking and only ever grown, so the passes before the reporting one reach a
+    // fixpoint where every type left known stays the same for the whole run.
+    std::unordered_set<const ASTNode *> unstable; // symbols whose type or value may be replaced
+    std::unordered_set<std::string> unstableNames; // assigned somewhere they could not be resolved
+    std::unordered_set<const ASTNode *> opaqueParams; // fins that may be called with missing arguments
+    bool elementsTrusted = true; // false once an array may hold elements not of its element type
+    bool changed = false;
+
+    std::unordered_map<std::string, std::vector<std::pair<std::string, Type>>> structs;
+    std::unordered_set<std::string> declaredStructs;
+
+    std::unordered_map<const ASTNode *, Symbol> symbols; // keyed by the node first declaring it
+    std::vector<std::unordered_map<std::string, const ASTNode *>> scopes;
+    std::vector<Static> selfRefs;
+    std::vector<FunctionScope> functions;
+    std::unordered_set<std::string> exported;
+    bool mainPragma = false;
+
+    std::unordered_map<const ASTNode *, std::string> imports; // alias of a .lum import, the file it names
+    std::unordered_map<std::string, std::unordered_map<std::string, const ASTNode *>> exports; // by file and name
+    std::unordered_map<const ASTNode *, const ASTNode *> callees; // proven call, the FUNCTION it runs
+    std::unordered_map<const ASTNode *, Type> types; // expressions whose type the reporting pass knows
+
+    bool reporting = false;
+    std::string file;
+    uint32_t line = 0;
+    std::vector<std::string> errors;
+
+    void collectStructs(const std::shared_ptr<ASTNode> &node);
+    void pass(const std::shared_ptr<ASTNode> &root);
+
+    void error(const std::string &msg);
+    void prove(ASTNode &node, bool proven);
+    void grow(std::unordered_set<const ASTNode *> &set, const ASTNode *node);
+
+    void declare(const ASTNode &node, Static type, const ASTNode *function = nullptr, bool native = false);
+    const ASTNode *lookup(const std::string &name) const;
+    const ASTNode *importedSymbol(const ASTNode &callee) const;
+    Static typeOf(const ASTNode *symbol) const;
+
+    Static visit(const std::shared_ptr<ASTNode> &node);
+    Static visitNode(const std::shared_ptr<ASTNode> &node);
+    void pragma(const std::shared_ptr<ASTNode> &node);
+    void block(const std::shared_ptr<ASTNode> &node);
+    void function(const std::shared_ptr<ASTNode> &node);
+    void forStatement(const std::shared_ptr<ASTNode> &node);
+    void condition(const std::shared_ptr<ASTNode> &node);
+    void returnStatement(const std::shared_ptr<ASTNode> &node);
+    void index(const std::shared_ptr<ASTNode> &node);
+    Static identifier(const std::shared_ptr<ASTNode> &node, bool callee);
+    Static assignment(const std::shared_ptr<ASTNode> &node);
+    Static propertyAssignment(const std::shared_ptr<ASTNode> &node);
+    Static structAssignment(const std::shared_ptr<ASTNode> &node);
+    Static ndarrayAssignment(const std::shared_ptr<ASTNode> &node);
+    Static arrayLiteral(const std::shared_ptr<ASTNode> &node);
+    Static arrayAccess(const std::shared_ptr<ASTNode> &node);
+    Static arrayAssign(const std::shared_ptr<ASTNode> &node);
+    Static call(const std::shared_ptr<ASTNode> &node);
+    Static binaryOp(const std::shared_ptr<ASTNode> &node);
+    Static unaryOp(const std::shared_ptr<ASTNode> &node);
+    Static read(const std::shared_ptr<ASTNode> &node);
+    Static parameterExpression(const ASTNode &node, const ASTNode &function) const;
+};
+
+#endif
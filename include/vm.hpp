@@ -0,0 +1,119 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#include "bytecode.hpp"
+#include "executor.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+constexpr uint16_t NO_REG = 0xFFFF;
+
+class Compiler {
+public:
+    explicit Compiler(Executor &executor) : executor(executor) {}
+
+    std::shared_ptr<Proto> compileModule(const std::shared_ptr<ASTNode> &pragma);
+
+private:
+    struct Local {
+        std::string name;
+        uint16_t reg;
+    };
+
+    struct FuncState {
+        std::shared_ptr<Proto> proto;
+        FuncState *enclosing = nullptr;
+        std::vector<Local> locals;
+        std::vector<std::pair<size_t, uint16_t>> scopes;
+        std::vector<StaticType> regTypes;
+        std::vector<std::pair<uint16_t, StaticType>> selfRefs;
+        std::vector<size_t> moduleReturns;
+        uint16_t freeReg = 0;
+        int blockDepth = 0;
+        bool isModule = false;
+    };
+
+    Executor &executor;
+    FuncState *fs = nullptr;
+
+    size_t emit(Op op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0, int32_t sx = 0);
+    void patch(size_t at);
+    void jumpTo(size_t target);
+
+    uint16_t allocReg(StaticType type = StaticType::Unknown);
+    uint16_t constant(const TypedValue &val);
+    uint16_t name(const std::string &str);
+    uint16_t typeIndex(const Type &type);
+    void error(const std::string &msg);
+    uint16_t floor() const;
+
+    void beginScope();
+    void endScope();
+    std::optional<uint16_t> resolveLocal(const std::string &ident);
+    bool capturesLocal(const std::string &ident);
+    void define(const std::string &ident, uint16_t reg, StaticType type);
+    bool definesGlobal() const;
+
+    void statement(const std::shared_ptr<ASTNode> &node);
+    void block(const ASTChildren &nodes);
+    void ifStatement(const std::shared_ptr<ASTNode> &node);
+    void whileStatement(const std::shared_ptr<ASTNode> &node);
+    void forStatement(const std::shared_ptr<ASTNode> &node);
+    void function(const std::shared_ptr<ASTNode> &node);
+    void nativeStatement(const std::shared_ptr<ASTNode> &node);
+    void structDeclaration(const std::shared_ptr<ASTNode> &node);
+    uint16_t structAssignment(const std::shared_ptr<ASTNode> &node);
+    void assignment(const std::shared_ptr<ASTNode> &node, uint16_t dst);
+    void ndarrayAssignment(const std::shared_ptr<ASTNode> &node, uint16_t dst);
+    void discard(const std::shared_ptr<ASTNode> &node);
+    void jumpIfFalse(const std::shared_ptr<ASTNode> &cond, std::vector<size_t> &jumps);
+
+    StaticType predict(const std::shared_ptr<ASTNode> &node);
+    StaticType expr(const std::shared_ptr<ASTNode> &node, uint16_t dst);
+    std::pair<uint16_t, StaticType> exprAny(const std::shared_ptr<ASTNode> &node);
+    StaticType binaryOp(const std::shared_ptr<ASTNode> &node, uint16_t dst);
+    void call(const std::shared_ptr<ASTNode> &node, uint16_t dst);
+    void arrayLiteral(const std::shared_ptr<ASTNode> &node, uint16_t dst);
+    uint16_t indices(const std::shared_ptr<ASTNode> &indicesNode, bool &single);
+};
+
+struct VMClosure {
+    std::shared_ptr<Proto> proto;
+    ENV env;
+};
+
+class VM {
+public:
+    explicit VM(std::shared_ptr<ASTNode> root, bool dumpBytecode = false);
+    TypedValue run();
+
+    TypedValue call(const VMClosure &closure, const std::vector<std::shared_ptr<TypedValue>> &args);
+
+private:
+    std::shared_ptr<ASTNode> root;
+    bool dumpBytecode;
+    Executor executor;
+    Compiler compiler;
+    ENV globalEnv;
+
+    std::vector<TypedValue> stack;
+    size_t top = 0;
+
+    std::unordered_map<std::string, std::shared_ptr<ASTNode>> pragmas;
+    std::unordered_map<std::string, std::shared_ptr<Proto>> modules;
+    std::unordered_map<std::string, PExportData> exportData;
+    std::vector<std::string> handlingModules;
+
+    void executePragma(const std::shared_ptr<ASTNode> &node, ENV env);
+    void handleImports(const ASTChildren &children, ENV env);
+
+    PFunction makeClosure(const std::shared_ptr<Proto> &proto, ENV env);
+    TypedValue invoke(const VMClosure &closure, size_t base, size_t argc);
+    TypedValue execute(const Proto &proto, ENV env, size_t base);
+    void reserve(size_t size);
+};
+
+#endif
@@ -0,0 +1,19 @@
+#!/bin/bash
+# times every engine on the programs in bench/, run from the build directory like runtests.sh
+set -e
+cmake ..
+cmake --build .
+cd ../bench
+for file in ./*.lum; do
+    for engine in ast-nojit ast vm closure; do
+        flags="--engine=$engine"
+        [ "$engine" = ast-nojit ] && flags="--engine=ast --no-jit"
+        start=$(date +%s.%N)
+        output=$(../build/lumin $flags --run "$file")
+        end=$(date +%s.%N)
+        printf "%-16s %-10s %8.3fs  %s\n" "$file" "$engine" "$(echo "$end - $start" | awk '{ print $1 - $3 }')" "$(echo $output)"
+    done
+done
+rm -f ./*.lmp ./*.txt
+cd ../build
+./lexbench
@@ -1,7 +1,79 @@
 #!/bin/bash
 set -e
-cmake .. 
+cmake ..
 cmake --build .
 cd ../test
 ../build/lumin --run ./test.lum
+
+# every engine, and the tree walker's JIT, must print exactly what the plain tree walking interpreter prints
+for engine in ast vm closure; do
+    for file in ./test.lum ./jit.lum; do
+        expected=$(../build/lumin --engine=ast --no-jit --run "$file")
+        actual=$(../build/lumin --engine=$engine --run "$file")
+        if [ "$expected" != "$actual" ]; then
+            echo "Engine $engine differs from ast on $file"
+            diff <(echo "$expected") <(echo "$actual") || true
+            exit 1
+        fi
+    done
+done
+
+# -O2 may only rewrite what no engine can tell apart
+for file in ./test.lum ./jit.lum ./optimize.lum; do
+    expected=$(../build/lumin --engine=ast --no-jit --run "$file")
+    for engine in ast vm closure; do
+        actual=$(../build/lumin -O2 --engine=$engine --run "$file")
+        if [ "$expected" != "$actual" ]; then
+            echo "Engine $engine at -O2 differs from ast on $file"
+            diff <(echo "$expected") <(echo "$actual") || true
+            exit 1
+        fi
+    done
+done
+
+# and each -O2 pass must have rewritten what is lumped, astdebug.txt holds the optimized tree
+../build/lumin -O2 --lmp ./optimize.lum
+has() { grep -F -A"$2" "$1" astdebug.txt | grep -qF "$3"; }
+lacks() { ! grep -qF "$1" astdebug.txt; }
+has 'PRIMITIVE_ASSIGNMENT{"cells"}' 2 'NUMBER{"24"}' || { echo "-O2 did not fold 3 * 4 * 2"; exit 1; }
+lacks 'IDENTIFIER{"red"}' || { echo "-O2 did not inline red"; exit 1; }
+lacks 'PRIMITIVE_ASSIGNMENT{"unusedGlobal"}' || { echo "-O2 did not drop unusedGlobal"; exit 1; }
+has 'PRIMITIVE_ASSIGNMENT{"0invariant"}' 0 'invariant' || { echo "-O2 did not hoist a loop invariant"; exit 1; }
+has 'PRIMITIVE_ASSIGNMENT{"fib20"}' 1 'NUMBER{"6765"}' || { echo "fib(20) was not evaluated before lumping"; exit 1; }
+has 'PRIMITIVE_ASSIGNMENT{"lut"}' 1 'ARRAY_LITERAL' || { echo "lut was not lumped as an array literal"; exit 1; }
+lacks 'FUNCTION{"fib"}' || { echo "-O2 did not drop fib"; exit 1; }
+lacks 'STRING{"mix"}' && lacks 'FUNCTION{"gamma"}' || { echo "-O2 did not drop the unused exports of optimizemod.lum"; exit 1; }
+
+# programs translated with --emit-cpp must print the same as well
+if command -v c++ > /dev/null; then
+    for file in ./test.lum ./jit.lum ./aot.lum ./optimize.lum; do
+        name=$(basename "$file" .lum)
+        ../build/lumin --emit-cpp "$file"
+        c++ -std=c++20 -O2 -I ../runtime "$name.cpp" ../build/liblumin_runtime.a -o "../build/aot_$name"
+        expected=$(../build/lumin --engine=ast --no-jit --run "$file")
+        actual=$("../build/aot_$name")
+        rm -f "$name.cpp"
+        if [ "$expected" != "$actual" ]; then
+            echo "--emit-cpp output differs from ast on $file"
+            diff <(echo "$expected") <(echo "$actual") || true
+            exit 1
+        fi
+    done
+fi
+
+# type errors are all reported up front, with their lines, and stop the program from running
+actual=$(../build/lumin --run ./typeerrors.lum 2>&1) && { echo "typeerrors.lum ran"; exit 1; }
+expected="./typeerrors.lum:15: Function return type mismatch - got int but expected string
+./typeerrors.lum:19: Incompatible types for assignment; expected int but got string
+./typeerrors.lum:20: Expected type int but got string
+./typeerrors.lum:20: Incompatible types for assignment; expected string but got int
+./typeerrors.lum:21: Type mismatch for field at index 1
+./typeerrors.lum:22: Incompatible types for assignment; expected int but got bool for field: y
+./typeerrors.lum:23: Expected boolean value
+./typeerrors.lum:24: Array literal elements must have the same type: got string but expected int"
+if [ "$expected" != "$actual" ]; then
+    echo "Type errors differ on ./typeerrors.lum"
+    diff <(echo "$expected") <(echo "$actual") || true
+    exit 1
+fi
 cd ../build
@@ -0,0 +1,134 @@
+#include "lumin_runtime.hpp"
+#include <iterator>
+
+namespace lumin {
+
+void indexError(int index) {
+    throw std::runtime_error("Array index out of bounds: " + std::to_string(index));
+}
+
+void missingReturn(const char *expected) {
+    throw std::runtime_error(std::string("Function return type mismatch - got nil but expected ") + expected);
+}
+
+std::vector<int> indices(std::initializer_list<Span> spans) {
+    std::vector<int> result;
+    for (const auto &span : spans)
+        for (int i = span.start; i <= span.end; ++i) result.push_back(i);
+    return result;
+}
+
+Array<int> range(int start, int end) {
+    std::vector<int> result;
+    for (int i = start; i <= end; ++i) result.push_back(i);
+    return Array<int>(std::move(result));
+}
+
+Array<int> join(std::initializer_list<Array<int>> parts) {
+    std::vector<int> result;
+    for (const auto &part : parts) result.insert(result.end(), part.begin(), part.end());
+    return Array<int>(std::move(result));
+}
+
+void write(std::ostream &out, int value) { out << value; }
+void write(std::ostream &out, bool value) { out << (value ? "true" : "false"); }
+void write(std::ostream &out, const std::string &value) { out << value; }
+void write(std::ostream &out, Nil) { out << "nil"; }
+
+void writeField(std::ostream &out, const std::string &value) {
+    out << "\"" << value << "\"";
+}
+
+void File::write(std::ostream &out) const {
+    out << "File{filename: ";
+    writeField(out, l_filename);
+    out << ", size: " << l_size << ", is_open: " << (l_is_open ? "true" : "false") << "}";
+}
+
+std::string concat(const std::string &lhs, const std::string &rhs) {
+    return lhs + rhs;
+}
+
+std::string repeat(const std::string &value, int count) {
+    std::string result;
+    for (int i = 0; i < count; ++i) result += value;
+    return result;
+}
+
+int printf(std::string format, std::initializer_list<std::string> args) {
+    size_t pos = 0;
+    auto arg = args.begin();
+    while (arg != args.end() && (pos = format.find("{}", pos)) != std::string::npos) {
+        format.replace(pos, 2, *arg);
+        pos += arg->size();
+        ++arg;
+    }
+    std::cout << format;
+    return 0;
+}
+
+std::shared_ptr<File> fopen(const std::string &filename, const std::string &mode) {
+    std::ios_base::openmode openMode = std::ios::binary;
+    if (mode == "r") openMode = std::ios::in | std::ios::binary;
+    else if (mode == "w") openMode = std::ios::out | std::ios::binary | std::ios::trunc;
+    else if (mode == "a") openMode = std::ios::out | std::ios::binary | std::ios::app;
+    else throw std::runtime_error("Invalid file mode: " + mode);
+
+    auto stream = std::make_shared<std::fstream>(filename, openMode);
+    if (!stream->is_open()) throw std::runtime_error("Failed to open file: " + filename);
+
+    auto file = std::make_shared<File>();
+    file->l_filename = filename;
+    file->stream = stream;
+    return file;
+}
+
+int fclose(const std::shared_ptr<File> &file) {
+    if (file->stream && file->stream->is_open()) file->stream->close();
+    file->l_is_open = false;
+    return 0;
+}
+
+static std::fstream &openStream(const File &file) {
+    if (!file.stream || !file.stream->is_open()) throw std::runtime_error("File is not open");
+    return *file.stream;
+}
+
+int fwrite(const std::shared_ptr<File> &file, const std::string &data) {
+    auto &stream = openStream(*file);
+    stream << data;
+    stream.flush();
+    stream.seekp(0, std::ios::end);
+    file->l_size = static_cast<int>(stream.tellp());
+    return 0;
+}
+
+std::string fread(const std::shared_ptr<File> &file) {
+    auto &stream = openStream(*file);
+    stream.seekg(0, std::ios::beg);
+    return std::string((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+}
+
+std::string fread(const std::shared_ptr<File> &file, int count) {
+    auto &stream = openStream(*file);
+    stream.seekg(0, std::ios::beg);
+    std::string buf(count > 0 ? count : 0, '\0');
+    stream.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+    buf.resize(stream.gcount());
+    return buf;
+}
+
+int run(void (*init)(), void (*main)()) {
+    try {
+        init();
+        if (main) main();
+    } catch (const std::exception &e) {
+        std::cout.flush();
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+    std::cout.flush();
+    return 0;
+}
+
+} // namespace lumin
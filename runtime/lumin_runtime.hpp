@@ -0,0 +1,213 @@
+#ifndef LUMIN_RUNTIME_HPP
+#define LUMIN_RUNTIME_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runtime for programs translated by lumin --emit-cpp. Values keep Lumin's semantics: arrays and
+// structs are shared references, printing matches Executor::printValue and errors are thrown as
+// std::runtime_error with the interpreter's messages.
+namespace lumin {
+
+struct Nil {};
+
+[[noreturn]] void indexError(int index);
+[[noreturn]] void missingReturn(const char *expected);
+
+template <typename T>
+class Array {
+public:
+    using Storage = std::vector<T>;
+
+    Array() : items(std::make_shared<Storage>()) {}
+    Array(std::initializer_list<T> init) : items(std::make_shared<Storage>(init)) {}
+    explicit Array(Storage elements) : items(std::make_shared<Storage>(std::move(elements))) {}
+
+    static Array filled(int count, const T &value) {
+        return Array(Storage(count > 0 ? count : 0, value));
+    }
+
+    int length() const { return static_cast<int>(items->size()); }
+
+    typename Storage::reference at(int index) const {
+        if (index < 0 || index >= length()) indexError(index);
+        return (*items)[index];
+    }
+
+    Array select(const std::vector<int> &indices) const {
+        Storage result;
+        result.reserve(indices.size());
+        for (int index : indices) result.push_back(at(index));
+        return Array(std::move(result));
+    }
+
+    // values past the end of an array right hand side repeat its last element
+    const Array &assign(const std::vector<int> &indices, const Array &values) const {
+        Storage copy = *values.items;
+        if (copy.empty()) return *this;
+        for (size_t i = 0; i < indices.size(); ++i) at(indices[i]) = copy[i < copy.size() ? i : copy.size() - 1];
+        return *this;
+    }
+
+    const Array &assign(const std::vector<int> &indices, const T &value) const {
+        for (int index : indices) at(index) = value;
+        return *this;
+    }
+
+    typename Storage::iterator begin() const { return items->begin(); }
+    typename Storage::iterator end() const { return items->end(); }
+
+    Storage &elements() const { return *items; }
+
+private:
+    std::shared_ptr<Storage> items;
+};
+
+// index list of an array access, a single index is a range with start == end
+struct Span {
+    Span(int index) : start(index), end(index) {}
+    Span(int start, int end) : start(start), end(end) {}
+    int start, end;
+};
+std::vector<int> indices(std::initializer_list<Span> spans);
+
+Array<int> range(int start, int end);
+Array<int> join(std::initializer_list<Array<int>> parts);
+
+struct File {
+    std::string l_filename;
+    int l_size = 0;
+    bool l_is_open = true;
+    std::shared_ptr<std::fstream> stream;
+
+    void write(std::ostream &out) const;
+};
+
+void write(std::ostream &out, int value);
+void write(std::ostream &out, bool value);
+void write(std::ostream &out, const std::string &value);
+void write(std::ostream &out, Nil);
+
+template <typename S>
+void write(std::ostream &out, const std::shared_ptr<S> &value) {
+    value->write(out);
+}
+
+template <typename T>
+void write(std::ostream &out, const Array<T> &value) {
+    out << "[";
+    bool first = true;
+    for (const auto &element : value.elements()) {
+        if (!first) out << ", ";
+        write(out, static_cast<const T &>(element));
+        first = false;
+    }
+    out << "]";
+}
+
+// struct fields quote their strings
+template <typename T>
+void writeField(std::ostream &out, const T &value) {
+    write(out, value);
+}
+void writeField(std::ostream &out, const std::string &value);
+
+// int arithmetic wraps around like it does on every engine, where C++ would leave overflow undefined
+inline int add(int lhs, int rhs) { return static_cast<int>(static_cast<uint32_t>(lhs) + static_cast<uint32_t>(rhs)); }
+inline int sub(int lhs, int rhs) { return static_cast<int>(static_cast<uint32_t>(lhs) - static_cast<uint32_t>(rhs)); }
+inline int mul(int lhs, int rhs) { return static_cast<int>(static_cast<uint32_t>(lhs) * static_cast<uint32_t>(rhs)); }
+inline int neg(int value) { return static_cast<int>(0u - static_cast<uint32_t>(value)); }
+
+template <typename T>
+std::string concat(const std::string &lhs, const T &rhs) {
+    std::ostringstream str;
+    str << lhs;
+    write(str, rhs);
+    return str.str();
+}
+std::string concat(const std::string &lhs, const std::string &rhs);
+std::string repeat(const std::string &value, int count);
+
+template <typename... Args>
+int print(const Args &...args) {
+    (write(std::cout, args), ...);
+    return 0;
+}
+
+template <typename... Args>
+int println(const Args &...args) {
+    (write(std::cout, args), ...);
+    std::cout << '\n';
+    return 0;
+}
+
+int printf(std::string format, std::initializer_list<std::string> args);
+
+std::shared_ptr<File> fopen(const std::string &filename, const std::string &mode);
+int fclose(const std::shared_ptr<File> &file);
+int fwrite(const std::shared_ptr<File> &file, const std::string &data);
+std::string fread(const std::shared_ptr<File> &file);
+std::string fread(const std::shared_ptr<File> &file, int count);
+
+// NDArray elements cycle through an array right hand side
+inline int ndElement(int value, int) { return value; }
+inline int ndElement(const Array<int> &value, int flatIndex) {
+    return value.length() == 0 ? 0 : value.elements()[flatIndex % value.length()];
+}
+
+inline int ndSize(std::initializer_list<int> shape) {
+    int total = 1;
+    for (int dim : shape) total *= dim;
+    return total;
+}
+
+template <typename V>
+Array<int> ndFill(std::initializer_list<int> shape, const V &value) {
+    int total = ndSize(shape);
+    std::vector<int> result(total > 0 ? total : 0);
+    for (int flatIndex = 0; flatIndex < total; ++flatIndex) result[flatIndex] = ndElement(value, flatIndex);
+    return Array<int>(std::move(result));
+}
+
+// @ is the flat index
+template <typename F>
+Array<int> ndFlat(std::initializer_list<int> shape, F element) {
+    int total = ndSize(shape);
+    std::vector<int> result(total > 0 ? total : 0);
+    for (int flatIndex = 0; flatIndex < total; ++flatIndex) result[flatIndex] = ndElement(element(flatIndex), flatIndex);
+    return Array<int>(std::move(result));
+}
+
+// @ is the index array, advanced in place like the interpreter does
+template <typename F>
+Array<int> ndIndex(std::initializer_list<int> shape, F element) {
+    std::vector<int> dims(shape);
+    int total = ndSize(shape);
+    std::vector<int> result(total > 0 ? total : 0);
+    Array<int> index = Array<int>::filled(static_cast<int>(dims.size()), 0);
+    auto &at = index.elements();
+    for (int flatIndex = 0; flatIndex < total; ++flatIndex) {
+        result[flatIndex] = ndElement(element(static_cast<const Array<int> &>(index)), flatIndex);
+        for (int d = static_cast<int>(dims.size()) - 1; d >= 0; --d) {
+            if (++at[d] < dims[d]) break;
+            at[d] = 0;
+        }
+    }
+    return Array<int>(std::move(result));
+}
+
+// runs an entry module and its main, reporting errors like an uncaught interpreter exception would
+int run(void (*init)(), void (*main)());
+
+} // namespace lumin
+
+#endif
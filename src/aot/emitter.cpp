@@ -0,0 +1,1075 @@
+#include "cppemitter.hpp"
+#include "optimizerutils.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <stdexcept>
+
+static std::string quote(const std::string &str) {
+    std::string result = "\"";
+    for (unsigned char c : str) {
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            case '\r': result += "\\r"; break;
+            case '?': result += "\\?"; break; // no trigraphs
+            default:
+                if (c < 0x20 || c == 0x7f) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof buf, "\\%03o", c);
+                    result += buf;
+                } else {
+                    result += static_cast<char>(c);
+                }
+        }
+    }
+    return result + "\"";
+}
+
+static std::string sanitize(std::string name) {
+    if (name.ends_with(".lum")) name.resize(name.size() - 4);
+    for (char &c : name)
+        if (!std::isalnum(static_cast<unsigned char>(c))) c = '_';
+    return name;
+}
+
+static std::string join(const std::vector<std::string> &parts) {
+    std::string result;
+    for (size_t i = 0; i < parts.size(); ++i) result += (i ? ", " : "") + parts[i];
+    return result;
+}
+
+// drops the parentheses around a whole expression, for statements and conditions
+static std::string unwrap(const std::string &code) {
+    if (code.size() < 2 || code.front() != '(' || code.back() != ')') return code;
+    int depth = 0;
+    for (size_t i = 0; i + 1 < code.size(); ++i) {
+        if (code[i] == '(') depth++;
+        else if (code[i] == ')' && --depth == 0) return code;
+    }
+    return code.substr(1, code.size() - 2);
+}
+
+static bool sideEffects(const std::shared_ptr<ASTNode> &node) {
+    if (!node) return false;
+    switch (node->type) {
+        case ASTNode::Type::CALL:
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT:
+        case ASTNode::Type::STRUCT_ASSIGNMENT:
+        case ASTNode::Type::NDARRAY_ASSIGN:
+        case ASTNode::Type::ARRAY_ASSIGN:
+            return true;
+        default:
+            return std::any_of(node->children.begin(), node->children.end(), sideEffects);
+    }
+}
+
+// Lumin evaluates operands and arguments left to right while C++ leaves their order unspecified
+static bool needsOrder(const std::vector<std::shared_ptr<ASTNode>> &nodes) {
+    size_t effects = 0, values = 0;
+    for (const auto &node : nodes) {
+        if (sideEffects(node)) effects++;
+        if (!isLiteral(*node)) values++;
+    }
+    return effects > 0 && values > 1;
+}
+
+static bool mentions(const std::shared_ptr<ASTNode> &node, const std::string &ident) {
+    if (!node) return false;
+    if (node->type == ASTNode::Type::IDENTIFIER && node->strValue() == ident) return true;
+    return std::any_of(node->children.begin(), node->children.end(),
+                       [&ident](const auto &child) { return mentions(child, ident); });
+}
+
+static bool alwaysReturns(const std::shared_ptr<ASTNode> &node) {
+    if (!node) return false;
+    switch (node->type) {
+        case ASTNode::Type::RETURN_STATEMENT: return true;
+        case ASTNode::Type::BLOCK: return std::any_of(node->children.begin(), node->children.end(), alwaysReturns);
+        case ASTNode::Type::IF_STATEMENT:
+            return node->children.size() > 2 && node->children[2]->type == ASTNode::Type::ELSE_STATEMENT &&
+                   alwaysReturns(node->children[1]) && alwaysReturns(node->children[2]->children[0]);
+        default: return false;
+    }
+}
+
+static bool containsReturn(const std::shared_ptr<ASTNode> &node) {
+    if (!node || node->type == ASTNode::Type::FUNCTION) return false;
+    if (node->type == ASTNode::Type::RETURN_STATEMENT) return true;
+    return std::any_of(node->children.begin(), node->children.end(), containsReturn);
+}
+
+static bool declares(const std::shared_ptr<ASTNode> &node, const std::string &ident) {
+    switch (node->type) {
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: return node->primitiveValue != Primitive::NONE && node->strValue() == ident;
+        case ASTNode::Type::STRUCT_ASSIGNMENT:
+        case ASTNode::Type::NDARRAY_ASSIGN: return node->strValue() == ident;
+        default: return false;
+    }
+}
+
+static void incompatible(const Type &expected, const Type &got, const std::string &field = "") {
+    throw std::runtime_error("Incompatible types for assignment; expected " + expected.toString() +
+                             " but got " + got.toString() + (field.empty() ? "" : " for field: " + field));
+}
+
+static std::string defaultValue(Primitive prim) {
+    switch (prim) {
+        case Primitive::INT: return "0";
+        case Primitive::BOOL: return "false";
+        case Primitive::STRING: return "std::string()";
+        default: throw std::runtime_error("Invalid primitive value");
+    }
+}
+
+static const char *binaryOperator(BinaryOp op) {
+    switch (op) {
+        case PLUS:          return "+";
+        case MINUS:         return "-";
+        case MULTIPLY:      return "*";
+        case DIVIDE:        return "/";
+        case MODULUS:       return "%";
+        case COMPARISON:    return "==";
+        case LESS:          return "<";
+        case GREATER:       return ">";
+        case LESS_EQUAL:    return "<=";
+        case GREATER_EQUAL: return ">=";
+        default: throw std::runtime_error("Unsupported binary op");
+    }
+}
+
+// + - and * go through the runtime so they wrap around instead of overflowing
+static const char *wrappingHelper(BinaryOp op) {
+    switch (op) {
+        case PLUS:     return "add";
+        case MINUS:    return "sub";
+        case MULTIPLY: return "mul";
+        default:       return nullptr;
+    }
+}
+
+static bool isNative(const std::string &name, bool outstream, bool filestream) {
+    if (outstream && (name == "print" || name == "println" || name == "printf")) return true;
+    return filestream && (name == "fopen" || name == "fclose" || name == "fwrite" || name == "fread");
+}
+
+CppEmitter::CppEmitter(std::shared_ptr<ASTNode> root) : root(root), executor(root) {}
+
+void CppEmitter::fail(const std::string &msg) {
+    throw std::runtime_error("Cannot emit C++: " + msg);
+}
+
+void CppEmitter::line(const std::string &text) {
+    *out << std::string(indent * 4, ' ') << text << "\n";
+}
+
+std::string CppEmitter::temp() {
+    return "lumin_t" + std::to_string(temps++);
+}
+
+std::string CppEmitter::emit() {
+    if (root->children.empty()) fail("empty program");
+    for (const auto &pragma : root->children) {
+        Module mod;
+        mod.pragma = pragma;
+        mod.ns = "m" + std::to_string(modules.size()) + "_" + sanitize(pragma->strValue());
+        moduleIndex[pragma->strValue()] = modules.size();
+        modules.push_back(std::move(mod));
+    }
+    for (auto &mod : modules) collect(mod);
+
+    std::vector<size_t> sorted;
+    std::vector<int> state(modules.size(), 0);
+    order(modules.size() - 1, sorted, state);
+
+    std::ostringstream code;
+    code << "// Generated by lumin --emit-cpp from " << root->children.back()->strValue() << "\n";
+    code << "#include \"lumin_runtime.hpp\"\n\n";
+
+    // struct fields only hold shared pointers, so declaring every struct up front is enough
+    for (size_t i : sorted) {
+        if (modules[i].structs.empty()) continue;
+        code << "namespace " << modules[i].ns << " {\n";
+        for (const auto &name : modules[i].structs) code << "struct S_" << name << ";\n";
+        for (const auto &name : modules[i].structs) {
+            code << "\nstruct S_" << name << " {\n";
+            for (const auto &[field, type] : structs.at(name).type->fields)
+                code << "    " << cppType(type) << " l_" << Symbols::name(field) << ";\n";
+            code << "\n    void write(std::ostream &out) const;\n};\n";
+        }
+        code << "} // namespace " << modules[i].ns << "\n\n";
+    }
+    for (size_t i : sorted) {
+        for (const auto &name : modules[i].structs) {
+            const auto &fields = structs.at(name).type->fields;
+            code << "void " << structs.at(name).cppName << "::write(std::ostream &out) const {\n";
+            code << "    out << " << quote(name + "{") << ";\n";
+            for (size_t f = 0; f < fields.size(); ++f) {
+                const std::string &field = Symbols::name(fields[f].first);
+                code << "    out << " << quote((f ? ", " : "") + field + ": ") << ";\n";
+                code << "    lumin::writeField(out, l_" << field << ");\n";
+            }
+            code << "    out << \"}\";\n}\n\n";
+        }
+    }
+
+    for (size_t i : sorted) emitModule(code, modules[i]);
+
+    const Module &entry = modules.back();
+    std::string mainCall = "nullptr";
+    if (auto it = entry.globals.find("main"); it != entry.globals.end())
+        fail("main is not a function type - received " + it->second.toString());
+    if (auto it = entry.functions.find("main"); it != entry.functions.end()) {
+        std::vector<std::string> args;
+        for (const auto &param : it->second->params) {
+            if (!param.vararg) fail("Missing argument for parameter: " + param.ident);
+            args.push_back(cppType(param.type.array()) + "()");
+        }
+        mainCall = "[] { " + entry.ns + "::l_main(" + join(args) + "); }";
+    }
+    code << "int main() {\n    return lumin::run(" << entry.ns << "::init, " << mainCall << ");\n}\n";
+    return code.str();
+}
+
+void CppEmitter::collect(Module &mod) {
+    const auto &children = mod.pragma->children;
+    const auto &maps = getImportMaps();
+    for (const auto &child : children[0]->children) {
+        const std::string &name = child->strValue();
+        if (name.ends_with(".lum")) {
+            if (!moduleIndex.contains(name)) fail("Unknown pragma: " + name);
+            mod.imports.push_back(name);
+            mod.aliases[child->children[0]->strValue()] = name;
+        } else if (name == "outstream") {
+            mod.outstream = true;
+        } else if (name == "filestream") {
+            mod.filestream = true;
+            if (!structs.contains("File")) {
+                auto file = std::make_shared<StructType>("File");
+                file->fields = {{Symbols::intern("filename"), Type(Primitive::STRING)},
+                                {Symbols::intern("size"), Type(Primitive::INT)},
+                                {Symbols::intern("is_open"), Type(Primitive::BOOL)}};
+                structs["File"] = {file, "lumin::File"};
+            }
+        } else if (maps.contains(name)) {
+            fail("module " + name + " has no C++ runtime");
+        } else {
+            fail("Unknown module: " + name);
+        }
+    }
+    for (const auto &exportNode : children[1]->children) mod.exports.push_back(exportNode->strValue());
+
+    for (size_t i = 2; i < children.size(); ++i) {
+        const auto &node = children[i];
+        if (node->type == ASTNode::Type::FUNCTION) {
+            if (mod.functions.contains(node->strValue())) fail("function " + node->strValue() + " is defined twice");
+            mod.functions[node->strValue()] = executor.executeFunctionDefinition(node, nullptr);
+            mod.functionNodes.push_back(node);
+        } else if (node->type == ASTNode::Type::STRUCT_DECLARE) {
+            // struct types are looked up by name alone, so they have to be unique across modules
+            if (structs.contains(node->strValue())) fail("struct " + node->strValue() + " is declared more than once");
+            auto structType = std::make_shared<StructType>(node->strValue());
+            for (const auto &field : node->children) {
+                if (field->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT)
+                    structType->fields.emplace_back(field->symbol, field->primitiveValue);
+                else
+                    structType->fields.emplace_back(field->symbol, field->children[0]->strValue());
+            }
+            structs[node->strValue()] = {structType, mod.ns + "::S_" + node->strValue()};
+            mod.structs.push_back(node->strValue());
+        }
+    }
+}
+
+// dependencies come before the modules importing them
+void CppEmitter::order(size_t index, std::vector<size_t> &result, std::vector<int> &state) {
+    if (state[index] == 2) return;
+    if (state[index] == 1) fail("Circular import: " + modules[index].pragma->strValue());
+    state[index] = 1;
+    for (const auto &name : modules[index].imports) order(moduleIndex.at(name), result, state);
+    state[index] = 2;
+    result.push_back(index);
+}
+
+void CppEmitter::emitModule(std::ostringstream &code, Module &mod) {
+    module = &mod;
+    const auto &children = mod.pragma->children;
+
+    // module level code goes first, its declarations decide the types of the globals functions use
+    std::ostringstream init;
+    out = &init;
+    indent = 1;
+    for (const auto &name : mod.imports) line(modules[moduleIndex.at(name)].ns + "::init();");
+    for (size_t i = 2; i < children.size(); ++i) {
+        // a top level return only ends the statement it appears in
+        if (containsReturn(children[i])) {
+            line("[&] {");
+            indent++;
+            statement(children[i]);
+            indent--;
+            line("}();");
+        } else {
+            statement(children[i]);
+        }
+    }
+    for (const auto &name : mod.exports)
+        if (!mod.globals.contains(name) && !mod.functions.contains(name))
+            fail("Cannot export undefined variable: " + name);
+
+    std::ostringstream functions;
+    for (const auto &node : mod.functionNodes) emitFunction(functions, node);
+
+    code << "namespace " << mod.ns << " {\n\n";
+    for (const auto &name : mod.globalOrder) code << cppType(mod.globals.at(name)) << " l_" << name << ";\n";
+    if (!mod.globalOrder.empty()) code << "\n";
+    for (const auto &node : mod.functionNodes) code << signature(node->strValue(), *mod.functions.at(node->strValue())) << ";\n";
+    if (!mod.functionNodes.empty()) code << "\n";
+    code << functions.str();
+    code << "void init() {\n    static bool done = false;\n    if (done) return;\n    done = true;\n";
+    code << init.str() << "}\n\n} // namespace " << mod.ns << "\n\n";
+    module = nullptr;
+}
+
+void CppEmitter::emitFunction(std::ostringstream &code, const std::shared_ptr<ASTNode> &node) {
+    const _FunctionData &fn = *module->functions.at(node->strValue());
+    function = &fn;
+    out = &code;
+    indent = 0;
+    line(signature(node->strValue(), fn) + " {");
+    indent = 1;
+
+    scopes.assign(1, {});
+    for (const auto &param : fn.params) scopes.back()[param.ident] = param.vararg ? param.type.array() : param.type;
+
+    functionBody(fn);
+
+    indent = 0;
+    line("}");
+    line("");
+    popScopes(0);
+    function = nullptr;
+}
+
+// Declared before it is assigned, so the fin can call itself. It captures by reference, like a fin
+// shares the environment it was declared in.
+void CppEmitter::emitLocalFunction(const std::shared_ptr<ASTNode> &node) {
+    const std::string &name = node->strValue();
+    if (scopes.back().contains(name)) fail(name + " is declared twice in one scope");
+    FunctionData fn = executor.executeFunctionDefinition(node, nullptr);
+    scopes.back()[name] = Type(BaseType::Function);
+    localFunctions.push_back({scopes.size(), name, fn});
+
+    std::vector<std::string> types, params;
+    for (const auto &param : fn->params) {
+        types.push_back(cppType(param.vararg ? param.type.array() : param.type));
+        params.push_back(types.back() + " l_" + param.ident);
+    }
+    line("std::function<" + cppType(fn->retType) + "(" + join(types) + ")> l_" + name + ";");
+    line("l_" + name + " = [&](" + join(params) + ") -> " + cppType(fn->retType) + " {");
+
+    const _FunctionData *outer = function;
+    std::vector<Value> outerSelfRefs = std::move(selfRefs);
+    size_t depth = scopes.size();
+    function = fn.get();
+    selfRefs.clear();
+    indent++;
+    scopes.emplace_back();
+    for (const auto &param : fn->params) scopes.back()[param.ident] = param.vararg ? param.type.array() : param.type;
+    functionBody(*fn);
+    popScopes(depth);
+    indent--;
+    line("};");
+    function = outer;
+    selfRefs = std::move(outerSelfRefs);
+}
+
+// The statements of a fin, with the parameters already in the innermost scope.
+void CppEmitter::functionBody(const _FunctionData &fn) {
+    // the body block is a scope of its own, C++ only allows that to shadow a parameter one level down
+    const auto &bodyNode = fn.body;
+    bool shadows = bodyNode->type == ASTNode::Type::BLOCK && std::any_of(fn.params.begin(), fn.params.end(),
+        [&bodyNode](const Parameter &param) {
+            return std::any_of(bodyNode->children.begin(), bodyNode->children.end(),
+                               [&param](const auto &child) { return declares(child, param.ident); });
+        });
+    if (shadows) {
+        line("{");
+        indent++;
+    }
+    if (bodyNode->type == ASTNode::Type::BLOCK) {
+        scopes.emplace_back();
+        for (const auto &child : bodyNode->children) statement(child);
+    } else {
+        statement(bodyNode);
+    }
+    if (shadows) {
+        indent--;
+        line("}");
+    }
+    if (!alwaysReturns(bodyNode))
+        line(fn.retType.match(BaseType::NIL) ? "return {};" : "lumin::missingReturn(\"" + fn.retType.toString() + "\");");
+}
+
+std::string CppEmitter::cppType(const Type &type) const {
+    switch (type.kind()) {
+        case BaseType::Int: return "int";
+        case BaseType::Bool: return "bool";
+        case BaseType::String: return "std::string";
+        case BaseType::NIL: return "lumin::Nil";
+        case BaseType::Array: return "lumin::Array<" + (type.hasElement() ? cppType(type.element()) : "lumin::Nil") + ">";
+        case BaseType::Struct: return "std::shared_ptr<" + structInfo(type.name()).cppName + ">";
+        default: fail("values of type " + type.toString() + " are not supported");
+    }
+}
+
+std::string CppEmitter::signature(const std::string &name, const _FunctionData &fn) const {
+    std::vector<std::string> params;
+    for (const auto &param : fn.params)
+        params.push_back(cppType(param.vararg ? param.type.array() : param.type) + " l_" + param.ident);
+    return cppType(fn.retType) + " l_" + name + "(" + join(params) + ")";
+}
+
+const CppEmitter::StructInfo &CppEmitter::structInfo(const std::string &name) const {
+    auto it = structs.find(name);
+    if (it == structs.end()) throw std::runtime_error("Unknown struct type: " + name);
+    return it->second;
+}
+
+void CppEmitter::statement(const std::shared_ptr<ASTNode> &node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case ASTNode::Type::BLOCK:
+            line("{");
+            body(node);
+            line("}");
+            return;
+        case ASTNode::Type::STRUCT_DECLARE:
+            if (function || !scopes.empty()) fail("struct " + node->strValue() + " is not declared at module level");
+            return;
+        case ASTNode::Type::FUNCTION:
+            if (function || !scopes.empty()) emitLocalFunction(node);
+            return;
+        case ASTNode::Type::NATIVE_STATEMENT:
+            fail("native function " + node->strValue() + " has no C++ runtime");
+        case ASTNode::Type::RETURN_STATEMENT: {
+            if (!function) {
+                if (!node->children.empty()) line("(void)" + expr(node->children[0]).code + ";");
+                line("return;");
+                return;
+            }
+            if (node->children.empty()) {
+                line(function->retType.match(BaseType::NIL)
+                    ? "return {};" : "lumin::missingReturn(\"" + function->retType.toString() + "\");");
+                return;
+            }
+            Value value = expr(node->children[0]);
+            if (!function->retType.match(value.type))
+                throw std::runtime_error("Function return type mismatch - got " + value.type.toString() +
+                                         " but expected " + function->retType.toString());
+            line("return " + unwrap(value.code) + ";");
+            return;
+        }
+        case ASTNode::Type::IF_STATEMENT:
+            line("if (" + condition(node->children[0]) + ") {");
+            body(node->children[1]);
+            if (node->children.size() > 2 && node->children[2]->type == ASTNode::Type::ELSE_STATEMENT) {
+                line("} else {");
+                body(node->children[2]->children[0]);
+            }
+            line("}");
+            return;
+        case ASTNode::Type::WHILE_STATEMENT:
+            line("while (" + condition(node->children[0]) + ") {");
+            body(node->children[1]);
+            line("}");
+            return;
+        case ASTNode::Type::FOR_STATEMENT: {
+            scopes.emplace_back();
+            if (node->strValue() == "0") {
+                line("{");
+                indent++;
+                statement(node->children[0]);
+                std::string cond = condition(node->children[1]);
+                std::string update = unwrap(expr(node->children[2]).code);
+                line("for (; " + cond + "; " + update + ") {");
+                body(node->children[3]);
+                line("}");
+                indent--;
+                line("}");
+            } else {
+                Value iterable = expr(node->children[1]);
+                if (!iterable.type.match(BaseType::Array)) throw std::runtime_error("Expected array for enhanced for loop");
+                const std::string &var = node->children[0]->strValue();
+                Type element = iterable.type.element();
+                scopes.back()[var] = element;
+                // iterate a copy of the handle, the loop keeps the elements alive even if the variable is reassigned
+                line("for (" + cppType(element) + " l_" + var + " : " + cppType(iterable.type) + "(" + iterable.code + ")) {");
+                body(node->children[2]);
+                line("}");
+            }
+            popScopes(scopes.size() - 1);
+            return;
+        }
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT:
+            if (node->primitiveValue == Primitive::NONE) break;
+            declare(node->strValue(), declaration(node), node->children.empty() ? nullptr : node->children[0]);
+            return;
+        case ASTNode::Type::STRUCT_ASSIGNMENT:
+            declare(node->strValue(), structAssignment(node), node);
+            return;
+        case ASTNode::Type::NDARRAY_ASSIGN:
+            declare(node->strValue(), ndarrayAssignment(node), node->children.back());
+            return;
+        default:
+            break;
+    }
+
+    line(unwrap(expr(node).code) + ";");
+}
+
+// the statement a branch or loop runs, inside braces the caller already opened
+void CppEmitter::body(const std::shared_ptr<ASTNode> &node) {
+    indent++;
+    if (node && node->type == ASTNode::Type::BLOCK) {
+        scopes.emplace_back();
+        for (const auto &child : node->children) statement(child);
+        popScopes(scopes.size() - 1);
+    } else {
+        statement(node);
+    }
+    indent--;
+}
+
+// Closes every scope past depth, and the fins declared in them.
+void CppEmitter::popScopes(size_t depth) {
+    scopes.resize(depth);
+    std::erase_if(localFunctions, [depth](const LocalFunction &fn) { return fn.depth > depth; });
+}
+
+void CppEmitter::declare(const std::string &ident, const Value &value, const std::shared_ptr<ASTNode> &valueNode) {
+    const Type &type = value.type;
+    auto redeclared = [&](const Type &existing) {
+        fail(ident + " is redeclared as " + type.toString() + " but was " + existing.toString());
+    };
+
+    if (scopes.empty()) {
+        if (module->functions.contains(ident)) fail(ident + " is both a function and a variable");
+        auto it = module->globals.find(ident);
+        if (it == module->globals.end()) {
+            module->globals.emplace(ident, type);
+            module->globalOrder.push_back(ident);
+        } else if (!it->second.match(type)) {
+            redeclared(it->second);
+        }
+        line("l_" + ident + " = " + unwrap(value.code) + ";");
+        return;
+    }
+
+    auto &scope = scopes.back();
+    if (auto it = scope.find(ident); it != scope.end()) {
+        if (!it->second.match(type)) redeclared(it->second);
+        line("l_" + ident + " = " + unwrap(value.code) + ";");
+        return;
+    }
+
+    // the initializer still reads the variable being shadowed
+    std::string init = unwrap(value.code);
+    if (lookup(ident) && mentions(valueNode, ident)) {
+        std::string tmp = temp();
+        line(cppType(type) + " " + tmp + " = " + init + ";");
+        init = tmp;
+    }
+    scope.emplace(ident, type);
+    line(cppType(type) + " l_" + ident + " = " + init + ";");
+}
+
+CppEmitter::Value CppEmitter::declaration(const std::shared_ptr<ASTNode> &node) {
+    Type declared(node->primitiveValue);
+    if (node->children.empty()) return {defaultValue(node->primitiveValue), declared};
+
+    const auto &init = node->children[0];
+    if (init->type == ASTNode::Type::ARRAY_LITERAL) {
+        // the variable takes the literal's type, like the interpreter's inferArrayType
+        Value value = arrayLiteral(init);
+        if (init->children.empty()) incompatible(Type(BaseType::Array), value.type);
+        return value;
+    }
+
+    Value value = expr(init);
+    Type expected = init->type == ASTNode::Type::SIZED_ARRAY_DECLARE ? declared.array() : declared;
+    if (!value.type.match(expected)) incompatible(expected, value.type);
+    return {value.code, expected};
+}
+
+CppEmitter::Value CppEmitter::structAssignment(const std::shared_ptr<ASTNode> &node) {
+    const std::string &name = node->children[0]->strValue();
+    const StructInfo &info = structInfo(name);
+    const auto &fields = info.type->fields;
+    if (node->children.size() - 1 != fields.size())
+        throw std::runtime_error("Struct assignment has incorrect number of arguments");
+
+    std::vector<std::string> args;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        const auto &arg = node->children[i + 1];
+        bool named = arg->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT;
+        Value value = expr(named ? arg->children[0] : arg);
+        if (!value.type.match(fields[i].second)) {
+            throw std::runtime_error(named ? "Type mismatch for field: " + arg->strValue()
+                                           : "Type mismatch for field at index " + std::to_string(i));
+        }
+        args.push_back(value.code);
+    }
+    return {"std::make_shared<" + info.cppName + ">(" + info.cppName + "{" + join(args) + "})", Type(name)};
+}
+
+CppEmitter::Value CppEmitter::ndarrayAssignment(const std::shared_ptr<ASTNode> &node) {
+    const auto &children = node->children;
+    int efficiency = children[0]->intValue;
+
+    std::vector<std::string> shape;
+    for (size_t i = 1; i < children.size() - 1; ++i) {
+        Value dim = expr(children[i]);
+        if (!dim.type.match(BaseType::Int)) throw std::runtime_error("Expected integer value");
+        shape.push_back(dim.code);
+    }
+
+    Type intType(Primitive::INT);
+    std::string self = temp();
+    if (efficiency != 0) selfRefs.push_back({self, efficiency == 1 ? intType : intType.array()});
+    Value rhs = expr(children.back());
+    if (efficiency != 0) selfRefs.pop_back();
+    if (!rhs.type.match(intType) && !rhs.type.match(intType.array()))
+        fail("NDArray elements have to be int, got " + rhs.type.toString());
+
+    std::string dims = "{" + join(shape) + "}";
+    std::string code;
+    switch (efficiency) {
+        case 0: code = "lumin::ndFill(" + dims + ", " + unwrap(rhs.code) + ")"; break;
+        case 1: code = "lumin::ndFlat(" + dims + ", [&](int " + self + ") { return " + unwrap(rhs.code) + "; })"; break;
+        default:
+            code = "lumin::ndIndex(" + dims + ", [&](const lumin::Array<int> &" + self + ") { return " + unwrap(rhs.code) + "; })";
+            break;
+    }
+    return {code, intType.array()};
+}
+
+CppEmitter::Value CppEmitter::assignment(const std::shared_ptr<ASTNode> &node) {
+    const auto &children = node->children;
+    bool emptyLiteral = children.back()->type == ASTNode::Type::ARRAY_LITERAL && children.back()->children.empty();
+
+    // struct property assignment
+    if (children.size() > 1 && children[0]->type == ASTNode::Type::READ) {
+        const auto &readNode = children[0];
+        const std::string &field = readNode->children[1]->strValue();
+        Value obj = expr(readNode->children[0]);
+        if (!obj.type.match(BaseType::Struct))
+            throw std::runtime_error("Left-hand side of assignment is not a struct or object");
+        const auto &fields = structInfo(obj.type.name()).type->fields;
+        auto it = std::find_if(fields.begin(), fields.end(), [&field](const auto &pair) { return Symbols::name(pair.first) == field; });
+        if (it == fields.end()) throw std::runtime_error("Struct does not have field: " + field);
+
+        // anything but a variable is evaluated once into a temporary
+        bool simple = readNode->children[0]->type == ASTNode::Type::IDENTIFIER;
+        std::string holder = simple ? obj.code : temp();
+        std::string target = holder + "->l_" + field;
+        selfRefs.push_back({target, it->second});
+        Value value = expr(children[1]);
+        selfRefs.pop_back();
+        if (emptyLiteral) incompatible(it->second, Type(BaseType::Array), field);
+        if (!value.type.match(it->second)) incompatible(it->second, value.type, field);
+
+        if (simple) return {"(" + target + " = " + unwrap(value.code) + ")", it->second};
+        return {"[&] { auto " + holder + " = " + obj.code + "; return " + target + " = " + unwrap(value.code) + "; }()", it->second};
+    }
+
+    const std::string &ident = node->strValue();
+    const Type *type = lookup(ident);
+    if (!type) {
+        if (module->functions.contains(ident)) fail("function " + ident + " is assigned to");
+        throw std::runtime_error("Undefined variable: " + ident);
+    }
+    Type varType = *type;
+    std::string target = "l_" + ident;
+    selfRefs.push_back({target, varType});
+    Value value = expr(children[0]);
+    selfRefs.pop_back();
+    if (emptyLiteral) incompatible(Type(BaseType::Array), value.type);
+    if (!value.type.match(varType)) incompatible(varType, value.type);
+    return {"(" + target + " = " + unwrap(value.code) + ")", varType};
+}
+
+CppEmitter::Value CppEmitter::expr(const std::shared_ptr<ASTNode> &node) {
+    switch (node->type) {
+        case ASTNode::Type::NUMBER: return {std::to_string(node->intValue), Type(Primitive::INT)};
+        case ASTNode::Type::BOOL: return {node->intValue ? "true" : "false", Type(Primitive::BOOL)};
+        case ASTNode::Type::STRING: {
+            std::string code = "std::string(" + quote(node->strValue());
+            if (node->strValue().find('\0') != std::string::npos) code += ", " + std::to_string(node->strValue().size());
+            return {code + ")", Type(Primitive::STRING)};
+        }
+        case ASTNode::Type::IDENTIFIER: {
+            const std::string &ident = node->strValue();
+            if (const Type *type = lookup(ident)) return {"l_" + ident, *type};
+            if (ident == "nil") return {"lumin::Nil{}", Type()};
+            if (module->functions.contains(ident) || isNative(ident, module->outstream, module->filestream))
+                fail("function " + ident + " is used as a value");
+            if (module->aliases.contains(ident)) fail("module " + ident + " is used as a value");
+            throw std::runtime_error("Undefined variable: " + ident);
+        }
+        case ASTNode::Type::SELF_REFERENCE:
+            if (selfRefs.empty()) return {"lumin::Nil{}", Type()};
+            return selfRefs.back();
+
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT:
+            if (node->primitiveValue == Primitive::NONE) return assignment(node);
+            fail("declaration of " + node->strValue() + " is used as a value");
+        case ASTNode::Type::STRUCT_ASSIGNMENT:
+        case ASTNode::Type::NDARRAY_ASSIGN:
+            fail("declaration of " + node->strValue() + " is used as a value");
+
+        case ASTNode::Type::ARRAY_ACCESS: {
+            const auto &targetNode = node->children[0];
+            const auto &idxNodes = node->children[1]->children;
+            Value target = expr(targetNode);
+            if (!target.type.match(BaseType::Array)) throw std::runtime_error("Attempted array access on non-array");
+            Type element = target.type.element();
+
+            std::string prelude;
+            if (idxNodes.size() == 1 && idxNodes[0]->type != ASTNode::Type::RANGE) {
+                Value index = expr(idxNodes[0]);
+                if (!index.type.match(BaseType::Int)) throw std::runtime_error("Expected integer value");
+                if (needsOrder({targetNode, idxNodes[0]})) {
+                    bind(target, prelude);
+                    bind(index, prelude);
+                }
+                std::string code = target.code + ".at(" + unwrap(index.code) + ")";
+                return {prelude.empty() ? code : "[&] { " + prelude + "return " + code + "; }()", element};
+            }
+
+            std::string list = indices(node->children[1]);
+            if (needsOrder({targetNode, node->children[1]})) {
+                bind(target, prelude);
+                std::string tmp = temp();
+                prelude += "std::vector<int> " + tmp + " = " + list + "; ";
+                list = tmp;
+            }
+            std::string code = target.code + ".select(" + list + ")";
+            return {prelude.empty() ? code : "[&] { " + prelude + "return " + code + "; }()", target.type};
+        }
+        case ASTNode::Type::ARRAY_ASSIGN: {
+            Value target = expr(node->children[0]);
+            if (!target.type.match(BaseType::Array)) throw std::runtime_error("Attempted array assignment on non-array");
+            std::string list = indices(node->children[1]);
+            Value value = expr(node->children[2]);
+            Type element = target.type.element();
+            if (!value.type.match(element) && !value.type.match(target.type)) incompatible(element, value.type);
+
+            std::string prelude;
+            if (needsOrder({node->children[0], node->children[1], node->children[2]})) {
+                bind(target, prelude);
+                std::string tmp = temp();
+                prelude += "std::vector<int> " + tmp + " = " + list + "; ";
+                list = tmp;
+                bind(value, prelude);
+            }
+            std::string code = target.code + ".assign(" + list + ", " + unwrap(value.code) + ")";
+            return {prelude.empty() ? code : "[&] { " + prelude + "return " + code + "; }()", target.type};
+        }
+        case ASTNode::Type::ARRAY_LITERAL: return arrayLiteral(node);
+
+        case ASTNode::Type::CALL: return call(node);
+        case ASTNode::Type::BINARY_OP: return binaryOp(node);
+        case ASTNode::Type::UNARY_OP: {
+            Value value = expr(node->children[0]);
+            if (!value.type.match(BaseType::Int)) throw std::runtime_error("Expected integer value");
+            switch (node->binopValue) {
+                case MINUS: return {"lumin::neg(" + unwrap(value.code) + ")", Type(Primitive::INT)};
+                case BITWISE_NOT: return {"(~" + value.code + ")", Type(Primitive::INT)};
+                case NOT: return {"(!" + value.code + ")", Type(Primitive::BOOL)};
+                default: throw std::runtime_error("Unsupported unary op");
+            }
+        }
+        case ASTNode::Type::READ: return read(node);
+        case ASTNode::Type::SIZED_ARRAY_DECLARE: {
+            Value size = expr(node->children[0]);
+            if (!size.type.match(BaseType::Int)) throw std::runtime_error("Expected integer value");
+            Type element(node->primitiveValue);
+            return {cppType(element.array()) + "::filled(" + unwrap(size.code) + ", " + defaultValue(node->primitiveValue) + ")",
+                    element.array()};
+        }
+
+        default:
+            throw std::runtime_error("Unsupported expression type: " + std::to_string(static_cast<int>(node->type)));
+    }
+}
+
+CppEmitter::Value CppEmitter::binaryOp(const std::shared_ptr<ASTNode> &node) {
+    BinaryOp op = node->binopValue;
+    Value lhs = expr(node->children[0]);
+    Value rhs = expr(node->children[1]);
+
+    std::string prelude;
+    if (needsOrder({node->children[0], node->children[1]})) {
+        bind(lhs, prelude);
+        bind(rhs, prelude);
+    }
+
+    std::string code;
+    Type type(Primitive::STRING);
+    if (lhs.type.match(BaseType::String) && op == PLUS) {
+        code = "lumin::concat(" + unwrap(lhs.code) + ", " + unwrap(rhs.code) + ")";
+        cppType(rhs.type); // only printable values can be appended
+    } else if (lhs.type.match(BaseType::String) && op == MULTIPLY) {
+        if (!rhs.type.match(BaseType::Int)) throw std::runtime_error("Cannot multiply a string with a non-integer");
+        code = "lumin::repeat(" + unwrap(lhs.code) + ", " + unwrap(rhs.code) + ")";
+    } else {
+        if (!lhs.type.match(BaseType::Int) || !rhs.type.match(BaseType::Int)) throw std::runtime_error("Expected integer value");
+        if (const char *helper = wrappingHelper(op))
+            code = std::string("lumin::") + helper + "(" + unwrap(lhs.code) + ", " + unwrap(rhs.code) + ")";
+        else
+            code = "(" + lhs.code + " " + binaryOperator(op) + " " + rhs.code + ")";
+        type = binaryResultType(op, StaticType::Int) == StaticType::Bool ? Type(Primitive::BOOL) : Type(Primitive::INT);
+    }
+
+    if (!prelude.empty()) code = "[&] { " + prelude + "return " + unwrap(code) + "; }()";
+    return {code, type};
+}
+
+CppEmitter::Value CppEmitter::call(const std::shared_ptr<ASTNode> &node) {
+    const auto &callee = node->children[0];
+    if (callee->type == ASTNode::Type::IDENTIFIER) {
+        const std::string &name = callee->strValue();
+        if (const _FunctionData *local = localFunction(name)) return userCall(*local, "l_" + name, node);
+        if (lookup(name)) fail("calls through function values are not supported: " + name);
+        if (module->functions.contains(name)) return userCall(*module->functions.at(name), "l_" + name, node);
+        if (isNative(name, module->outstream, module->filestream)) return nativeCall(name, node);
+        throw std::runtime_error("Undefined variable: " + name);
+    }
+    if (callee->type == ASTNode::Type::READ) {
+        if (const Module *target = importedModule(callee->children[0])) {
+            const std::string &name = callee->children[1]->strValue();
+            if (std::find(target->exports.begin(), target->exports.end(), name) == target->exports.end())
+                throw std::runtime_error("Export not found: " + name);
+            if (!target->functions.contains(name)) throw std::runtime_error("Attempted to call a non-function value");
+            return userCall(*target->functions.at(name), target->ns + "::l_" + name, node);
+        }
+    }
+    fail("calls through function values are not supported");
+}
+
+CppEmitter::Value CppEmitter::userCall(const _FunctionData &fn, const std::string &cppName, const std::shared_ptr<ASTNode> &node) {
+    std::vector<std::shared_ptr<ASTNode>> argNodes(node->children.begin() + 1, node->children.end());
+    std::vector<Value> args;
+    for (const auto &argNode : argNodes) args.push_back(expr(argNode));
+
+    std::string prelude;
+    if (needsOrder(argNodes))
+        for (auto &arg : args) bind(arg, prelude);
+
+    auto check = [](const Parameter &param, const Value &arg) {
+        if (!param.type.match(arg.type))
+            throw std::runtime_error("Expected type " + param.type.toString() + " but got " + arg.type.toString());
+    };
+
+    std::vector<std::string> params;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i >= fn.params.size()) throw std::runtime_error("Too many arguments provided for function");
+        const Parameter &param = fn.params[i];
+        if (param.vararg) {
+            std::vector<std::string> pack;
+            for (size_t j = i; j < args.size(); ++j) {
+                check(param, args[j]);
+                pack.push_back(unwrap(args[j].code));
+            }
+            params.push_back(cppType(param.type.array()) + "{" + join(pack) + "}");
+            break;
+        }
+        check(param, args[i]);
+        params.push_back(unwrap(args[i].code));
+    }
+    for (size_t i = params.size(); i < fn.params.size(); ++i) {
+        if (!fn.params[i].vararg) throw std::runtime_error("Missing argument for parameter: " + fn.params[i].ident);
+        params.push_back(cppType(fn.params[i].type.array()) + "()");
+    }
+
+    std::string code = cppName + "(" + join(params) + ")";
+    if (!prelude.empty()) code = "[&] { " + prelude + "return " + code + "; }()";
+    return {code, fn.retType};
+}
+
+CppEmitter::Value CppEmitter::nativeCall(const std::string &name, const std::shared_ptr<ASTNode> &node) {
+    std::vector<std::shared_ptr<ASTNode>> argNodes(node->children.begin() + 1, node->children.end());
+    std::vector<Value> args;
+    for (const auto &argNode : argNodes) args.push_back(expr(argNode));
+
+    std::string prelude;
+    if (needsOrder(argNodes))
+        for (auto &arg : args) bind(arg, prelude);
+
+    auto expect = [&args](size_t i, const Type &type, const std::string &err) {
+        if (!args[i].type.match(type)) throw std::runtime_error(err);
+        return unwrap(args[i].code);
+    };
+    Type file("File"), str(Primitive::STRING), integer(Primitive::INT);
+
+    std::string code;
+    Type type = integer;
+    if (name == "print" || name == "println") {
+        std::vector<std::string> values;
+        for (const auto &arg : args) {
+            cppType(arg.type); // only printable values
+            values.push_back(unwrap(arg.code));
+        }
+        code = "lumin::" + name + "(" + join(values) + ")";
+    } else if (name == "printf") {
+        if (args.empty()) return {"0", integer};
+        std::vector<std::string> values;
+        for (size_t i = 1; i < args.size(); ++i) values.push_back(expect(i, str, "Expected string value"));
+        code = "lumin::printf(" + expect(0, str, "Expected string value") + ", {" + join(values) + "})";
+    } else if (name == "fopen") {
+        if (args.size() < 2) throw std::runtime_error("fopen requires filename and mode");
+        code = "lumin::fopen(" + expect(0, str, "Expected string value") + ", " + expect(1, str, "Expected string value") + ")";
+        type = file;
+    } else if (name == "fclose") {
+        if (args.empty()) throw std::runtime_error("fclose requires a File struct");
+        code = "lumin::fclose(" + expect(0, file, "fclose requires a File struct") + ")";
+    } else if (name == "fwrite") {
+        if (args.size() < 2) throw std::runtime_error("fwrite requires a File struct and string");
+        code = "lumin::fwrite(" + expect(0, file, "fwrite requires a File struct and string") + ", " +
+               expect(1, str, "Expected string value") + ")";
+    } else {
+        if (args.empty()) throw std::runtime_error("fread requires a File struct");
+        code = "lumin::fread(" + expect(0, file, "fread expects a File struct");
+        if (args.size() >= 2) code += ", " + expect(1, integer, "fread expects a int");
+        code += ")";
+        type = str;
+    }
+
+    if (!prelude.empty()) code = "[&] { " + prelude + "return " + code + "; }()";
+    return {code, type};
+}
+
+CppEmitter::Value CppEmitter::read(const std::shared_ptr<ASTNode> &node) {
+    const std::string &property = node->children[1]->strValue();
+    if (const Module *target = importedModule(node->children[0])) {
+        if (std::find(target->exports.begin(), target->exports.end(), property) == target->exports.end())
+            throw std::runtime_error("Export not found: " + property);
+        auto it = target->globals.find(property);
+        if (it == target->globals.end()) fail("function " + property + " is used as a value");
+        return {target->ns + "::l_" + property, it->second};
+    }
+
+    Value target = expr(node->children[0]);
+    switch (target.type.kind()) {
+        case BaseType::Struct: {
+            const auto &fields = structInfo(target.type.name()).type->fields;
+            auto it = std::find_if(fields.begin(), fields.end(), [&property](const auto &pair) { return Symbols::name(pair.first) == property; });
+            if (it == fields.end()) throw std::runtime_error("Struct does not have field: " + property);
+            return {target.code + "->l_" + property, it->second};
+        }
+        case BaseType::Array:
+            if (property == "length") return {target.code + ".length()", Type(Primitive::INT)};
+            throw std::runtime_error("Unknown array property: " + property);
+        default:
+            throw std::runtime_error("Attempted READ on non-object");
+    }
+}
+
+CppEmitter::Value CppEmitter::arrayLiteral(const std::shared_ptr<ASTNode> &node) {
+    const auto &children = node->children;
+    if (children.empty()) return {"lumin::Array<lumin::Nil>()", Type().array()};
+
+    Type intType(Primitive::INT);
+    bool ranges = std::any_of(children.begin(), children.end(),
+                              [](const auto &child) { return child->type == ASTNode::Type::RANGE; });
+    if (ranges) {
+        std::vector<std::string> parts;
+        for (const auto &child : children) {
+            if (child->type == ASTNode::Type::RANGE) {
+                Value start = expr(child->children[0]);
+                Value end = expr(child->children[1]);
+                if (!start.type.match(intType) || !end.type.match(intType)) throw std::runtime_error("Expected integer value");
+                parts.push_back("lumin::range(" + unwrap(start.code) + ", " + unwrap(end.code) + ")");
+                continue;
+            }
+            Value value = expr(child);
+            if (!value.type.match(intType)) throw std::runtime_error("RANGE literal is only allowed for integer arrays");
+            parts.push_back("lumin::Array<int>{" + unwrap(value.code) + "}");
+        }
+        return {parts.size() == 1 ? parts[0] : "lumin::join({" + join(parts) + "})", intType.array()};
+    }
+
+    std::vector<std::string> elements;
+    Type element;
+    for (size_t i = 0; i < children.size(); ++i) {
+        Value value = expr(children[i]);
+        if (i == 0) {
+            element = value.type;
+        } else if (!value.type.match(element)) {
+            throw std::runtime_error("Array literal elements must have the same type: got " +
+                                     value.type.toString() + " but expected " + element.toString());
+        }
+        elements.push_back(unwrap(value.code));
+    }
+    return {cppType(element.array()) + "{" + join(elements) + "}", element.array()};
+}
+
+std::string CppEmitter::indices(const std::shared_ptr<ASTNode> &indicesNode) {
+    std::vector<std::string> spans;
+    for (const auto &child : indicesNode->children) {
+        if (child->type == ASTNode::Type::RANGE) {
+            Value start = expr(child->children[0]);
+            Value end = expr(child->children[1]);
+            if (!start.type.match(BaseType::Int) || !end.type.match(BaseType::Int)) throw std::runtime_error("Expected integer value");
+            spans.push_back("{" + unwrap(start.code) + ", " + unwrap(end.code) + "}");
+        } else {
+            Value index = expr(child);
+            if (!index.type.match(BaseType::Int)) throw std::runtime_error("Expected integer value");
+            spans.push_back(unwrap(index.code));
+        }
+    }
+    return "lumin::indices({" + join(spans) + "})";
+}
+
+std::string CppEmitter::condition(const std::shared_ptr<ASTNode> &node) {
+    Value value = expr(node);
+    if (!value.type.match(BaseType::Bool)) throw std::runtime_error("Expected boolean value");
+    return unwrap(value.code);
+}
+
+const Type *CppEmitter::lookup(const std::string &ident) const {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto found = it->find(ident);
+        if (found != it->end()) return &found->second;
+    }
+    auto global = module->globals.find(ident);
+    return global == module->globals.end() ? nullptr : &global->second;
+}
+
+// The fin the innermost declaration of name stands for, if that is a fin declared inside a fin or block.
+const _FunctionData *CppEmitter::localFunction(const std::string &name) const {
+    for (size_t depth = scopes.size(); depth > 0; --depth) {
+        if (!scopes[depth - 1].contains(name)) continue;
+        for (auto it = localFunctions.rbegin(); it != localFunctions.rend(); ++it)
+            if (it->depth == depth && it->name == name) return it->data.get();
+        return nullptr;
+    }
+    return nullptr;
+}
+
+const CppEmitter::Module *CppEmitter::importedModule(const std::shared_ptr<ASTNode> &node) const {
+    if (node->type != ASTNode::Type::IDENTIFIER || lookup(node->strValue())) return nullptr;
+    auto it = module->aliases.find(node->strValue());
+    if (it == module->aliases.end()) return nullptr;
+    return &modules[moduleIndex.at(it->second)];
+}
+
+std::string CppEmitter::bind(Value &value, std::string &prelude) {
+    std::string tmp = temp();
+    prelude += cppType(value.type) + " " + tmp + " = " + unwrap(value.code) + "; ";
+    value.code = tmp;
+    return tmp;
+}
@@ -7,14 +7,14 @@
 
 void addFilestream(std::shared_ptr<Environment> globalEnv, Executor* executor) {
     StructType fileType{"File"};
-    fileType.fields.push_back({"filename", Primitive::STRING});
-    fileType.fields.push_back({"size", Primitive::INT});
-    fileType.fields.push_back({"is_open", Primitive::BOOL});
+    fileType.fields.push_back({Symbols::intern("filename"), Primitive::STRING});
+    fileType.fields.push_back({Symbols::intern("size"), Primitive::INT});
+    fileType.fields.push_back({Symbols::intern("is_open"), Primitive::BOOL});
 
     auto sharedFT = std::make_shared<StructType>(fileType);
     globalEnv->setType("File", sharedFT);
 
-    globalEnv->set("fopen", std::make_shared<Function>(Function{
+    globalEnv->set("fopen", makeRef<Function>(Function{
         [executor, sharedFT](const std::vector<std::shared_ptr<TypedValue>> &args) -> std::shared_ptr<TypedValue> {
             if (args.size() < 2) throw std::runtime_error("fopen requires filename and mode");
 
@@ -30,7 +30,7 @@ void addFilestream(std::shared_ptr<Environment> globalEnv, Executor* executor) {
             auto file = std::make_shared<std::fstream>(filename, openMode);
             if (!file->is_open()) throw std::runtime_error("Failed to open file: " + filename);
 
-            auto fileStruct = std::make_shared<Struct>("File", sharedFT);
+            auto fileStruct = makeRef<Struct>("File", sharedFT);
             fileStruct->addField("filename", filename);
             fileStruct->addField("size", 0);
             fileStruct->addField("is_open", true);
@@ -41,10 +41,10 @@ void addFilestream(std::shared_ptr<Environment> globalEnv, Executor* executor) {
         }
     }));
 
-    globalEnv->set("fclose", std::make_shared<Function>(Function{
+    globalEnv->set("fclose", makeRef<Function>(Function{
         [](const std::vector<std::shared_ptr<TypedValue>> &args) -> std::shared_ptr<TypedValue> {
             if (args.empty()) throw std::runtime_error("fclose requires a File struct");
-            auto file = args[0]->get<std::shared_ptr<Struct>>();
+            auto file = args[0]->get<PStruct>();
 
             auto stream = std::any_cast<std::shared_ptr<std::fstream>>(file->getHiddenField("stream"));
             if (stream && stream->is_open()) stream->close();
@@ -54,10 +54,10 @@ void addFilestream(std::shared_ptr<Environment> globalEnv, Executor* executor) {
         }
     }));
 
-    globalEnv->set("fwrite", std::make_shared<Function>(Function{
+    globalEnv->set("fwrite", makeRef<Function>(Function{
         [executor](const std::vector<std::shared_ptr<TypedValue>> &args) -> std::shared_ptr<TypedValue> {
             if (args.size() < 2) throw std::runtime_error("fwrite requires a File struct and string");
-            auto file = args[0]->get<std::shared_ptr<Struct>>();
+            auto file = args[0]->get<PStruct>();
             auto stream = std::any_cast<std::shared_ptr<std::fstream>>(file->getHiddenField("stream"));
             if (!stream || !stream->is_open())
                 throw std::runtime_error("File is not open");
@@ -73,20 +73,20 @@ void addFilestream(std::shared_ptr<Environment> globalEnv, Executor* executor) {
         }
     }));
 
-    globalEnv->set("fread", std::make_shared<Function>(Function{
+    globalEnv->set("fread", makeRef<Function>(Function{
         [sharedFT](const std::vector<std::shared_ptr<TypedValue>> &args) -> std::shared_ptr<TypedValue> {
             if (args.empty()) throw std::runtime_error("fread requires a File struct");
 
-            if(!sharedFT->match(args[0]->type)) throw std::runtime_error("fread expects a File struct");
+            if(!sharedFT->match(args[0]->type())) throw std::runtime_error("fread expects a File struct");
 
-            auto file = args[0]->get<std::shared_ptr<Struct>>();
+            auto file = args[0]->get<PStruct>();
             auto stream = std::any_cast<std::shared_ptr<std::fstream>>(file->getHiddenField("stream"));
             if (!stream || !stream->is_open())
                 throw std::runtime_error("File is not open");
 
             stream->seekg(0, std::ios::beg);
             if (args.size() >= 2) {
-                if(!args[1]->type.match(Primitive::INT)) throw std::runtime_error("fread expects a int");
+                if(!args[1]->type().match(Primitive::INT)) throw std::runtime_error("fread expects a int");
                 int n = args[1]->get<int>();
                 std::string buf(n, '\0');
                 stream->read(buf.data(), n);
@@ -9,13 +9,13 @@ void addOutstream(std::shared_ptr<Environment> globalEnv, Executor* executor) {
         return std::make_shared<TypedValue>(0);
     };
 
-    globalEnv->set("print", {std::make_shared<Function>(Function{
+    globalEnv->set("print", {makeRef<Function>(Function{
         [printFunc](const std::vector<std::shared_ptr<TypedValue>> &args) { return printFunc(args, false); }
     })});
-    globalEnv->set("println", {std::make_shared<Function>(Function{
+    globalEnv->set("println", {makeRef<Function>(Function{
         [printFunc](const std::vector<std::shared_ptr<TypedValue>> &args) { return printFunc(args, true); }
     })});
-    globalEnv->set("printf", {std::make_shared<Function>(Function{
+    globalEnv->set("printf", {makeRef<Function>(Function{
         [executor](const std::vector<std::shared_ptr<TypedValue>> &args) -> std::shared_ptr<TypedValue> {
             if (args.empty()) return std::make_shared<TypedValue>(0);
 
@@ -0,0 +1,722 @@
+#include "typechecker.hpp"
+#include <algorithm>
+
+static Type parameterType(const ASTNode &param) {
+    const auto &typeNode = *param.children[0];
+    return typeNode.primitiveValue == Primitive::NONE ? Type(typeNode.strValue()) : Type(typeNode.primitiveValue);
+}
+
+static bool isVararg(const ASTNode &param) {
+    return param.children.size() > 1 && param.children[1]->type == ASTNode::Type::ARRAY_ASSIGN;
+}
+
+// Same as Executor::executeFunctionDefinition.
+static Type returnType(const ASTNode &function) {
+    if (function.primitiveValue != Primitive::NONE) return Type(function.primitiveValue);
+    return function.retType() == "nil" ? Type(BaseType::NIL) : Type(function.retType());
+}
+
+static bool same(const std::optional<Type> &a, const std::optional<Type> &b) {
+    return a && b && a->match(*b);
+}
+
+static bool known(const std::optional<Type> &type, BaseType kind) {
+    return type && type->kind() == kind;
+}
+
+// Whether running the statement always ends in a return, so a fin can never fall off its end.
+static bool alwaysReturns(const std::shared_ptr<ASTNode> &node) {
+    switch (node->type) {
+        case ASTNode::Type::RETURN_STATEMENT: return true;
+        case ASTNode::Type::BLOCK:
+            for (const auto &child : node->children)
+                if (alwaysReturns(child)) return true;
+            return false;
+        case ASTNode::Type::IF_STATEMENT:
+            return node->children.size() > 2 && node->children[2]->type == ASTNode::Type::ELSE_STATEMENT &&
+                   alwaysReturns(node->children[1]) && alwaysReturns(node->children[2]->children[0]);
+        default: return false;
+    }
+}
+
+std::vector<std::string> TypeChecker::check(const std::shared_ptr<ASTNode> &root) {
+    collectStructs(root);
+    do {
+        changed = false;
+        pass(root);
+    } while (changed);
+
+    reporting = true;
+    callees.clear();
+    types.clear();
+    pass(root);
+    return errors;
+}
+
+const ASTNode *TypeChecker::callee(const ASTNode &call) const {
+    auto it = callees.find(&call);
+    return it == callees.end() ? nullptr : it->second;
+}
+
+std::optional<Type> TypeChecker::expressionType(const ASTNode &expr) const {
+    auto it = types.find(&expr);
+    return it == types.end() ? Static() : Static(it->second);
+}
+
+bool TypeChecker::returnsDeclaredType(const ASTNode &function, const ASTNode &expr) const {
+    Static type = parameterExpression(expr, function);
+    return type && type->match(returnType(function));
+}
+
+// Struct types are looked up by name while running, so a name declared twice with different fields
+// is left unknown.
+void TypeChecker::collectStructs(const std::shared_ptr<ASTNode> &node) {
+    if (node->type == ASTNode::Type::STRUCT_DECLARE) {
+        std::vector<std::pair<std::string, Type>> fields;
+        bool valid = true;
+        for (const auto &child : node->children) {
+            if (child->type != ASTNode::Type::PRIMITIVE_ASSIGNMENT) fields.emplace_back(child->strValue(), Type(child->children[0]->strValue()));
+            else if (child->primitiveValue != Primitive::NONE) fields.emplace_back(child->strValue(), Type(child->primitiveValue));
+            else valid = false;
+        }
+
+        const std::string &name = node->strValue();
+        bool first = declaredStructs.insert(name).second;
+        auto it = structs.find(name);
+        bool sameFields = it != structs.end() && it->second.size() == fields.size() &&
+            std::equal(fields.begin(), fields.end(), it->second.begin(), [](const auto &a, const auto &b) {
+                return a.first == b.first && a.second.match(b.second);
+            });
+
+        if (first && valid) structs.emplace(name, std::move(fields));
+        else if (!sameFields) structs.erase(name);
+        return;
+    }
+    for (const auto &child : node->children) collectStructs(child);
+}
+
+void TypeChecker::pass(const std::shared_ptr<ASTNode> &root) {
+    symbols.clear();
+    scopes.clear();
+    selfRefs.clear();
+    functions.clear();
+    imports.clear();
+    exports.clear();
+
+    for (size_t i = 0; i < root->children.size(); ++i) {
+        mainPragma = i + 1 == root->children.size();
+        pragma(root->children[i]);
+    }
+}
+
+void TypeChecker::error(const std::string &msg) {
+    if (reporting) errors.push_back(file + ":" + std::to_string(line) + ": " + msg);
+}
+
+void TypeChecker::prove(ASTNode &node, bool proven) {
+    if (reporting) node.typeChecked = proven;
+}
+
+void TypeChecker::grow(std::unordered_set<const ASTNode *> &set, const ASTNode *node) {
+    if (set.insert(node).second) changed = true;
+}
+
+// Redeclaring a name in the same block reuses its symbol, like the Resolver reuses its slot.
+void TypeChecker::declare(const ASTNode &node, Static type, const ASTNode *function, bool native) {
+    auto &scope = scopes.back();
+    auto it = scope.find(node.strValue());
+    if (it == scope.end()) {
+        scope[node.strValue()] = &node;
+        symbols[&node] = {type, function, native};
+        return;
+    }
+
+    const Symbol &symbol = symbols[it->second];
+    if (symbol.function || function || !same(symbol.type, type)) grow(unstable, it->second);
+}
+
+const ASTNode *TypeChecker::lookup(const std::string &name) const {
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        auto it = scope->find(name);
+        if (it != scope->end()) return it->second;
+    }
+    return nullptr;
+}
+
+// What alias.name reads when alias is a .lum import, imports are always checked before their importers.
+const ASTNode *TypeChecker::importedSymbol(const ASTNode &callee) const {
+    if (callee.type != ASTNode::Type::READ || callee.children[0]->type != ASTNode::Type::IDENTIFIER) return nullptr;
+    auto alias = imports.find(lookup(callee.children[0]->strValue()));
+    if (alias == imports.end()) return nullptr;
+    auto module = exports.find(alias->second);
+    if (module == exports.end()) return nullptr;
+    auto it = module->second.find(callee.children[1]->strValue());
+    return it == module->second.end() ? nullptr : it->second;
+}
+
+TypeChecker::Static TypeChecker::typeOf(const ASTNode *symbol) const {
+    if (!symbol || unstable.contains(symbol) || unstableNames.contains(symbol->strValue())) return {};
+    return symbols.at(symbol).type;
+}
+
+TypeChecker::Static TypeChecker::visit(const std::shared_ptr<ASTNode> &node) {
+    uint32_t outer = line;
+    if (node->line) line = node->line;
+    Static type = visitNode(node);
+    if (reporting && type) types.insert_or_assign(node.get(), *type);
+    else if (reporting) types.erase(node.get());
+    line = outer;
+    return type;
+}
+
+TypeChecker::Static TypeChecker::visitNode(const std::shared_ptr<ASTNode> &node) {
+    switch (node->type) {
+        case ASTNode::Type::NUMBER: return Type(BaseType::Int);
+        case ASTNode::Type::BOOL: return Type(BaseType::Bool);
+        case ASTNode::Type::STRING: return Type(BaseType::String);
+        case ASTNode::Type::IDENTIFIER: return identifier(node, false);
+        case ASTNode::Type::SELF_REFERENCE:
+            if (selfRefs.empty()) return {};
+            return selfRefs.back();
+
+        case ASTNode::Type::BLOCK: block(node); return {};
+        case ASTNode::Type::IF_STATEMENT:
+            condition(node->children[0]);
+            visit(node->children[1]);
+            if (node->children.size() > 2 && node->children[2]->type == ASTNode::Type::ELSE_STATEMENT)
+                visit(node->children[2]->children[0]);
+            return {};
+        case ASTNode::Type::WHILE_STATEMENT:
+            condition(node->children[0]);
+            visit(node->children[1]);
+            return {};
+        case ASTNode::Type::FOR_STATEMENT: forStatement(node); return {};
+        case ASTNode::Type::RETURN_STATEMENT: returnStatement(node); return {};
+        case ASTNode::Type::FUNCTION: function(node); return {};
+        case ASTNode::Type::NATIVE_STATEMENT:
+            declare(*node, Type(BaseType::Function), node->children[0].get(), true);
+            return {};
+        case ASTNode::Type::STRUCT_DECLARE:
+        case ASTNode::Type::IMPORT_BLOCK:
+            return {};
+
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: return assignment(node);
+        case ASTNode::Type::STRUCT_ASSIGNMENT: return structAssignment(node);
+        case ASTNode::Type::NDARRAY_ASSIGN: return ndarrayAssignment(node);
+        case ASTNode::Type::ARRAY_LITERAL: return arrayLiteral(node);
+        case ASTNode::Type::ARRAY_ACCESS: return arrayAccess(node);
+        case ASTNode::Type::ARRAY_ASSIGN: return arrayAssign(node);
+        case ASTNode::Type::CALL: return call(node);
+        case ASTNode::Type::BINARY_OP: return binaryOp(node);
+        case ASTNode::Type::UNARY_OP: return unaryOp(node);
+        case ASTNode::Type::READ: return read(node);
+        case ASTNode::Type::SIZED_ARRAY_DECLARE: {
+            index(node->children[0]);
+            if (node->primitiveValue == Primitive::NONE) return {};
+            return Type(node->primitiveValue).array();
+        }
+
+        default:
+            for (const auto &child : node->children) visit(child);
+            return {};
+    }
+}
+
+void TypeChecker::pragma(const std::shared_ptr<ASTNode> &node) {
+    file = node->strValue();
+    line = 0;
+    scopes.assign(1, {});
+
+    // .lum imports bind their alias to the module's exports
+    for (const auto &import : node->children[0]->children) {
+        if (import->children.empty()) continue;
+        declare(*import->children[0], Type(BaseType::ExportData));
+        imports[import->children[0].get()] = import->strValue();
+    }
+
+    exported.clear();
+    for (const auto &exportNode : node->children[1]->children) exported.insert(exportNode->strValue());
+
+    for (size_t i = 2; i < node->children.size(); ++i) visit(node->children[i]);
+
+    auto &names = exports[file];
+    for (const auto &name : exported)
+        if (auto it = scopes.back().find(name); it != scopes.back().end()) names[name] = it->second;
+}
+
+void TypeChecker::block(const std::shared_ptr<ASTNode> &node) {
+    scopes.emplace_back();
+    for (const auto &child : node->children) visit(child);
+    scopes.pop_back();
+}
+
+// Parameters are only known to hold their declared types while every call to the fin can be seen
+// passing all of them: a missing argument leaves its parameter nil.
+void TypeChecker::function(const std::shared_ptr<ASTNode> &node) {
+    declare(*node, Type(BaseType::Function), node.get());
+
+    // a fin declared inside another makes the outer one return it, see Executor::executeNode
+    if (!functions.empty()) {
+        functions.back().returnsChecked = false;
+        grow(opaqueParams, node.get());
+    } else if (scopes.size() == 1 && (exported.contains(node->strValue()) || (mainPragma && node->strValue() == "main"))) {
+        grow(opaqueParams, node.get());
+    }
+
+    bool paramsKnown = !opaqueParams.contains(node.get());
+    scopes.emplace_back();
+    for (size_t i = 0; i + 1 < node->children.size(); ++i) {
+        const auto &param = *node->children[i];
+        Type type = isVararg(param) ? parameterType(param).array() : parameterType(param);
+        declare(param, paramsKnown ? Static(type) : Static());
+    }
+
+    Type retType = returnType(*node);
+    functions.push_back({retType});
+    auto outerSelfRefs = std::move(selfRefs);
+    selfRefs.clear();
+
+    visit(node->children.back());
+
+    const auto &scope = functions.back();
+    prove(*node, scope.returnsChecked && (retType.match(BaseType::NIL) || alwaysReturns(node->children.back())));
+    selfRefs = std::move(outerSelfRefs);
+    functions.pop_back();
+    scopes.pop_back();
+}
+
+void TypeChecker::forStatement(const std::shared_ptr<ASTNode> &node) {
+    scopes.emplace_back();
+    if (node->strValue() == "0") {
+        visit(node->children[0]);
+        condition(node->children[1]);
+        visit(node->children[2]);
+        visit(node->children[3]);
+    } else {
+        // the loop variable takes each element as is, whatever its declaration says
+        Static iterable = visit(node->children[1]);
+        if (iterable && !known(iterable, BaseType::Array)) error("Expected array for enhanced for loop");
+
+        Static element;
+        if (elementsTrusted && known(iterable, BaseType::Array) && iterable->hasElement() && !iterable->element().match(BaseType::NIL))
+            element = iterable->element();
+        declare(*node->children[0], element);
+        visit(node->children[2]);
+    }
+    scopes.pop_back();
+}
+
+void TypeChecker::condition(const std::shared_ptr<ASTNode> &node) {
+    Static type = visit(node);
+    if (type && !known(type, BaseType::Bool)) error("Expected boolean value");
+}
+
+void TypeChecker::returnStatement(const std::shared_ptr<ASTNode> &node) {
+    Static type = node->children.empty() ? Static(Type(BaseType::NIL)) : visit(node->children[0]);
+    if (functions.empty()) return;
+
+    auto &scope = functions.back();
+    if (type && !type->match(scope.retType))
+        error("Function return type mismatch - got " + type->toString() + " but expected " + scope.retType.toString());
+    if (!same(type, scope.retType)) scope.returnsChecked = false;
+}
+
+// Indices and the bounds of ranges must be ints.
+void TypeChecker::index(const std::shared_ptr<ASTNode> &node) {
+    if (node->type == ASTNode::Type::RANGE) {
+        index(node->children[0]);
+        index(node->children[1]);
+        return;
+    }
+    Static type = visit(node);
+    if (type && !known(type, BaseType::Int)) error("Expected integer value");
+}
+
+// A fin's name used as a value may be called from anywhere, so its parameters are no longer known.
+TypeChecker::Static TypeChecker::identifier(const std::shared_ptr<ASTNode> &node, bool callee) {
+    const ASTNode *symbol = lookup(node->strValue());
+    if (!symbol) return {};
+    const Symbol &info = symbols.at(symbol);
+    if (info.function && !info.native && !callee) grow(opaqueParams, info.function);
+    return typeOf(symbol);
+}
+
+TypeChecker::Static TypeChecker::assignment(const std::shared_ptr<ASTNode> &node) {
+    if (node->children.size() > 1 && node->children[0]->type == ASTNode::Type::READ) return propertyAssignment(node);
+    if (node->children.empty()) {
+        if (node->primitiveValue == Primitive::NONE) return {};
+        declare(*node, Type(node->primitiveValue));
+        prove(*node, true);
+        return Type(node->primitiveValue);
+    }
+
+    const auto &value = node->children[0];
+    bool literal = value->type == ASTNode::Type::ARRAY_LITERAL;
+
+    if (node->primitiveValue == Primitive::NONE) {
+        const ASTNode *symbol = lookup(node->strValue());
+        Static current = typeOf(symbol);
+        if (!symbol) {
+            if (unstableNames.insert(node->strValue()).second) changed = true;
+        } else if (symbols.at(symbol).function) {
+            grow(unstable, symbol);
+        }
+
+        selfRefs.push_back(current);
+        Static type = visit(value);
+        selfRefs.pop_back();
+
+        if (literal) {
+            // the variable takes the literal's type, see Executor::handleAssignment
+            if (value->children.empty()) error("Incompatible types for assignment; expected array<?> but got array<nil>");
+            if (symbol && !same(type, current)) grow(unstable, symbol);
+            prove(*node, !value->children.empty());
+            return type;
+        }
+
+        if (current && type && !type->match(*current))
+            error("Incompatible types for assignment; expected " + current->toString() + " but got " + type->toString());
+        prove(*node, same(type, current));
+        return type;
+    }
+
+    Static type = visit(value);
+    if (literal) {
+        if (value->children.empty()) error("Incompatible types for assignment; expected array<?> but got array<nil>");
+        declare(*node, type);
+        prove(*node, !value->children.empty());
+        return type;
+    }
+
+    Type expected = value->type == ASTNode::Type::SIZED_ARRAY_DECLARE
+        ? Type(node->primitiveValue).array()
+        : Type(node->primitiveValue);
+    if (type && !type->match(expected))
+        error("Incompatible types for assignment; expected " + expected.toString() + " but got " + type->toString());
+    declare(*node, expected);
+    prove(*node, same(type, expected));
+    return type;
+}
+
+TypeChecker::Static TypeChecker::propertyAssignment(const std::shared_ptr<ASTNode> &node) {
+    const auto &readNode = node->children[0];
+    const auto &value = node->children[1];
+    const std::string &prop = readNode->children[1]->strValue();
+
+    Static target = visit(readNode->children[0]);
+    Static field;
+    if (target && !known(target, BaseType::Struct)) {
+        error("Left-hand side of assignment is not a struct or object");
+    } else if (target && structs.contains(target->name())) {
+        for (const auto &[name, type] : structs.at(target->name()))
+            if (name == prop) field = type;
+        if (!field) error("Struct does not have field: " + prop);
+    }
+
+    selfRefs.push_back(field);
+    Static type = visit(value);
+    selfRefs.pop_back();
+
+    if (value->type == ASTNode::Type::ARRAY_LITERAL && value->children.empty()) {
+        if (field)
+            error("Incompatible types for assignment; expected " + field->toString() + " but got array<?> for field: " + prop);
+        prove(*node, false);
+        return type;
+    }
+
+    if (field && type && !type->match(*field))
+        error("Incompatible types for assignment; expected " + field->toString() + " but got " + type->toString() + " for field: " + prop);
+    prove(*node, same(type, field));
+    return type;
+}
+
+// Arguments are matched to fields by position, named or not.
+TypeChecker::Static TypeChecker::structAssignment(const std::shared_ptr<ASTNode> &node) {
+    const std::string &name = node->children[0]->strValue();
+
+    std::vector<Static> args;
+    for (size_t i = 1; i < node->children.size(); ++i) {
+        const auto &arg = node->children[i];
+        args.push_back(visit(arg->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT ? arg->children[0] : arg));
+    }
+
+    bool proven = false;
+    if (!declaredStructs.contains(name)) {
+        error("Unknown struct type: " + name);
+    } else if (structs.contains(name)) {
+        const auto &fields = structs.at(name);
+        if (args.size() != fields.size()) {
+            error("Struct assignment has incorrect number of arguments");
+        } else {
+            proven = true;
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (args[i] && !args[i]->match(fields[i].second)) {
+                    const auto &arg = node->children[i + 1];
+                    error(arg->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT
+                        ? "Type mismatch for field: " + arg->strValue()
+                        : "Type mismatch for field at index " + std::to_string(i));
+                }
+                proven = proven && same(args[i], fields[i].second);
+            }
+        }
+    }
+
+    prove(*node, proven);
+    declare(*node, Type(name));
+    return Type(name);
+}
+
+// Every element is an int unless the right hand side produces something else.
+TypeChecker::Static TypeChecker::ndarrayAssignment(const std::shared_ptr<ASTNode> &node) {
+    for (size_t i = 1; i + 1 < node->children.size(); ++i) index(node->children[i]);
+
+    const std::string &efficiency = node->children[0]->strValue();
+    Static ref;
+    if (efficiency == "1") ref = Type(BaseType::Int);
+    else if (efficiency == "2") ref = Type(BaseType::Int).array();
+
+    if (efficiency != "0") selfRefs.push_back(ref);
+    Static value = visit(node->children.back());
+    if (efficiency != "0") selfRefs.pop_back();
+
+    Type ints = Type(BaseType::Int).array();
+    if (elementsTrusted && !known(value, BaseType::Int) && !same(value, ints)) {
+        elementsTrusted = false;
+        changed = true;
+    }
+
+    declare(*node, ints);
+    return ints;
+}
+
+TypeChecker::Static TypeChecker::arrayLiteral(const std::shared_ptr<ASTNode> &node) {
+    if (node->children.empty()) return Type(BaseType::NIL).array();
+
+    // mirrors Executor::evaluateExpression, where a leading range leaves the element type nil
+    bool ranges = false, firstSet = false;
+    Static elementType = Type(BaseType::NIL);
+    for (const auto &child : node->children) {
+        if (child->type == ASTNode::Type::RANGE) {
+            if (firstSet && elementType && !known(elementType, BaseType::Int))
+                error("RANGE literal is only allowed for integer arrays");
+            index(child);
+            ranges = firstSet = true;
+            continue;
+        }
+
+        Static type = visit(child);
+        if (!firstSet) {
+            elementType = type;
+            firstSet = true;
+        } else if (type && elementType && !type->match(*elementType)) {
+            error("Array literal elements must have the same type: got " + type->toString() + " but expected " + elementType->toString());
+        }
+    }
+
+    if (ranges || !elementType) return {};
+    return elementType->array();
+}
+
+TypeChecker::Static TypeChecker::arrayAccess(const std::shared_ptr<ASTNode> &node) {
+    Static target = visit(node->children[0]);
+    const auto &indices = node->children[1]->children;
+    for (const auto &idx : indices) index(idx);
+
+    if (!target) return {};
+    if (!known(target, BaseType::Array)) {
+        error("Attempted array access on non-array");
+        return {};
+    }
+    if (indices.size() != 1 || indices[0]->type == ASTNode::Type::RANGE) return target;
+    if (!elementsTrusted || !target->hasElement() || target->element().match(BaseType::NIL)) return {};
+    return target->element();
+}
+
+// Stores are not checked while running, so one that may not match the element type means no
+// element read from any array can be trusted to have it.
+TypeChecker::Static TypeChecker::arrayAssign(const std::shared_ptr<ASTNode> &node) {
+    Static target = visit(node->children[0]);
+    for (const auto &idx : node->children[1]->children) index(idx);
+    Static value = visit(node->children[2]);
+
+    if (target && !known(target, BaseType::Array)) error("Attempted array assignment on non-array");
+
+    bool fits = false;
+    if (known(target, BaseType::Array) && target->hasElement() && value) {
+        Type element = target->element();
+        fits = value->match(element) ||
+            (value->kind() == BaseType::Array && value->hasElement() && value->element().match(element));
+    }
+    if (!fits && elementsTrusted) {
+        elementsTrusted = false;
+        changed = true;
+    }
+    return target;
+}
+
+TypeChecker::Static TypeChecker::call(const std::shared_ptr<ASTNode> &node) {
+    const auto &callee = node->children[0];
+    bool named = callee->type == ASTNode::Type::IDENTIFIER;
+    Static calleeType = named ? identifier(callee, true) : visit(callee);
+    const ASTNode *symbol = named ? lookup(callee->strValue()) : importedSymbol(*callee);
+    if (!named && symbol) calleeType = typeOf(symbol);
+    if (calleeType && !known(calleeType, BaseType::Function)) error("Attempted to call a non-function value");
+
+    std::vector<Static> args;
+    for (size_t i = 1; i < node->children.size(); ++i) {
+        const auto &arg = node->children[i];
+        if (arg->type == ASTNode::Type::RANGE) {
+            index(arg);
+            args.emplace_back();
+        } else {
+            args.push_back(visit(arg));
+        }
+    }
+
+    if (!symbol || !calleeType) return {};
+    const Symbol &info = symbols.at(symbol);
+    if (!info.function) return {};
+
+    const ASTNode &fn = *info.function;
+    Type retType = returnType(fn);
+    if (info.native) return retType;
+
+    // same order of checks as Executor::callFunction
+    size_t paramCount = fn.children.size() - 1;
+    bool proven = true;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i >= paramCount) {
+            error("Too many arguments provided for function");
+            proven = false;
+            break;
+        }
+
+        const ASTNode &param = *fn.children[i];
+        Type type = parameterType(param);
+        for (size_t j = i; j < (isVararg(param) ? args.size() : i + 1); ++j) {
+            if (args[j] && !args[j]->match(type))
+                error("Expected type " + type.toString() + " but got " + args[j]->toString());
+            proven = proven && same(args[j], type);
+        }
+        if (isVararg(param)) break;
+    }
+    if (args.size() < paramCount) grow(opaqueParams, &fn);
+
+    prove(*node, proven);
+    if (reporting && proven) callees[node.get()] = &fn;
+    return retType;
+}
+
+TypeChecker::Static TypeChecker::binaryOp(const std::shared_ptr<ASTNode> &node) {
+    Static lhs = visit(node->children[0]);
+    Static rhs = visit(node->children[1]);
+    BinaryOp op = node->binopValue;
+
+    // a string on the left only concatenates or repeats, see Executor::evaluateBinaryOp
+    if (known(lhs, BaseType::String) && (op == PLUS || op == MULTIPLY)) {
+        if (op == MULTIPLY && rhs && !known(rhs, BaseType::Int)) error("Cannot multiply a string with a non-integer");
+        return Type(BaseType::String);
+    }
+
+    // an unknown left side may still be a string at run time, which concatenates anything
+    if (!lhs && (op == PLUS || op == MULTIPLY)) {
+        if (op == MULTIPLY && rhs && !known(rhs, BaseType::Int)) error("Expected integer value");
+        return {};
+    }
+
+    if ((lhs &&!known(lhs, BaseType::Int)) || (rhs && !known(rhs, BaseType::Int))) {
+        error("Expected integer value");
+        return {};
+    }
+
+    switch (binaryResultType(op, StaticType::Int)) {
+        case StaticType::Bool: return Type(BaseType::Bool);
+        case StaticType::Int: return Type(BaseType::Int);
+        default: return {};
+    }
+}
+
+TypeChecker::Static TypeChecker::unaryOp(const std::shared_ptr<ASTNode> &node) {
+    Static operand = visit(node->children[0]);
+    if (operand && !known(operand, BaseType::Int)) error("Expected integer value");
+
+    switch (node->binopValue) {
+        case MINUS:
+        case BITWISE_NOT: return Type(BaseType::Int);
+        case NOT: return Type(BaseType::Bool);
+        default: return {};
+    }
+}
+
+TypeChecker::Static TypeChecker::read(const std::shared_ptr<ASTNode> &node) {
+    Static target = visit(node->children[0]);
+    const std::string &prop = node->children[1]->strValue();
+    if (!target) return {};
+
+    switch (target->kind()) {
+        case BaseType::Struct: {
+            if (!structs.contains(target->name())) return {};
+            for (const auto &[name, type] : structs.at(target->name()))
+                if (name == prop) return type;
+            error("Struct does not have field: " + prop);
+            return {};
+        }
+        case BaseType::Array:
+            if (prop == "length") return Type(BaseType::Int);
+            error("Unknown array property: " + prop);
+            return {};
+        case BaseType::ExportData: return {};
+        default:
+            error("Attempted READ on non-object");
+            return {};
+    }
+}
+
+// Types only what needs no scope: the parameters are the only names, and they hold their declared types.
+TypeChecker::Static TypeChecker::parameterExpression(const ASTNode &node, const ASTNode &function) const {
+    switch (node.type) {
+        case ASTNode::Type::NUMBER: return Type(BaseType::Int);
+        case ASTNode::Type::BOOL: return Type(BaseType::Bool);
+        case ASTNode::Type::STRING: return Type(BaseType::String);
+        case ASTNode::Type::IDENTIFIER:
+            for (size_t i = 0; i + 1 < function.children.size(); ++i) {
+                const ASTNode &param = *function.children[i];
+                if (param.symbol == node.symbol) return isVararg(param) ? Static() : Static(parameterType(param));
+            }
+            return {};
+        case ASTNode::Type::UNARY_OP: {
+            Static operand = parameterExpression(*node.children[0], function);
+            if (!known(operand, BaseType::Int)) return {};
+            switch (node.binopValue) {
+                case MINUS:
+                case BITWISE_NOT: return Type(BaseType::Int);
+                case NOT: return Type(BaseType::Bool);
+                default: return {};
+            }
+        }
+        case ASTNode::Type::BINARY_OP: {
+            Static lhs = parameterExpression(*node.children[0], function);
+            Static rhs = parameterExpression(*node.children[1], function);
+            if (!lhs || !rhs) return {};
+            if (known(lhs, BaseType::String) && node.binopValue == PLUS) return Type(BaseType::String);
+            if (known(lhs, BaseType::String) && node.binopValue == MULTIPLY)
+                return known(rhs, BaseType::Int) ? Static(Type(BaseType::String)) : Static();
+            if (!known(lhs, BaseType::Int) || !known(rhs, BaseType::Int)) return {};
+            switch (binaryResultType(node.binopValue, StaticType::Int)) {
+                case StaticType::Bool: return Type(BaseType::Bool);
+                case StaticType::Int: return Type(BaseType::Int);
+                default: return {};
+            }
+        }
+        case ASTNode::Type::READ: {
+            Static target = parameterExpression(*node.children[0], function);
+            const std::string &prop = node.children[1]->strValue();
+            if (known(target, BaseType::Array)) return prop == "length" ? Static(Type(BaseType::Int)) : Static();
+            if (!known(target, BaseType::Struct) || !structs.contains(target->name())) return {};
+            for (const auto &[name, type] : structs.at(target->name()))
+                if (name == prop) return type;
+            return {};
+        }
+        default: return {};
+    }
+}
@@ -0,0 +1,817 @@
+#include "closure.hpp"
+#include <stdexcept>
+
+static void incompatible(const Type &expected, const Type &got, const std::string &field = "") {
+    throw std::runtime_error("Incompatible types for assignment; expected " + expected.toString() +
+                             " but got " + got.toString() + (field.empty() ? "" : " for field: " + field));
+}
+
+static const TypedValue &element(const PArray &arr, int idx) {
+    if (idx < 0 || static_cast<size_t>(idx) >= arr->elements.size())
+        throw std::runtime_error("Array index out of bounds: " + std::to_string(idx));
+    return arr->elements[idx];
+}
+
+static PArray arrayOperand(const TypedValue &val, const char *err) {
+    if (val.kind() != BaseType::Array) throw std::runtime_error(err);
+    return val.get<PArray>();
+}
+
+// NDArray elements cycle through the right hand side when it is an array
+static TypedValue ndElement(const TypedValue &val, int flatIndex) {
+    if (!val.is(BaseType::Array)) return val;
+    const auto &elements = val.get<PArray>()->elements;
+    return elements.empty() ? TypedValue(0) : elements[flatIndex % elements.size()];
+}
+
+// Int only operations, specialized on whether the operands are plain slots or constants.
+template <typename Fn, typename O>
+static Expr intBinary(const O &l, const O &r) {
+    if (l.slot && r.constant) {
+        uint16_t a = *l.slot;
+        int k = *r.constant;
+        return [a, k](Frame &f) { return TypedValue(Fn{}(f.slots[a].template get<int>(), k)); };
+    }
+    if (l.slot && r.slot) {
+        uint16_t a = *l.slot, b = *r.slot;
+        return [a, b](Frame &f) { return TypedValue(Fn{}(f.slots[a].template get<int>(), f.slots[b].template get<int>())); };
+    }
+    Expr lhs = l.eval, rhs = r.eval;
+    if (r.constant) {
+        int k = *r.constant;
+        return [lhs, k](Frame &f) { return TypedValue(Fn{}(lhs(f).template get<int>(), k)); };
+    }
+    return [lhs, rhs](Frame &f) {
+        int a = lhs(f).template get<int>();
+        return TypedValue(Fn{}(a, rhs(f).template get<int>()));
+    };
+}
+
+template <typename Fn, typename O>
+static Cond intCompare(const O &l, const O &r) {
+    if (l.slot && r.constant) {
+        uint16_t a = *l.slot;
+        int k = *r.constant;
+        return [a, k](Frame &f) { return Fn{}(f.slots[a].template get<int>(), k); };
+    }
+    if (l.slot && r.slot) {
+        uint16_t a = *l.slot, b = *r.slot;
+        return [a, b](Frame &f) { return Fn{}(f.slots[a].template get<int>(), f.slots[b].template get<int>()); };
+    }
+    Expr lhs = l.eval, rhs = r.eval;
+    return [lhs, rhs](Frame &f) {
+        int a = lhs(f).template get<int>();
+        return Fn{}(a, rhs(f).template get<int>());
+    };
+}
+
+template <typename O>
+static Expr intBinaryFor(BinaryOp op, const O &l, const O &r) {
+    switch (op) {
+        case PLUS:          return intBinary<std::plus<int>>(l, r);
+        case MINUS:         return intBinary<std::minus<int>>(l, r);
+        case MULTIPLY:      return intBinary<std::multiplies<int>>(l, r);
+        case DIVIDE:        return intBinary<std::divides<int>>(l, r);
+        case MODULUS:       return intBinary<std::modulus<int>>(l, r);
+        case COMPARISON:    return intBinary<std::equal_to<int>>(l, r);
+        case LESS:          return intBinary<std::less<int>>(l, r);
+        case GREATER:       return intBinary<std::greater<int>>(l, r);
+        case LESS_EQUAL:    return intBinary<std::less_equal<int>>(l, r);
+        case GREATER_EQUAL: return intBinary<std::greater_equal<int>>(l, r);
+        default:            return nullptr;
+    }
+}
+
+template <typename O>
+static Cond intCompareFor(BinaryOp op, const O &l, const O &r) {
+    switch (op) {
+        case COMPARISON:    return intCompare<std::equal_to<int>>(l, r);
+        case LESS:          return intCompare<std::less<int>>(l, r);
+        case GREATER:       return intCompare<std::greater<int>>(l, r);
+        case LESS_EQUAL:    return intCompare<std::less_equal<int>>(l, r);
+        case GREATER_EQUAL: return intCompare<std::greater_equal<int>>(l, r);
+        default:            return nullptr;
+    }
+}
+
+std::shared_ptr<CompiledProto> ClosureCompiler::compileModule(const std::shared_ptr<ASTNode> &pragma) {
+    auto proto = std::make_shared<CompiledProto>();
+    proto->name = pragma->strValue();
+
+    FuncState state;
+    state.proto = proto;
+    state.isModule = true;
+    fs = &state;
+
+    std::vector<Stmt> statements;
+    const auto &children = pragma->children;
+    for (size_t i = 2; i < children.size(); ++i) statements.push_back(statement(children[i]));
+
+    // a top level return only ends the statement it appears in
+    proto->body = [statements](Frame &f) {
+        for (const auto &stmt : statements) stmt(f);
+        return false;
+    };
+
+    fs = nullptr;
+    return proto;
+}
+
+uint16_t ClosureCompiler::allocSlot() {
+    if (fs->nextSlot == UINT16_MAX)
+        throw std::runtime_error("Function " + fs->proto->name + " needs too many slots");
+    uint16_t slot = fs->nextSlot++;
+    fs->proto->slotCount = std::max(fs->proto->slotCount, fs->nextSlot);
+    return slot;
+}
+
+uint16_t ClosureCompiler::floor() const {
+    uint16_t base = fs->scopes.empty() ? 0 : fs->scopes.back().second;
+    if (fs->locals.empty()) return base;
+    return std::max<uint16_t>(fs->locals.back().slot + 1, base);
+}
+
+void ClosureCompiler::beginScope() {
+    fs->scopes.emplace_back(fs->locals.size(), fs->nextSlot);
+}
+
+void ClosureCompiler::endScope() {
+    auto [localCount, nextSlot] = fs->scopes.back();
+    fs->scopes.pop_back();
+    fs->locals.resize(localCount);
+    fs->nextSlot = nextSlot;
+}
+
+const ClosureCompiler::Local *ClosureCompiler::resolveLocal(const std::string &ident) const {
+    for (auto it = fs->locals.rbegin(); it != fs->locals.rend(); ++it)
+        if (it->name == ident) return &*it;
+    return nullptr;
+}
+
+bool ClosureCompiler::capturesLocal(const std::string &ident) const {
+    for (FuncState *state = fs->enclosing; state; state = state->enclosing)
+        for (const auto &local : state->locals)
+            if (local.name == ident) return true;
+    return false;
+}
+
+bool ClosureCompiler::definesGlobal() const {
+    return fs->isModule && fs->blockDepth == 0;
+}
+
+void ClosureCompiler::define(const std::string &ident, uint16_t slot, StaticType type) {
+    fs->locals.push_back({ident, slot, type});
+}
+
+Expr ClosureCompiler::store(const std::string &ident, std::optional<uint16_t> slot, Expr value) {
+    if (!slot) {
+        return [symbol = Symbols::intern(ident), value](Frame &f) {
+            TypedValue val = value(f);
+            f.env->set(symbol, val);
+            return val;
+        };
+    }
+    uint16_t s = *slot;
+    return [s, value](Frame &f) { return f.slots[s] = value(f); };
+}
+
+Stmt ClosureCompiler::statement(const std::shared_ptr<ASTNode> &node) {
+    if (!node) return [](Frame &) { return false; };
+
+    Stmt result;
+    switch (node->type) {
+        case ASTNode::Type::BLOCK:
+            beginScope();
+            fs->blockDepth++;
+            result = block(node->children);
+            fs->blockDepth--;
+            endScope();
+            break;
+        case ASTNode::Type::STRUCT_DECLARE: result = structDeclaration(node); break;
+        case ASTNode::Type::RETURN_STATEMENT: {
+            if (node->children.empty()) {
+                result = [](Frame &f) { f.ret = TypedValue(); return true; };
+                break;
+            }
+            Expr value = expr(node->children[0]);
+            result = [value](Frame &f) { f.ret = value(f); return true; };
+            break;
+        }
+        case ASTNode::Type::IF_STATEMENT: result = ifStatement(node); break;
+        case ASTNode::Type::WHILE_STATEMENT: result = whileStatement(node); break;
+        case ASTNode::Type::FOR_STATEMENT: result = forStatement(node); break;
+        case ASTNode::Type::FUNCTION: result = function(node); break;
+        case ASTNode::Type::NATIVE_STATEMENT: result = nativeStatement(node); break;
+        default: {
+            Expr value = expr(node);
+            result = [value](Frame &f) { value(f); return false; };
+            break;
+        }
+    }
+
+    fs->nextSlot = floor();
+    return result;
+}
+
+Stmt ClosureCompiler::block(const ASTChildren &nodes) {
+    std::vector<Stmt> statements;
+    for (const auto &node : nodes) statements.push_back(statement(node));
+    return [statements](Frame &f) {
+        for (const auto &stmt : statements)
+            if (stmt(f)) return true;
+        return false;
+    };
+}
+
+Stmt ClosureCompiler::ifStatement(const std::shared_ptr<ASTNode> &node) {
+    Cond cond = condition(node->children[0]);
+    Stmt then = statement(node->children[1]);
+    if (node->children.size() > 2 && node->children[2]->type == ASTNode::Type::ELSE_STATEMENT) {
+        Stmt otherwise = statement(node->children[2]->children[0]);
+        return [cond, then, otherwise](Frame &f) { return cond(f) ? then(f) : otherwise(f); };
+    }
+    return [cond, then](Frame &f) { return cond(f) && then(f); };
+}
+
+Stmt ClosureCompiler::whileStatement(const std::shared_ptr<ASTNode> &node) {
+    Cond cond = condition(node->children[0]);
+    Stmt body = statement(node->children[1]);
+    return [cond, body](Frame &f) {
+        while (cond(f))
+            if (body(f)) return true;
+        return false;
+    };
+}
+
+Stmt ClosureCompiler::forStatement(const std::shared_ptr<ASTNode> &node) {
+    beginScope();
+    fs->blockDepth++;
+
+    Stmt result;
+    if (node->strValue() == "0") {
+        Stmt init = statement(node->children[0]);
+        Cond cond = condition(node->children[1]);
+        Stmt body = statement(node->children[3]);
+        Expr update = expr(node->children[2]);
+        result = [init, cond, body, update](Frame &f) {
+            init(f);
+            while (cond(f)) {
+                if (body(f)) return true;
+                update(f);
+            }
+            return false;
+        };
+    } else {
+        Expr iterable = expr(node->children[1]);
+        uint16_t var = allocSlot();
+        define(node->children[0]->strValue(), var, StaticType::Unknown);
+        Stmt body = statement(node->children[2]);
+        result = [iterable, var, body](Frame &f) {
+            TypedValue val = iterable(f);
+            if (val.kind() != BaseType::Array)
+                throw std::runtime_error("Expected array for enhanced for loop");
+            auto arr = val.get<PArray>();
+            for (const auto &item : arr->elements) {
+                f.slots[var] = item;
+                if (body(f)) return true;
+            }
+            return false;
+        };
+    }
+
+    fs->blockDepth--;
+    endScope();
+    return result;
+}
+
+Stmt ClosureCompiler::function(const std::shared_ptr<ASTNode> &node) {
+    auto funcData = executor.executeFunctionDefinition(node, nullptr);
+
+    auto proto = std::make_shared<CompiledProto>();
+    proto->name = node->strValue();
+    proto->signature = funcData;
+
+    FuncState state;
+    state.proto = proto;
+    state.enclosing = fs;
+    FuncState *parent = fs;
+    fs = &state;
+
+    // arguments are type checked on entry, so the parameter slots keep their static type
+    for (const auto &param : funcData->params)
+        define(param.ident, allocSlot(), param.vararg ? StaticType::Unknown : staticTypeOf(param.type));
+    proto->body = statement(funcData->body);
+
+    fs = parent;
+    std::optional<uint16_t> slot;
+    if (!definesGlobal()) slot = allocSlot();
+
+    ClosureEngine *eng = &engine;
+    Expr make = store(node->strValue(), slot, [eng, proto](Frame &f) { return TypedValue(eng->makeClosure(proto, f.env)); });
+    if (slot) define(node->strValue(), *slot, StaticType::Unknown);
+    return [make](Frame &f) { make(f); return false; };
+}
+
+Stmt ClosureCompiler::nativeStatement(const std::shared_ptr<ASTNode> &node) {
+    auto funcData = executor.executeFunctionDefinition(node->children[0], nullptr);
+    std::optional<uint16_t> slot;
+    if (!definesGlobal()) slot = allocSlot();
+
+    Executor *exec = &executor;
+    std::string name = node->strValue();
+    Expr make = store(name, slot, [exec, name, funcData](Frame &f) {
+        return TypedValue(exec->createNativeFunction(name, funcData, f.env));
+    });
+    if (slot) define(name, *slot, StaticType::Unknown);
+    return [make](Frame &f) { make(f); return false; };
+}
+
+Stmt ClosureCompiler::structDeclaration(const std::shared_ptr<ASTNode> &node) {
+    auto structType = std::make_shared<StructType>(node->strValue());
+    for (const auto &child : node->children) {
+        if (child->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT)
+            structType->fields.emplace_back(child->symbol, child->primitiveValue);
+        else
+            structType->fields.emplace_back(child->symbol, child->children[0]->strValue());
+    }
+    return [structType, name = node->symbol](Frame &f) {
+        f.env->setType(name, structType);
+        return false;
+    };
+}
+
+Expr ClosureCompiler::assignment(const std::shared_ptr<ASTNode> &node, StaticType &type) {
+    const auto &children = node->children;
+    type = StaticType::Unknown;
+
+    // struct property assignment
+    if (children.size() > 1 && children[0]->type == ASTNode::Type::READ) {
+        const auto &readNode = children[0];
+        Symbol field = readNode->children[1]->symbol;
+        Expr target = expr(readNode->children[0]);
+        uint16_t old = allocSlot();
+        fs->selfRefs.emplace_back(old, StaticType::Unknown);
+        Expr value = expr(children[1]);
+        fs->selfRefs.pop_back();
+        bool emptyLiteral = children[1]->type == ASTNode::Type::ARRAY_LITERAL && children[1]->children.empty();
+
+        return [target, value, old, field, emptyLiteral](Frame &f) {
+            TypedValue obj = target(f);
+            if (!obj.is(BaseType::Struct))
+                throw std::runtime_error("Left-hand side of assignment is not a struct or object");
+            TypedValue *slot = obj.get<PStruct>()->findField(field);
+            if (!slot) throw std::runtime_error("Struct does not have field: " + Symbols::name(field));
+
+            f.slots[old] = *slot;
+            TypedValue val = value(f);
+            if (emptyLiteral) incompatible(slot->type(), Type(BaseType::Array), Symbols::name(field));
+            if (!val.type().match(slot->type())) incompatible(slot->type(), val.type(), Symbols::name(field));
+            *slot = val;
+            return val;
+        };
+    }
+
+    const std::string &ident = node->strValue();
+    Symbol symbol = node->symbol;
+    bool isLiteral = !children.empty() && children[0]->type == ASTNode::Type::ARRAY_LITERAL;
+    bool emptyLiteral = isLiteral && children[0]->children.empty();
+
+    if (node->primitiveValue == Primitive::NONE) {
+        if (const Local *local = resolveLocal(ident)) {
+            uint16_t slot = local->slot;
+            StaticType varType = local->type;
+            fs->selfRefs.emplace_back(slot, varType);
+            StaticType valType;
+            Expr value = expr(children[0], valType);
+            fs->selfRefs.pop_back();
+
+            if (varType != StaticType::Unknown && valType == varType) {
+                type = varType;
+                return [slot, value](Frame &f) { return f.slots[slot] = value(f); };
+            }
+            // slots with a static type must keep it, so only untyped ones get the array literal leniency
+            bool lenient = isLiteral && varType == StaticType::Unknown;
+            return [slot, value, lenient, emptyLiteral](Frame &f) {
+                TypedValue val = value(f);
+                if (lenient) {
+                    if (emptyLiteral) incompatible(Type(BaseType::Array), val.type());
+                } else if (!val.type().match(f.slots[slot].type())) {
+                    incompatible(f.slots[slot].type(), val.type());
+                }
+                return f.slots[slot] = val;
+            };
+        }
+        if (capturesLocal(ident)) {
+            return [ident](Frame &) -> TypedValue {
+                throw std::runtime_error("Closure engine cannot capture local variable: " + ident);
+            };
+        }
+
+        uint16_t old = allocSlot();
+        fs->selfRefs.emplace_back(old, StaticType::Unknown);
+        Expr value = expr(children[0]);
+        fs->selfRefs.pop_back();
+        return [symbol, old, value, isLiteral, emptyLiteral](Frame &f) {
+            f.slots[old] = f.env->get(symbol);
+            TypedValue val = value(f);
+            if (isLiteral) {
+                if (emptyLiteral) incompatible(Type(BaseType::Array), val.type());
+            } else if (!val.type().match(f.slots[old].type())) {
+                incompatible(f.slots[old].type(), val.type());
+            }
+            f.env->modify(symbol, val);
+            return val;
+        };
+    }
+
+    std::optional<uint16_t> slot;
+    if (!definesGlobal()) slot = allocSlot();
+
+    Expr value;
+    std::optional<Type> expected;
+    StaticType declared = StaticType::Unknown;
+    if (children.empty()) {
+        TypedValue def = executor.primitiveValue(node->primitiveValue);
+        value = [def](Frame &) { return def; };
+        declared = staticTypeOf(def.type());
+    } else if (isLiteral) {
+        value = expr(children[0]);
+        if (emptyLiteral) expected = Type(BaseType::Array);
+    } else if (children[0]->type == ASTNode::Type::SIZED_ARRAY_DECLARE) {
+        value = expr(children[0]);
+        if (children[0]->primitiveValue != node->primitiveValue) expected = Type(node->primitiveValue).array();
+    } else {
+        Type declaredType(node->primitiveValue);
+        declared = staticTypeOf(declaredType);
+        StaticType valType;
+        value = expr(children[0], valType);
+        if (valType != declared) expected = declaredType;
+    }
+
+    if (expected) {
+        Type want = *expected;
+        Expr unchecked = value;
+        value = [unchecked, want](Frame &f) {
+            TypedValue val = unchecked(f);
+            if (!val.type().match(want)) incompatible(want, val.type());
+            return val;
+        };
+    }
+
+    if (slot) define(ident, *slot, declared);
+    type = declared;
+    return store(ident, slot, value);
+}
+
+Expr ClosureCompiler::structAssignment(const std::shared_ptr<ASTNode> &node) {
+    std::optional<uint16_t> slot;
+    if (!definesGlobal()) slot = allocSlot();
+
+    std::string structName = node->children[0]->strValue();
+    Symbol structSymbol = node->children[0]->symbol;
+    std::vector<std::pair<std::string, Expr>> args; // name is empty for positional arguments
+    for (size_t i = 1; i < node->children.size(); ++i) {
+        const auto &arg = node->children[i];
+        if (arg->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT)
+            args.emplace_back(arg->strValue(), expr(arg->children[0]));
+        else
+            args.emplace_back("", expr(arg));
+    }
+    if (slot) define(node->strValue(), *slot, StaticType::Unknown);
+
+    return store(node->strValue(), slot, [structName, structSymbol, args](Frame &f) {
+        auto structType = f.env->getType(structSymbol);
+        if (!structType) throw std::runtime_error("Unknown struct type: " + structName);
+        if (args.size() != structType->fields.size())
+            throw std::runtime_error("Struct assignment has incorrect number of arguments");
+
+        auto instance = makeRef<Struct>(structName, structType);
+        for (size_t i = 0; i < args.size(); ++i) {
+            auto &field = structType->fields[i];
+            TypedValue val = args[i].second(f);
+            if (!val.type().match(field.second)) {
+                throw std::runtime_error(args[i].first.empty()
+                    ? "Type mismatch for field at index " + std::to_string(i)
+                    : "Type mismatch for field: " + args[i].first);
+            }
+            instance->fields.emplace_back(field.first, val);
+        }
+        return TypedValue(instance);
+    });
+}
+
+Expr ClosureCompiler::ndarrayAssignment(const std::shared_ptr<ASTNode> &node) {
+    const auto &children = node->children;
+    int efficiency = children[0]->intValue;
+
+    std::optional<uint16_t> slot;
+    if (!definesGlobal()) slot = allocSlot();
+
+    std::vector<Expr> shapeExprs;
+    for (size_t i = 1; i < children.size() - 1; ++i) shapeExprs.push_back(expr(children[i]));
+
+    uint16_t self = allocSlot();
+    if (efficiency != 0) fs->selfRefs.emplace_back(self, efficiency == 1 ? StaticType::Int : StaticType::Unknown);
+    Expr rhs = expr(children.back());
+    if (efficiency != 0) fs->selfRefs.pop_back();
+    if (slot) define(node->strValue(), *slot, StaticType::Unknown);
+
+    Executor *exec = &executor;
+    return store(node->strValue(), slot, [shapeExprs, rhs, self, efficiency, exec](Frame &f) {
+        std::vector<int> shape;
+        for (const auto &dim : shapeExprs) shape.push_back(exec->getIntValue(dim(f)));
+        int totalElements = 1;
+        for (int dim : shape) totalElements *= dim;
+
+        auto resultArr = makeRef<Array>();
+        resultArr->elementType = Type(Primitive::INT);
+
+        switch (efficiency) {
+            case 0: {
+                TypedValue val = rhs(f);
+                for (int flatIndex = 0; flatIndex < totalElements; ++flatIndex)
+                    resultArr->elements.push_back(ndElement(val, flatIndex));
+                break;
+            }
+            case 1:
+                for (int flatIndex = 0; flatIndex < totalElements; ++flatIndex) {
+                    f.slots[self] = TypedValue(flatIndex);
+                    resultArr->elements.push_back(ndElement(rhs(f), flatIndex));
+                }
+                break;
+            case 2: {
+                auto indexArr = makeRef<Array>();
+                indexArr->elementType = Type(Primitive::INT);
+                indexArr->elements.assign(shape.size(), TypedValue(0));
+                f.slots[self] = TypedValue(indexArr);
+
+                for (int flatIndex = 0; flatIndex < totalElements; ++flatIndex) {
+                    resultArr->elements.push_back(ndElement(rhs(f), flatIndex));
+                    for (int d = static_cast<int>(shape.size()) - 1; d >= 0; --d) {
+                        int next = indexArr->elements[d].get<int>() + 1;
+                        indexArr->elements[d] = TypedValue(next);
+                        if (next < shape[d]) break;
+                        indexArr->elements[d] = TypedValue(0);
+                    }
+                }
+                break;
+            }
+        }
+
+        return TypedValue(resultArr);
+    });
+}
+
+Cond ClosureCompiler::condition(const std::shared_ptr<ASTNode> &node) {
+    Executor *exec = &executor;
+    if (node->type == ASTNode::Type::BINARY_OP) {
+        BinaryOp op = node->binopValue;
+        Operand l = operand(node->children[0]);
+        Operand r = operand(node->children[1]);
+        if (l.type == StaticType::Int && r.type == StaticType::Int) {
+            if (Cond cond = intCompareFor(op, l, r)) return cond;
+        }
+        Expr lhs = l.eval, rhs = r.eval;
+        return [lhs, rhs, op, exec](Frame &f) {
+            TypedValue a = lhs(f);
+            TypedValue b = rhs(f);
+            return exec->getBoolValue(exec->evaluateBinaryOp(a, b, op));
+        };
+    }
+
+    Expr value = expr(node);
+    return [value, exec](Frame &f) { return exec->getBoolValue(value(f)); };
+}
+
+ClosureCompiler::Operand ClosureCompiler::operand(const std::shared_ptr<ASTNode> &node) {
+    Operand result;
+    result.eval = expr(node, result.type);
+    if (node->type == ASTNode::Type::IDENTIFIER) {
+        if (const Local *local = resolveLocal(node->strValue())) result.slot = local->slot;
+    } else if (node->type == ASTNode::Type::SELF_REFERENCE && !fs->selfRefs.empty()) {
+        result.slot = fs->selfRefs.back().first;
+    } else if (node->type == ASTNode::Type::NUMBER) {
+        result.constant = node->intValue;
+    }
+    return result;
+}
+
+Expr ClosureCompiler::expr(const std::shared_ptr<ASTNode> &node) {
+    StaticType ignored;
+    return expr(node, ignored);
+}
+
+Expr ClosureCompiler::expr(const std::shared_ptr<ASTNode> &node, StaticType &type) {
+    type = StaticType::Unknown;
+    Executor *exec = &executor;
+
+    switch (node->type) {
+        case ASTNode::Type::NUMBER: {
+            TypedValue val(node->intValue);
+            type = StaticType::Int;
+            return [val](Frame &) { return val; };
+        }
+        case ASTNode::Type::BOOL: {
+            TypedValue val(node->intValue != 0);
+            type = StaticType::Bool;
+            return [val](Frame &) { return val; };
+        }
+        case ASTNode::Type::STRING: {
+            TypedValue val(node->strValue());
+            type = StaticType::String;
+            return [val](Frame &) { return val; };
+        }
+        case ASTNode::Type::IDENTIFIER: {
+            std::string ident = node->strValue();
+            if (const Local *local = resolveLocal(ident)) {
+                uint16_t slot = local->slot;
+                type = local->type;
+                return [slot](Frame &f) { return f.slots[slot]; };
+            }
+            if (capturesLocal(ident)) {
+                return [ident](Frame &) -> TypedValue {
+                    throw std::runtime_error("Closure engine cannot capture local variable: " + ident);
+                };
+            }
+            return [symbol = node->symbol](Frame &f) { return f.env->get(symbol); };
+        }
+        case ASTNode::Type::SELF_REFERENCE: {
+            if (fs->selfRefs.empty()) return [](Frame &) { return TypedValue(); };
+            auto [slot, selfType] = fs->selfRefs.back();
+            type = selfType;
+            return [slot](Frame &f) { return f.slots[slot]; };
+        }
+
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: return assignment(node, type);
+        case ASTNode::Type::STRUCT_ASSIGNMENT: return structAssignment(node);
+        case ASTNode::Type::NDARRAY_ASSIGN: return ndarrayAssignment(node);
+
+        case ASTNode::Type::ARRAY_ACCESS: {
+            Expr target = expr(node->children[0]);
+            const auto &idxNodes = node->children[1]->children;
+            if (idxNodes.size() == 1 && idxNodes[0]->type != ASTNode::Type::RANGE) {
+                Expr index = expr(idxNodes[0]);
+                return [target, index, exec](Frame &f) {
+                    auto arr = arrayOperand(target(f), "Attempted array access on non-array");
+                    return element(arr, exec->getIntValue(index(f)));
+                };
+            }
+            auto list = indices(node->children[1]);
+            return [target, list, exec](Frame &f) {
+                auto arr = arrayOperand(target(f), "Attempted array access on non-array");
+                auto idx = list(f);
+                for (int i : idx) element(arr, i);
+                return exec->arrayOperation(arr, idx);
+            };
+        }
+        case ASTNode::Type::ARRAY_ASSIGN: {
+            Expr target = expr(node->children[0]);
+            auto list = indices(node->children[1]);
+            Expr value = expr(node->children[2]);
+            return [target, list, value, exec](Frame &f) {
+                TypedValue arrVal = target(f);
+                auto arr = arrayOperand(arrVal, "Attempted array assignment on non-array");
+                auto idx = list(f);
+                for (int i : idx) element(arr, i);
+                exec->arrayOperation(arr, idx, value(f));
+                return arrVal;
+            };
+        }
+        case ASTNode::Type::ARRAY_LITERAL: return arrayLiteral(node);
+
+        case ASTNode::Type::CALL: return call(node);
+        case ASTNode::Type::BINARY_OP: return binaryOp(node, type);
+        case ASTNode::Type::UNARY_OP: {
+            Expr value = expr(node->children[0]);
+            BinaryOp op = node->binopValue;
+            if (op == MINUS || op == BITWISE_NOT) type = StaticType::Int;
+            else if (op == NOT) type = StaticType::Bool;
+            return [value, op, exec](Frame &f) { return exec->evaluateUnaryOp(value(f), op); };
+        }
+        case ASTNode::Type::READ: {
+            Expr target = expr(node->children[0]);
+            Symbol property = node->children[1]->symbol;
+            return [target, property, exec](Frame &f) { return exec->evaluateReadProperty(target(f), property); };
+        }
+        case ASTNode::Type::SIZED_ARRAY_DECLARE: {
+            Expr size = expr(node->children[0]);
+            TypedValue def = executor.primitiveValue(node->primitiveValue);
+            return [size, def, exec](Frame &f) {
+                int count = exec->getIntValue(size(f));
+                auto arr = makeRef<Array>();
+                arr->elementType = def.type();
+                arr->elements.assign(std::max(count, 0), def);
+                return TypedValue(arr);
+            };
+        }
+
+        default: {
+            std::string msg = "Unsupported expression type: " + std::to_string(static_cast<int>(node->type));
+            return [msg](Frame &) -> TypedValue { throw std::runtime_error(msg); };
+        }
+    }
+}
+
+Expr ClosureCompiler::binaryOp(const std::shared_ptr<ASTNode> &node, StaticType &type) {
+    BinaryOp op = node->binopValue;
+    Operand l = operand(node->children[0]);
+    Operand r = operand(node->children[1]);
+
+    if (l.type == StaticType::Int && r.type == StaticType::Int) {
+        if (Expr typed = intBinaryFor(op, l, r)) {
+            type = binaryResultType(op, StaticType::Int);
+            return typed;
+        }
+    }
+
+    type = binaryResultType(op, l.type);
+    Expr lhs = l.eval, rhs = r.eval;
+    Executor *exec = &executor;
+    return [lhs, rhs, op, exec](Frame &f) {
+        TypedValue a = lhs(f);
+        TypedValue b = rhs(f);
+        return exec->evaluateBinaryOp(a, b, op);
+    };
+}
+
+Expr ClosureCompiler::call(const std::shared_ptr<ASTNode> &node) {
+    Expr callee = expr(node->children[0]);
+    std::vector<Expr> args;
+    for (size_t i = 1; i < node->children.size(); ++i) args.push_back(expr(node->children[i]));
+
+    ClosureEngine *eng = &engine;
+    return [callee, args, eng](Frame &f) {
+        TypedValue calleeVal = callee(f);
+        if (!calleeVal.is(BaseType::Function))
+            throw std::runtime_error("Attempted to call a non-function value");
+        PFunction func = calleeVal.get<PFunction>();
+        if (func->compiled) return eng->call(*func->compiled, f, args);
+
+        std::vector<std::shared_ptr<TypedValue>> argv;
+        argv.reserve(args.size());
+        for (const auto &arg : args) argv.push_back(std::make_shared<TypedValue>(arg(f)));
+        return *func->fn(argv);
+    };
+}
+
+Expr ClosureCompiler::arrayLiteral(const std::shared_ptr<ASTNode> &node) {
+    struct Item {
+        Expr value; // start of the range for ranges
+        Expr end;
+    };
+    std::vector<Item> items;
+    for (const auto &child : node->children) {
+        if (child->type == ASTNode::Type::RANGE) items.push_back({expr(child->children[0]), expr(child->children[1])});
+        else items.push_back({expr(child), nullptr});
+    }
+
+    Executor *exec = &executor;
+    return [items, exec](Frame &f) {
+        auto arr = makeRef<Array>();
+        bool firstValSet = false;
+        for (const auto &item : items) {
+            if (item.end) {
+                if (firstValSet && !arr->elementType.match(BaseType::Int))
+                    throw std::runtime_error("RANGE literal is only allowed for integer arrays");
+                int start = exec->getIntValue(item.value(f));
+                int end = exec->getIntValue(item.end(f));
+                for (int i = start; i <= end; ++i) arr->elements.push_back(TypedValue(i));
+                firstValSet = true;
+                continue;
+            }
+            TypedValue val = item.value(f);
+            if (!firstValSet) {
+                arr->elementType = val.type();
+                firstValSet = true;
+            } else if (!val.type().match(arr->elementType)) {
+                throw std::runtime_error("Array literal elements must have the same type: got " +
+                                         val.type().toString() + " but expected " + arr->elementType.toString());
+            }
+            arr->elements.push_back(val);
+        }
+        return TypedValue(arr);
+    };
+}
+
+std::function<std::vector<int>(Frame &)> ClosureCompiler::indices(const std::shared_ptr<ASTNode> &indicesNode) {
+    std::vector<std::pair<Expr, Expr>> items; // second is the end of a range
+    for (const auto &child : indicesNode->children) {
+        if (child->type == ASTNode::Type::RANGE) items.emplace_back(expr(child->children[0]), expr(child->children[1]));
+        else items.emplace_back(expr(child), nullptr);
+    }
+
+    Executor *exec = &executor;
+    return [items, exec](Frame &f) {
+        std::vector<int> result;
+        for (const auto &[value, end] : items) {
+            int start = exec->getIntValue(value(f));
+            if (!end) {
+                result.push_back(start);
+                continue;
+            }
+            int last = exec->getIntValue(end(f));
+            for (int i = start; i <= last; ++i) result.push_back(i);
+        }
+        return result;
+    };
+}
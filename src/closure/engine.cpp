@@ -0,0 +1,104 @@
+#include "closure.hpp"
+#include <stdexcept>
+
+ClosureEngine::ClosureEngine(std::shared_ptr<ASTNode> root) : root(root), executor(root), compiler(*this, executor) {
+    globalEnv = std::make_shared<Environment>();
+    globalEnv->set("nil", TypedValue());
+}
+
+TypedValue ClosureEngine::run() {
+    for (auto &child : root->children) {
+        pragmas[child->strValue()] = child;
+        modules[child->strValue()] = compiler.compileModule(child);
+    }
+
+    executePragma(root->children.back(), globalEnv);
+    if (globalEnv->has("main")) {
+        auto mainFunc = globalEnv->get("main");
+        if (!mainFunc.is(BaseType::Function))
+            throw std::runtime_error("main is not a function type - received " + mainFunc.type().toString());
+        return *mainFunc.get<PFunction>()->fn({});
+    }
+    return TypedValue(0);
+}
+
+void ClosureEngine::handleImports(const ASTChildren &children, ENV env) {
+    const auto &maps = getImportMaps();
+    for (auto &child : children) {
+        const std::string &name = child->strValue();
+        if (name.ends_with(".lum")) {
+            if (!exportData.contains(name)) {
+                if (!pragmas.contains(name)) throw std::runtime_error("Unknown pragma: " + name);
+                if (std::find(handlingModules.begin(), handlingModules.end(), name) != handlingModules.end())
+                    throw std::runtime_error("Circular import: " + name);
+                executePragma(pragmas[name], std::make_shared<Environment>());
+            }
+            env->set(child->children[0]->strValue(), exportData[name]);
+            continue;
+        }
+        if (!maps.contains(name)) throw std::runtime_error("Unknown module: " + name);
+        maps.at(name)(env, &executor);
+    }
+}
+
+void ClosureEngine::executePragma(const std::shared_ptr<ASTNode> &node, ENV env) {
+    handlingModules.push_back(node->strValue());
+    auto &children = node->children;
+    handleImports(children[0]->children, env);
+    exportData[node->strValue()] = makeRef<ExportData>(node->strValue());
+
+    invoke(*modules[node->strValue()], env, nullptr, 0);
+
+    for (auto &exportNode : children[1]->children) {
+        if (!env->has(exportNode->symbol))
+            throw std::runtime_error("Cannot export undefined variable: " + exportNode->strValue());
+        exportData[node->strValue()]->addExport(exportNode->symbol, env);
+    }
+
+    handlingModules.pop_back();
+}
+
+PFunction ClosureEngine::makeClosure(const std::shared_ptr<CompiledProto> &proto, ENV env) {
+    auto closure = std::make_shared<CompiledClosure>(CompiledClosure{proto, env});
+    auto func = makeRef<Function>(Function{
+        [this, closure](const std::vector<std::shared_ptr<TypedValue>> &args) {
+            return std::make_shared<TypedValue>(call(*closure, args));
+        }
+    });
+    func->compiled = closure;
+    return func;
+}
+
+static size_t frameSize(const CompiledProto &proto, size_t argc) {
+    return std::max({static_cast<size_t>(proto.slotCount), proto.signature->params.size(), argc});
+}
+
+TypedValue ClosureEngine::call(const CompiledClosure &closure, const std::vector<std::shared_ptr<TypedValue>> &args) {
+    std::vector<TypedValue> slots(frameSize(*closure.proto, args.size()));
+    for (size_t i = 0; i < args.size(); ++i) slots[i] = *args[i];
+    return invoke(*closure.proto, closure.env, slots.data(), args.size());
+}
+
+TypedValue ClosureEngine::call(const CompiledClosure &closure, Frame &caller, const std::vector<Expr> &args) {
+    std::vector<TypedValue> slots(frameSize(*closure.proto, args.size()));
+    for (size_t i = 0; i < args.size(); ++i) slots[i] = args[i](caller);
+    return invoke(*closure.proto, closure.env, slots.data(), args.size());
+}
+
+TypedValue ClosureEngine::invoke(const CompiledProto &proto, ENV env, TypedValue *slots, size_t argc) {
+    if (!proto.signature) {
+        // modules own their slots, their declarations live in env
+        std::vector<TypedValue> moduleSlots(proto.slotCount);
+        Frame frame{moduleSlots.data(), env, TypedValue()};
+        proto.body(frame);
+        return TypedValue();
+    }
+
+    bindArguments(*proto.signature, slots, argc);
+    Frame frame{slots, env, TypedValue()};
+    TypedValue result = proto.body(frame) ? std::move(frame.ret) : TypedValue();
+    if (!proto.signature->retType.match(result.type()))
+        throw std::runtime_error("Function return type mismatch - got " + result.type().toString() +
+                                 " but expected " + proto.signature->retType.toString());
+    return result;
+}
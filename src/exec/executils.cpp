@@ -1,27 +1,20 @@
 #include "executor.hpp"
 #include "executils.hpp"
 #include "outstream.hpp"
+#include "jit.hpp"
 #include <iostream>
 #include <optional>
 #include <algorithm>
-#include <fstream>
 
-Executor::Executor(std::shared_ptr<ASTNode> root) : root(root) {
+Executor::Executor(std::shared_ptr<ASTNode> root, bool enableJit) : root(root) {
     globalEnv = std::make_shared<Environment>();
+    if (enableJit && Jit::supported()) jit = std::make_shared<Jit>();
 
     globalEnv->set("nil", TypedValue());
-
-    std::ofstream debugFile("astdebug2.txt");
-    if (debugFile.is_open()) {
-        debugFile << astToString(root).c_str();
-        debugFile.close();
-    } else {
-        std::cerr << "Failed to open astdebug2.txt for writing\n";
-    }
 }
 
 TypedValue Executor::handleNDArrayAssignment(std::shared_ptr<ASTNode> node, ENV env) {
-    int efficiency = std::stoi(node->children[0]->strValue);
+    int efficiency = node->children[0]->intValue;
 
     std::vector<int> shape;
     for (size_t i = 1; i < node->children.size() - 1; ++i)
@@ -31,7 +24,7 @@ TypedValue Executor::handleNDArrayAssignment(std::shared_ptr<ASTNode> node, ENV
     for (auto dim : shape) totalElements *= dim;
 
     std::shared_ptr<ASTNode> rhsNode = node->children.back();
-    auto resultArr = std::make_shared<Array>();
+    auto resultArr = makeRef<Array>();
     resultArr->elementType = Type(Primitive::INT);
 
     std::vector<int> indices(shape.size(), 0);
@@ -39,10 +32,10 @@ TypedValue Executor::handleNDArrayAssignment(std::shared_ptr<ASTNode> node, ENV
     switch(efficiency) {
         case 0: {
             TypedValue elementVal = evaluateExpression(rhsNode, env);
-            std::shared_ptr<Array> rhsArr;
+            PArray rhsArr;
 
-            if (elementVal.type.match(BaseType::Array)) {
-                rhsArr = elementVal.get<std::shared_ptr<Array>>();
+            if (elementVal.is(BaseType::Array)) {
+                rhsArr = elementVal.get<PArray>();
             }
 
             for (int flatIndex = 0; flatIndex < totalElements; ++flatIndex) {
@@ -65,8 +58,8 @@ TypedValue Executor::handleNDArrayAssignment(std::shared_ptr<ASTNode> node, ENV
                 TypedValue elementVal = evaluateExpression(rhsNode, env);
                 TypedValue finalVal;
 
-                if (elementVal.type.match(BaseType::Array)) {
-                    auto rhsArr = elementVal.get<std::shared_ptr<Array>>();
+                if (elementVal.is(BaseType::Array)) {
+                    auto rhsArr = elementVal.get<PArray>();
                     finalVal = rhsArr->elements.empty() 
                         ? TypedValue(0) 
                         : rhsArr->elements[flatIndex % rhsArr->elements.size()];
@@ -80,18 +73,18 @@ TypedValue Executor::handleNDArrayAssignment(std::shared_ptr<ASTNode> node, ENV
             break;
         }
         case 2: {
-            auto indexArr = std::make_shared<Array>();
+            auto indexArr = makeRef<Array>();
             indexArr->elementType = Type(Primitive::INT);
             for (auto idx : indices)
                 indexArr->elements.push_back(TypedValue(idx));
 
-            env->pushSelfRef(TypedValue(indexArr, Type(BaseType::Int)));
+            env->pushSelfRef(TypedValue(indexArr));
             for (int flatIndex = 0; flatIndex < totalElements; ++flatIndex) {
                 TypedValue elementVal = evaluateExpression(rhsNode, env);
                 TypedValue finalVal;
 
-                if (elementVal.type.match(BaseType::Array)) {
-                    auto rhsArr = elementVal.get<std::shared_ptr<Array>>();
+                if (elementVal.is(BaseType::Array)) {
+                    auto rhsArr = elementVal.get<PArray>();
                     finalVal = rhsArr->elements.empty() 
                         ? TypedValue(0) 
                         : rhsArr->elements[flatIndex % rhsArr->elements.size()];
@@ -114,36 +107,35 @@ TypedValue Executor::handleNDArrayAssignment(std::shared_ptr<ASTNode> node, ENV
         }
     }
 
-    env->set(node->strValue, TypedValue(resultArr, resultArr->elementType.array()));
-    return TypedValue(resultArr, resultArr->elementType.array());
+    declare(*node, env, TypedValue(resultArr));
+    return TypedValue(resultArr);
 }
 
 
 void Executor::handleStructDeclaration(std::shared_ptr<ASTNode> node, ENV env) {
-    std::string structName = node->strValue;
+    std::string structName = node->strValue();
     std::shared_ptr<StructType> _struct = std::make_shared<StructType>(structName);
 
     for (const auto &child : node->children) {
         if(child->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT) {
-            _struct->fields.push_back(std::make_pair(child->strValue, child->primitiveValue));
+            _struct->fields.emplace_back(child->symbol, child->primitiveValue);
         } else {
-            _struct->fields.push_back(std::make_pair(child->strValue, child->children[0]->strValue));
+            _struct->fields.emplace_back(child->symbol, child->children[0]->strValue());
         }
     }
 
-    env->setType(structName, _struct);
+    env->setType(node->symbol, _struct);
 }
 
 TypedValue Executor::handleStructAssignment(std::shared_ptr<ASTNode> node, ENV env) {
-    const std::string varName = node->strValue;
-    const std::string structName = node->children[0]->strValue;
+    const std::string structName = node->children[0]->strValue();
 
-    auto structType = env->getType(structName);
+    auto structType = env->getType(node->children[0]->symbol);
     if (!structType)
         throw std::runtime_error("Unknown struct type: " + structName);
 
     auto structDef = std::static_pointer_cast<StructType>(structType);
-    auto instance = std::make_shared<Struct>(structName, structType);
+    auto instance = makeRef<Struct>(structName, structType);
 
     if (node->children.size() - 1 != structDef->fields.size())
         throw std::runtime_error("Struct assignment has incorrect number of arguments");
@@ -154,14 +146,14 @@ TypedValue Executor::handleStructAssignment(std::shared_ptr<ASTNode> node, ENV e
         TypedValue val;
 
         if (argNode->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT) {
-            const std::string fieldName = argNode->strValue;
+            const std::string fieldName = argNode->strValue();
             TypedValue inner = evaluateExpression(argNode->children[0], env);
-            if (!inner.type.match(field.second))
+            if (!node->typeChecked && !inner.type().match(field.second))
                 throw std::runtime_error("Type mismatch for field: " + fieldName);
             val = inner;
         } else {
             TypedValue literal = evaluateExpression(argNode, env);
-            if (!literal.type.match(field.second))
+            if (!node->typeChecked && !literal.type().match(field.second))
                 throw std::runtime_error("Type mismatch for field at index " + std::to_string(i));
             val = literal;
         }
@@ -169,23 +161,23 @@ TypedValue Executor::handleStructAssignment(std::shared_ptr<ASTNode> node, ENV e
         instance->fields.emplace_back(field.first, val);
     }
 
-    TypedValue finalVal(instance, Type(structName));
-    env->set(varName, finalVal);
+    TypedValue finalVal(instance);
+    declare(*node, env, finalVal);
     return finalVal;
 }
 
 int Executor::getIntValue(const TypedValue &val) {
-    if(!val.type.match(BaseType::Int)) throw std::runtime_error("Expected integer value");
+    if(!val.is(BaseType::Int)) throw std::runtime_error("Expected integer value");
     return val.get<int>();
 }
 
 bool Executor::getBoolValue(const TypedValue &val) {
-    if(!val.type.match(BaseType::Bool)) throw std::runtime_error("Expected boolean value");
+    if(!val.is(BaseType::Bool)) throw std::runtime_error("Expected boolean value");
     return val.get<bool>();
 }
 
 std::string Executor::getStringValue(const TypedValue &val) {
-    if(!val.type.match(BaseType::String)) throw std::runtime_error("Expected string value");
+    if(!val.is(BaseType::String)) throw std::runtime_error("Expected string value");
     return val.get<std::string>();
 }
 
@@ -198,6 +190,12 @@ TypedValue Executor::primitiveValue(const Primitive val) {
     }
 }
 
+// An array literal already has the type of its elements, an empty one has none and so matches nothing.
+static Type literalType(const ASTNode &literal, const TypedValue &val) {
+    if (literal.type != ASTNode::Type::ARRAY_LITERAL) return val.type();
+    return literal.children.empty() ? Type(BaseType::Array) : val.type();
+}
+
 TypedValue Executor::handleAssignment(
     std::shared_ptr<ASTNode> node,
     ENV env,
@@ -207,92 +205,80 @@ TypedValue Executor::handleAssignment(
 
     TypedValue val;
 
-    auto inferArrayType = [this](const std::shared_ptr<ASTNode> &arrayNode, ENV env) -> Type {
-        if (arrayNode->children.empty()) return Type(BaseType::Array); // empty array defaults to array<nil>
-        TypedValue firstVal = evaluateExpression(arrayNode->children[0], env);
-        Type elemType = firstVal.type;
-
-        for (size_t i = 1; i < arrayNode->children.size(); ++i) {
-            TypedValue nextVal = evaluateExpression(arrayNode->children[i], env);
-            if (!nextVal.type.match(elemType))
-                throw std::runtime_error(
-                    "Array literal contains mixed types: " + elemType.toString() + " vs " + nextVal.type.toString()
-                );
-        }
-
-        return elemType.array();
-    };
-
     // Struct property assignment
     if (node->children.size() > 1 && node->children[0]->type == ASTNode::Type::READ) {
         auto readNode = node->children[0];
         TypedValue parentVal = evaluateExpression(readNode->children[0], env);
 
-        if (!parentVal.type.match(BaseType::Struct))
+        if (!parentVal.is(BaseType::Struct))
             throw std::runtime_error("Left-hand side of assignment is not a struct or object");
 
-        auto strPtr = parentVal.get<std::shared_ptr<Struct>>();
-        const std::string &prop = readNode->children[1]->strValue;
-
-        auto it = std::find_if(strPtr->fields.begin(), strPtr->fields.end(),
-                               [&prop](const auto &pair){ return pair.first == prop; });
-        if (it == strPtr->fields.end())
-            throw std::runtime_error("Struct does not have field: " + prop);
+        auto strPtr = parentVal.get<PStruct>();
+        const std::string &prop = readNode->children[1]->strValue();
+        TypedValue &field = structField(*readNode, strPtr);
 
-        env->pushSelfRef(it->second);
+        env->pushSelfRef(field);
         val = evaluateExpression(node->children[1], env);
 
-        if (node->children[1]->type == ASTNode::Type::ARRAY_LITERAL)
-            val.type = inferArrayType(node->children[1], env);
-
-        if (!val.type.match(it->second.type))
-            throw std::runtime_error("Incompatible types for assignment; expected " +
-                                     it->second.type.toString() + " but got " +
-                                     val.type.toString() + " for field: " + prop);
+        if (!node->typeChecked) {
+            Type type = literalType(*node->children[1], val);
+            if (!type.match(field.type()))
+                throw std::runtime_error("Incompatible types for assignment; expected " +
+                                         field.type().toString() + " but got " +
+                                         type.toString() + " for field: " + prop);
+        }
 
-        it->second = val;
+        field = val;
         env->popSelfRef();
         return val;
     }
 
     // Normal variable assignment
-    if (modify) env->pushSelfRef(env->get(node->strValue));
-    val = node->children.empty() ? TypedValue(0) : evaluateExpression(node->children[0], env);
-
-    // Infer array type and override expected type
-    Type type;
-    if (!node->children.empty() && node->children[0]->type == ASTNode::Type::ARRAY_LITERAL)
-        type = inferArrayType(node->children[0], env);
-    else 
-        type = Type(primVal);
-
-    if (!val.type.match(type))
-        throw std::runtime_error("Incompatible types for assignment; expected " +
-                                 type.toString() + " but got " +
-                                 val.type.toString());
+    bool resolved = node->address.slot != ASTNode::UNRESOLVED;
+    TypedValue current;
+    if (modify) {
+        current = resolved ? env->local(node->address) : env->get(node->symbol);
+        env->pushSelfRef(current);
+    }
+    val = node->children.empty() ? primitiveValue(primVal) : evaluateExpression(node->children[0], env);
+
+    if (!node->typeChecked) {
+        // An array literal overrides the expected type
+        Type type;
+        if (!node->children.empty() && node->children[0]->type == ASTNode::Type::ARRAY_LITERAL)
+            type = literalType(*node->children[0], val);
+        else if (modify)
+            type = current.type();
+        else if (!node->children.empty() && node->children[0]->type == ASTNode::Type::SIZED_ARRAY_DECLARE)
+            type = Type(primVal).array();
+        else 
+            type = Type(primVal);
+
+        if (!val.type().match(type))
+            throw std::runtime_error("Incompatible types for assignment; expected " +
+                                     type.toString() + " but got " +
+                                     val.type().toString());
+    }
 
-    if (modify) env->modify(node->strValue, val);
-    else env->set(node->strValue, val);
+    if (resolved) env->local(node->address) = val;
+    else if (modify) env->modify(node->symbol, val);
+    else env->set(node->symbol, val);
 
     if (modify) env->popSelfRef();
     return val;
 }
 
 template<typename T>
-TypedValue readOnArray(std::shared_ptr<T> arr, const std::string &property) {
-    if (property == "length") return TypedValue(static_cast<int>(arr->elements.size()));
-    throw std::runtime_error("Unknown array property: " + property);
+TypedValue readOnArray(const Ref<T> &arr, Symbol property) {
+    static const Symbol length = Symbols::intern("length");
+    if (property == length) return TypedValue(static_cast<int>(arr->elements.size()));
+    throw std::runtime_error("Unknown array property: " + Symbols::name(property));
 }
 
-TypedValue readOnStruct(const std::shared_ptr<Struct> &str, const std::string &property) {
-    auto it = std::find_if(str->fields.begin(), str->fields.end(),
-        [&property](const auto& pair){ return pair.first == property; });
-
-    if (it == str->fields.end()) {
-        throw std::runtime_error("Struct does not have field: " + property);
-    }
-
-    return it->second;
+TypedValue readOnStruct(const PStruct &str, Symbol property) {
+    TypedValue *field = str->findField(property);
+    if (!field) throw std::runtime_error("Struct does not have field: " + Symbols::name(property));
+    return *field;
 }
 
 TypedValue Executor::handleReadAssignment(
@@ -304,22 +290,16 @@ TypedValue Executor::handleReadAssignment(
         throw std::runtime_error("Expected READ node for member assignment");
 
     TypedValue parentVal = evaluateExpression(readNode->children[0], env);
-    const std::string &prop = readNode->children[1]->strValue;
+    const std::string &prop = readNode->children[1]->strValue();
     TypedValue val = evaluateExpression(valNode, env);
 
-    switch(parentVal.type.kind) {
+    switch(parentVal.kind()) {
         case BaseType::Struct: {
-            auto str = parentVal.get<std::shared_ptr<Struct>>();
-            auto it = std::find_if(str->fields.begin(), str->fields.end(),
-                [&prop](const auto &pair){ return pair.first == prop; });
-            if (it == str->fields.end())
-                throw std::runtime_error("Struct does not have field: " + prop);
-
-            it->second = val;
+            structField(*readNode, parentVal.get<PStruct>()) = val;
             break;
         }
         case BaseType::Array: {
-            auto arr = parentVal.get<std::shared_ptr<Array>>();
+            auto arr = parentVal.get<PArray>();
             if(prop == "length")
                 throw std::runtime_error("Cannot modify array length");
             throw std::runtime_error("Cannot modify array elements");
@@ -333,18 +313,18 @@ TypedValue Executor::handleReadAssignment(
 }
 
 
-TypedValue Executor::evaluateReadProperty(const TypedValue &target, const std::string &property) {
-    switch(target.type.kind) {
+TypedValue Executor::evaluateReadProperty(const TypedValue &target, Symbol property) {
+    switch(target.kind()) {
         case BaseType::Struct: {
-            auto str = target.get<std::shared_ptr<Struct>>();
+            auto str = target.get<PStruct>();
             return readOnStruct(str, property);
         }
         case BaseType::Array: {
-            auto arr = target.get<std::shared_ptr<Array>>();
+            auto arr = target.get<PArray>();
             return readOnArray(arr, property);
         }
         case BaseType::ExportData: {
-            auto exp = target.get<std::shared_ptr<ExportData>>();
+            auto exp = target.get<PExportData>();
             return exp->getExportedValue(property);
         }
         default:
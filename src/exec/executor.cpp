@@ -1,12 +1,14 @@
 #include "executor.hpp"
+#include "jit.hpp"
 #include "executils.hpp"
 #include "outstream.hpp"
 #include "filestream.hpp"
+#include "resolver.hpp"
 #include <iostream>
 #include <optional>
 #include <parserutils.hpp>
 
-void Executor::printArray(std::ostream *out, const std::shared_ptr<Array> &arr) {
+void Executor::printArray(std::ostream *out, const PArray &arr) {
     *out << "[";
     for (size_t i = 0; i < arr->elements.size(); ++i) {
         printValue(out, arr->elements[i]);
@@ -17,12 +19,12 @@ void Executor::printArray(std::ostream *out, const std::shared_ptr<Array> &arr)
     *out << "]";
 }
 
-void Executor::printStruct(std::ostream *out, const std::shared_ptr<Struct> &st) {
+void Executor::printStruct(std::ostream *out, const PStruct &st) {
     *out << st->name << "{";
     int idx = 0;
     for (const auto &[name, val] : st->fields) {
-        *out << name << ": ";
-        if(val.type.kind == BaseType::String) {
+        *out << Symbols::name(name) << ": ";
+        if(val.kind() == BaseType::String) {
             *out << "\"";
             printValue(out, val);
             *out << "\"";
@@ -37,7 +39,7 @@ void Executor::printStruct(std::ostream *out, const std::shared_ptr<Struct> &st)
 }
 
 void Executor::printValue(std::ostream *out, const TypedValue &val) {
-    switch (val.type.kind) {
+    switch (val.kind()) {
         case BaseType::Int:
             *out << val.get<int>();
             return;
@@ -54,13 +56,13 @@ void Executor::printValue(std::ostream *out, const TypedValue &val) {
             *out << "nil";
             return;
         case BaseType::Array:
-            printArray(out, val.get<std::shared_ptr<Array>>());
+            printArray(out, val.get<PArray>());
             return;
         case BaseType::Struct:
-            printStruct(out, val.get<std::shared_ptr<Struct>>());
+            printStruct(out, val.get<PStruct>());
             return;
         case BaseType::ExportData:
-            *out << "[file data of " << val.get<std::shared_ptr<ExportData>>()->fileName << "]";
+            *out << "[file data of " << val.get<PExportData>()->fileName << "]";
             return;
         default:
             throw std::runtime_error("Unknown type in printValue");
@@ -68,12 +70,13 @@ void Executor::printValue(std::ostream *out, const TypedValue &val) {
 }
 
 TypedValue Executor::run() {
+    Resolver().resolve(root);
     executeNode(root, globalEnv);
     if (globalEnv->has("main")) {
         auto mainFunc = globalEnv->get("main");
-        if (!mainFunc.type.match(BaseType::Function))
-            throw std::runtime_error("main is not a function type - received " + mainFunc.type.toString());
-        return *std::get<std::shared_ptr<Function>>(mainFunc.value)->fn({});
+        if (!mainFunc.is(BaseType::Function))
+            throw std::runtime_error("main is not a function type - received " + mainFunc.type().toString());
+        return *mainFunc.get<PFunction>()->fn({});
     }
     return TypedValue(0);
 }
@@ -89,10 +92,10 @@ const std::unordered_map<std::string, std::function<void(ENV, Executor*)>>& getI
     return maps;
 }
 
-void Executor::handleImports(std::vector<std::shared_ptr<ASTNode>> children, ENV env) {
+void Executor::handleImports(const ASTChildren &children, ENV env) {
     const auto &maps = getImportMaps();
     for (auto &child : children) {
-        const std::string &name = child->strValue;
+        const std::string &name = child->strValue();
         if (name.ends_with(".lum")) {
             if (!exportData.contains(name)) {
                 if (!pragmas.contains(name)) throw std::runtime_error("Unknown pragma: " + name);
@@ -100,7 +103,7 @@ void Executor::handleImports(std::vector<std::shared_ptr<ASTNode>> children, ENV
                     throw std::runtime_error("Circular import: " + name);
                 executePragma(pragmas[name], std::make_shared<Environment>());
             }
-            env->set(child->children[0]->strValue, exportData[name]);
+            env->set(child->children[0]->strValue(), exportData[name]);
             continue;
         }
         if (!maps.contains(name)) throw std::runtime_error("Unknown module: " + name);
@@ -109,25 +112,26 @@ void Executor::handleImports(std::vector<std::shared_ptr<ASTNode>> children, ENV
 }
 
 void Executor::executePragma(std::shared_ptr<ASTNode> node, ENV env) {
-    handlingModules.push_back(node->strValue);
+    handlingModules.push_back(node->strValue());
     auto &children = node->children;
     handleImports(children[0]->children, env);
-    exportData[node->strValue] = std::make_shared<ExportData>(node->strValue);
+    exportData[node->strValue()] = makeRef<ExportData>(node->strValue());
+    env->frame.resize(node->frameSize);
 
     for (size_t i = 2; i < children.size(); ++i)
         executeNode(children[i], env);
 
     for (auto &exportNode : children[1]->children) {
-        std::string var = exportNode->strValue;
-        if (!env->has(var)) throw std::runtime_error("Cannot export undefined variable: " + var);
-        exportData[node->strValue]->addExport(var, env);
+        if (!env->has(exportNode->symbol))
+            throw std::runtime_error("Cannot export undefined variable: " + exportNode->strValue());
+        exportData[node->strValue()]->addExport(exportNode->symbol, env);
     }
 
     handlingModules.pop_back();
 }
 
-void Executor::executePragmas(std::vector<std::shared_ptr<ASTNode>> children, ENV env) {
-    for (auto &child : children) pragmas[child->strValue] = child;
+void Executor::executePragmas(const ASTChildren &children, ENV env) {
+    for (auto &child : children) pragmas[child->strValue()] = child;
     executePragma(children.back(), env);
 }
 
@@ -140,9 +144,9 @@ FunctionData Executor::executeFunctionDefinition(
         auto c = node->children[i];
         auto c0 = c->children[0];
         auto primVal = c0->primitiveValue;
-        auto strVal = c0->strValue;
+        auto strVal = c0->strValue();
 
-        Parameter param = { c->strValue, primVal == Primitive::NONE ? Type(strVal) : Type(primVal) };
+        Parameter param = { c->strValue(), primVal == Primitive::NONE ? Type(strVal) : Type(primVal) };
         if(c->children.size() > 1 && c->children[1]->type == ASTNode::Type::ARRAY_ASSIGN) {
             param.vararg = true;
         }
@@ -151,18 +155,21 @@ FunctionData Executor::executeFunctionDefinition(
 
     Type retType =
         node->primitiveValue == Primitive::NONE
-            ? (node->retType == "nil" ? Type(BaseType::NIL) : Type(node->retType))
+            ? (node->retType() == "nil" ? Type(BaseType::NIL) : Type(node->retType()))
             : Type(node->primitiveValue);
 
-    return std::make_shared<_FunctionData>(params, retType, node->children.back());
+    auto funcData = std::make_shared<_FunctionData>(params, retType, node->children.back());
+    funcData->frameSize = node->frameSize;
+    funcData->returnsChecked = node->typeChecked;
+    return funcData;
 }
 
 ReturnValue Executor::executeNode(std::shared_ptr<ASTNode> node, ENV env, bool extraBit) {
     switch (node->type) {
         case ASTNode::Type::PROGRAM: executePragmas(node->children, env); return {};
-        case ASTNode::Type::BLOCK: return executeBlock(node->children, std::make_shared<Environment>(env));
+        case ASTNode::Type::BLOCK: return executeBlock(node->children, env);
         case ASTNode::Type::STRUCT_DECLARE: handleStructDeclaration(node, env); return {};
-        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: handleAssignment(node, env, node->primitiveValue, true); return {};
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: handleAssignment(node, env, node->primitiveValue, node->primitiveValue == Primitive::NONE); return {};
         case ASTNode::Type::STRUCT_ASSIGNMENT: handleStructAssignment(node, env); return {};
         case ASTNode::Type::RETURN_STATEMENT:
             return ReturnValue(node->children.empty() ? TypedValue() : evaluateExpression(node->children[0], env));
@@ -173,20 +180,26 @@ ReturnValue Executor::executeNode(std::shared_ptr<ASTNode> node, ENV env, bool e
                 return executeNode(node->children[2]->children[0], env);
             return {};
         }
-        case ASTNode::Type::WHILE_STATEMENT:
+        case ASTNode::Type::WHILE_STATEMENT: {
+            Jit::Region *region = jit ? jit->loop(node.get()) : nullptr;
             while (getBoolValue(evaluateExpression(node->children[0], env))) {
+                if (budget) spend(false);
                 auto r = executeNode(node->children[1], env);
                 if (r.hasReturn) return r;
+                if (region && jit->backEdge(region, node, env)) return {};
             }
             return {};
+        }
         case ASTNode::Type::FOR_STATEMENT: {
-            auto localEnv = std::make_shared<Environment>(env);
-            if (node->strValue == "0") {
-                executeNode(node->children[0], localEnv);
-                while (getBoolValue(evaluateExpression(node->children[1], localEnv))) {
-                    auto r = executeNode(node->children[3], localEnv);
+            if (node->strValue() == "0") {
+                Jit::Region *region = jit ? jit->loop(node.get()) : nullptr;
+                executeNode(node->children[0], env);
+                while (getBoolValue(evaluateExpression(node->children[1], env))) {
+                    if (budget) spend(false);
+                    auto r = executeNode(node->children[3], env);
                     if (r.hasReturn) return r;
-                    evaluateExpression(node->children[2], localEnv);
+                    evaluateExpression(node->children[2], env);
+                    if (region && jit->backEdge(region, node, env)) return {};
                 }
                 return {};
             }
@@ -195,13 +208,14 @@ ReturnValue Executor::executeNode(std::shared_ptr<ASTNode> node, ENV env, bool e
             const auto &iterableExpr = node->children[1];
             const auto &body = node->children[2];
 
-            const auto iterableValue = evaluateExpression(iterableExpr, localEnv);
-            if(iterableValue.type.kind != BaseType::Array) {
+            const auto iterableValue = evaluateExpression(iterableExpr, env);
+            if(iterableValue.kind() != BaseType::Array) {
                 throw std::runtime_error("Expected array for enhanced for loop");
             }
             for (const auto &item : iterableValue.point<Array>()->elements) {
-                localEnv->set(varDecl->strValue, item);
-                auto r = executeNode(body, localEnv);
+                if (budget) spend(false);
+                declare(*varDecl, env, item);
+                auto r = executeNode(body, env);
                 if (r.hasReturn) return r;
             }
             return {};
@@ -210,20 +224,20 @@ ReturnValue Executor::executeNode(std::shared_ptr<ASTNode> node, ENV env, bool e
         case ASTNode::Type::FUNCTION: {
             auto funcData = executeFunctionDefinition(node, env);
             auto func = createFunction(funcData, env);
-            env->set(node->strValue, func);
-            return TypedValue(func);
+            declare(*node, env, func);
+            return {};
         }
         case ASTNode::Type::NATIVE_STATEMENT: {
             auto funcData = executeFunctionDefinition(node->children[0], env);
-            auto nativeFunc = createNativeFunction(node->strValue, funcData, env);
-            env->set(node->strValue, nativeFunc);
+            auto nativeFunc = createNativeFunction(node->strValue(), funcData, env);
+            declare(*node, env, nativeFunc);
             return {};
         }
         default: evaluateExpression(node, env); return {};
     }
 }
 
-ReturnValue Executor::executeBlock(const std::vector<std::shared_ptr<ASTNode>> &nodes, ENV env) {
+ReturnValue Executor::executeBlock(const ASTChildren &nodes, ENV env) {
     for (auto &n : nodes) {
         auto r = executeNode(n, env);
         if (r.hasReturn) return r;
@@ -231,28 +245,35 @@ ReturnValue Executor::executeBlock(const std::vector<std::shared_ptr<ASTNode>> &
     return {};
 }
 
-TypedValue Executor::arrayOperation(const std::shared_ptr<Array>& arr, const std::vector<int>& indices) {
+TypedValue Executor::arrayOperation(const PArray& arr, const std::vector<int>& indices) {
     if (indices.size() == 1) return arr->elements[indices[0]];
 
-    auto result = std::make_shared<Array>();
+    auto result = makeRef<Array>();
     result->elementType = arr->elementType; // preserve element type
     for (int idx : indices) {
         result->elements.push_back(arr->elements[idx]);
     }
-    return TypedValue(result, result->elementType.array());
+    return TypedValue(result);
 }
 
 TypedValue Executor::arrayOperation(
-    const std::shared_ptr<Array>& arr,
+    const PArray& arr,
     const std::vector<int>& indices,
     std::shared_ptr<ASTNode> valNode,
     ENV env
 ) {
-    TypedValue val = evaluateExpression(valNode, env);
+    return arrayOperation(arr, indices, evaluateExpression(valNode, env));
+}
+
+TypedValue Executor::arrayOperation(
+    const PArray& arr,
+    const std::vector<int>& indices,
+    const TypedValue &val
+) {
     std::vector<TypedValue> valuesToAssign;
 
-    if (val.type.match(BaseType::Array)) {
-        auto valArr = val.get<std::shared_ptr<Array>>();
+    if (val.is(BaseType::Array)) {
+        auto valArr = val.get<PArray>();
         valuesToAssign = valArr->elements;
     } else {
         valuesToAssign.push_back(val);
@@ -265,103 +286,317 @@ TypedValue Executor::arrayOperation(
         arr->elements[idx] = valueToSet;
     }
 
-    return TypedValue(arr, arr->elementType.array());
+    return TypedValue(arr);
 }
 
 void parseArg(std::shared_ptr<Environment> env, Parameter* param, std::shared_ptr<TypedValue> arg, int i) {
-    if(!param->type.match(arg->type))
-        throw std::runtime_error("Expected type " + param->type.toString() + " but got " + arg->type.toString());
+    if(!param->type.match(arg->type()))
+        throw std::runtime_error("Expected type " + param->type.toString() + " but got " + arg->type().toString());
     env->set(param->ident, *arg);
 }
 
-std::shared_ptr<Function> Executor::createFunction(
+void checkArgument(const Parameter &param, const TypedValue &arg) {
+    if (!param.type.match(arg.type()))
+        throw std::runtime_error("Expected type " + param.type.toString() + " but got " + arg.type().toString());
+}
+
+void bindArguments(const _FunctionData &funcData, TypedValue *args, size_t argc) {
+    const auto &params = funcData.params;
+    size_t i = 0;
+    for (; i < argc; ++i) {
+        if (i >= params.size()) throw std::runtime_error("Too many arguments provided for function");
+
+        const Parameter &param = params[i];
+        if (param.vararg) {
+            auto varargArray = makeRef<Array>();
+            varargArray->elementType = param.type;
+            for (size_t j = i; j < argc; ++j) {
+                checkArgument(param, args[j]);
+                varargArray->elements.push_back(args[j]);
+            }
+            args[i] = TypedValue(varargArray);
+            ++i;
+            break;
+        }
+        checkArgument(param, args[i]);
+    }
+
+    // compiled engines give parameters a static type, so they can never be left unset
+    for (; i < params.size(); ++i) {
+        if (!params[i].vararg) throw std::runtime_error("Missing argument for parameter: " + params[i].ident);
+        auto varargArray = makeRef<Array>();
+        varargArray->elementType = params[i].type;
+        args[i] = TypedValue(varargArray);
+    }
+}
+
+PFunction Executor::createFunction(
     FunctionData funcData,
     ENV closureEnv
 ) {
-    return std::make_shared<Function>(Function{
+    auto func = makeRef<Function>(Function{
         [this, funcData, closureEnv](const std::vector<std::shared_ptr<TypedValue>> &args) {
-            auto local = std::make_shared<Environment>(closureEnv);
+            return std::make_shared<TypedValue>(callFunction(funcData, closureEnv, args, false));
+        }
+    });
+    func->data = funcData;
+    func->env = closureEnv;
+    return func;
+}
 
-            for (size_t i = 0; i < args.size(); ++i) {
-                if (i >= funcData->params.size()) {
-                    throw std::runtime_error("Too many arguments provided for function");
-                }
+// argsChecked is set for calls the TypeChecker proved pass arguments of the parameters' types.
+TypedValue Executor::callFunction(
+    const FunctionData &funcData,
+    const ENV &closureEnv,
+    const std::vector<std::shared_ptr<TypedValue>> &args,
+    bool argsChecked
+) {
+    TypedValue result;
+    if (jit && jit->call(funcData, closureEnv, args, result)) return result;
+    if (budget) spend(true);
+
+    auto local = std::make_shared<Environment>(closureEnv, funcData->frameSize);
+    auto bind = [&local, &funcData](size_t i, const TypedValue &val) {
+        if (funcData->frameSize) local->frame[i] = val;
+        else local->set(funcData->params[i].ident, val);
+    };
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i >= funcData->params.size()) {
+            throw std::runtime_error("Too many arguments provided for function");
+        }
 
-                auto &param = funcData->params[i];
-                if (param.vararg) {
-                    auto varargArray = std::make_shared<Array>();
-                    varargArray->elementType = param.type;
-
-                    while (i < args.size()) {
-                        if (!args[i]->type.match(param.type)) {
-                            throw std::runtime_error(
-                                "Expected type " + param.type.toString() + 
-                                " but got " + args[i]->type.toString()
-                            );
-                        }
-                        varargArray->elements.push_back(*args[i]);
-                        ++i;
-                    }
-                    local->set(param.ident, TypedValue(varargArray, param.type.array()));
-                } else {
-                    if (!args[i]->type.match(param.type)) {
-                        throw std::runtime_error(
-                            "Expected type " + param.type.toString() + 
-                            " but got " + args[i]->type.toString()
-                        );
-                    }
-                    local->set(param.ident, *args[i]);
-                }
+        auto &param = funcData->params[i];
+        if (param.vararg) {
+            auto varargArray = makeRef<Array>();
+            varargArray->elementType = param.type;
+
+            while (i < args.size()) {
+                if (!argsChecked) checkArgument(param, *args[i]);
+                varargArray->elements.push_back(*args[i]);
+                ++i;
             }
+            bind(funcData->params.size() - 1, TypedValue(varargArray));
+        } else {
+            if (!argsChecked) checkArgument(param, *args[i]);
+            bind(i, *args[i]);
+        }
+    }
 
-            ReturnValue r = executeNode(funcData->body, local);
+    ReturnValue r = executeNode(funcData->body, local);
+    if (budget) budget->depth++;
 
-            if (!funcData->retType.match(r.value.type)) {
-                throw std::runtime_error(
-                    "Function return type mismatch - got " + r.value.type.toString() + 
-                    " but expected " + funcData->retType.toString()
-                );
-            }
+    if (!funcData->returnsChecked && !funcData->retType.match(r.value.type())) {
+        throw std::runtime_error(
+            "Function return type mismatch - got " + r.value.type().toString() + 
+            " but expected " + funcData->retType.toString()
+        );
+    }
 
-            return std::make_shared<TypedValue>(r.hasReturn ? r.value : TypedValue());
-        }
-    });
+    return r.hasReturn ? r.value : TypedValue();
+}
+
+void Executor::spend(bool call) {
+    if (budget->steps == 0 || (call && budget->depth == 0)) throw std::runtime_error("Execution limit exceeded");
+    budget->steps--;
+    if (call) budget->depth--;
 }
 
-std::shared_ptr<Function> Executor::createNativeFunction(std::string name, FunctionData funcData, ENV env) {
+PFunction Executor::createNativeFunction(std::string name, FunctionData funcData, ENV env) {
     if(env->nativeInqueries.find(name) == env->nativeInqueries.end())
         throw std::runtime_error("Unable to link native function: " + name);
     auto nf = env->nativeInqueries[name];
-    return std::make_shared<Function>(Function{
+    return makeRef<Function>(Function{
         [this, funcData, nf, env](const std::vector<std::shared_ptr<TypedValue>> &args){
             std::unordered_map<std::string, TypedValue> params;
             for (size_t i = 0; i < funcData->params.size() && i < args.size(); ++i) {
-                if(!funcData->params[i].type.match(args[i]->type))
-                    throw std::runtime_error("Expected type " + funcData->params[i].type.toString() + " but got " + args[1]->type.toString());
+                if(!funcData->params[i].type.match(args[i]->type()))
+                    throw std::runtime_error("Expected type " + funcData->params[i].type.toString() + " but got " + args[1]->type().toString());
                 params[funcData->params[i].ident] = *args[i];
             }
             ReturnValue r = nf(env, this, params);
-            if(!funcData->retType.match(r.value.type)) {
-                throw std::runtime_error("Native function return type mismatch - got " + r.value.type.toString() + " but expected " + funcData->retType.toString());
+            if(!funcData->retType.match(r.value.type())) {
+                throw std::runtime_error("Native function return type mismatch - got " + r.value.type().toString() + " but expected " + funcData->retType.toString());
             }
             return std::make_shared<TypedValue>(r.hasReturn ? r.value : TypedValue());
         }
     });
 }
 
+TypedValue Executor::evaluateBinaryOp(const TypedValue &lhs, const TypedValue &rhs, BinaryOp op) {
+    switch(op) {
+        case PLUS: {
+            if(lhs.kind() != BaseType::String) break;
+            std::ostringstream str;
+            str << lhs.get<std::string>();
+            if(rhs.kind() != BaseType::String) {
+                printValue(&str, rhs);
+            } else {
+                str << rhs.get<std::string>();
+            }
+            return TypedValue(str.str());
+        }
+        case MULTIPLY: {
+            if(lhs.kind() != BaseType::String) break;
+            if(rhs.kind() != BaseType::Int) 
+                throw std::runtime_error("Cannot multiply a string with a non-integer");
+            int amt = rhs.get<int>();
+            std::string left = lhs.get<std::string>();
+            std::ostringstream str;
+            for(int i = 0; i < amt; ++i)
+                str << left;
+            return TypedValue(str.str());
+        }
+        default: break;
+    }
+    int left = getIntValue(lhs);
+    int right = getIntValue(rhs);
+    switch(op) {
+        case PLUS:          return TypedValue(left + right);
+        case MINUS:         return TypedValue(left - right);
+        case MULTIPLY:      return TypedValue(left * right);
+        case DIVIDE:        return TypedValue(left / right);
+        case MODULUS:       return TypedValue(left % right);
+        case COMPARISON:    return TypedValue(left == right);
+        case LESS:          return TypedValue(left < right);
+        case GREATER:       return TypedValue(left > right);
+        case LESS_EQUAL:    return TypedValue(left <= right);
+        case GREATER_EQUAL: return TypedValue(left >= right);
+        default: throw std::runtime_error("Unsupported binary op");
+    }
+}
+
+TypedValue Executor::evaluateUnaryOp(const TypedValue &operand, BinaryOp op) {
+    int val = getIntValue(operand);
+    switch(op) {
+        case MINUS: return TypedValue(-val);
+        case BITWISE_NOT: return TypedValue(~val);
+        case NOT: return TypedValue(!val);
+        default: throw std::runtime_error("Unsupported unary op");
+    }
+}
+
+static ASTNode::Quick intQuick(BinaryOp op) {
+    using Quick = ASTNode::Quick;
+    switch(op) {
+        case PLUS:          return Quick::INT_ADD;
+        case MINUS:         return Quick::INT_SUB;
+        case MULTIPLY:      return Quick::INT_MUL;
+        case DIVIDE:        return Quick::INT_DIV;
+        case MODULUS:       return Quick::INT_MOD;
+        case COMPARISON:    return Quick::INT_EQ;
+        case LESS:          return Quick::INT_LESS;
+        case GREATER:       return Quick::INT_GREATER;
+        case LESS_EQUAL:    return Quick::INT_LESS_EQUAL;
+        case GREATER_EQUAL: return Quick::INT_GREATER_EQUAL;
+        default:            return Quick::GENERIC;
+    }
+}
+
+// A node that only saw int operands on its first run skips the string overloads from then on, the
+// first operands of another type drop it to GENERIC for good.
+TypedValue Executor::evaluateQuickBinaryOp(ASTNode &node, const TypedValue &lhs, const TypedValue &rhs) {
+    using Quick = ASTNode::Quick;
+    auto &quick = node.cache.quick;
+    bool ints = lhs.kind() == BaseType::Int && rhs.kind() == BaseType::Int;
+
+    if (quick == Quick::NONE) {
+        quick = ints ? intQuick(node.binopValue) : Quick::GENERIC;
+    } else if (ints) {
+        int left = lhs.get<int>();
+        int right = rhs.get<int>();
+        switch(quick) {
+            case Quick::INT_ADD:           return TypedValue(left + right);
+            case Quick::INT_SUB:           return TypedValue(left - right);
+            case Quick::INT_MUL:           return TypedValue(left * right);
+            case Quick::INT_DIV:           return TypedValue(left / right);
+            case Quick::INT_MOD:           return TypedValue(left % right);
+            case Quick::INT_EQ:            return TypedValue(left == right);
+            case Quick::INT_LESS:          return TypedValue(left < right);
+            case Quick::INT_GREATER:       return TypedValue(left > right);
+            case Quick::INT_LESS_EQUAL:    return TypedValue(left <= right);
+            case Quick::INT_GREATER_EQUAL: return TypedValue(left >= right);
+            default: break;
+        }
+    } else {
+        quick = Quick::GENERIC;
+    }
+    return evaluateBinaryOp(lhs, rhs, node.binopValue);
+}
+
+// The cached (depth, slot) is only trusted when no nearer environment declares the name and the
+// slot still holds it, so a stale cache just costs a full lookup.
+TypedValue &Executor::lookupCached(ASTNode &node, const ENV &env) {
+    auto &cache = node.cache;
+    Symbol name = node.symbol;
+
+    if (cache.quick == ASTNode::Quick::CACHED) {
+        uint64_t bit = Environment::nameBit(name);
+        Environment *scope = env.get();
+        uint16_t depth = 0;
+        while (scope && depth < cache.depth && !(scope->mayHave(bit) && scope->has(name))) {
+            scope = scope->parent.get();
+            ++depth;
+        }
+        if (scope && depth == cache.depth)
+            if (TypedValue *val = scope->at(cache.slot, name)) return *val;
+    }
+
+    TypedValue *val = env->lookup(name, cache.depth, cache.slot);
+    if (!val) throw std::runtime_error("Undefined variable: " + node.strValue());
+    cache.quick = ASTNode::Quick::CACHED;
+    return *val;
+}
+
+void Executor::declare(const ASTNode &node, const ENV &env, const TypedValue &val) {
+    if (node.address.slot != ASTNode::UNRESOLVED) env->local(node.address) = val;
+    else env->set(node.symbol, val);
+}
+
+// Instances of a StructType share its field order, so the type is the shape the index is keyed on.
+TypedValue &Executor::structField(ASTNode &readNode, const PStruct &str) {
+    auto &cache = readNode.cache;
+    if (cache.quick == ASTNode::Quick::CACHED && cache.shape == str->type.get() && cache.slot < str->fields.size())
+        return str->fields[cache.slot].second;
+
+    const ASTNode &property = *readNode.children[1];
+    auto it = std::find_if(str->fields.begin(), str->fields.end(),
+        [&property](const auto &pair){ return pair.first == property.symbol; });
+    if (it == str->fields.end())
+        throw std::runtime_error("Struct does not have field: " + property.strValue());
+
+    if (str->type) {
+        cache.quick = ASTNode::Quick::CACHED;
+        cache.shape = str->type.get();
+        cache.slot = static_cast<uint32_t>(it - str->fields.begin());
+    }
+    return it->second;
+}
+
 TypedValue Executor::evaluateExpression(std::shared_ptr<ASTNode> node, ENV env) {
     auto eval = [this, &env](std::shared_ptr<ASTNode> n){ return evaluateExpression(n, env); };
 
     switch (node->type) {
-        case ASTNode::Type::NUMBER: return TypedValue(std::stoi(node->strValue));
-        case ASTNode::Type::BOOL: return TypedValue(node->strValue == "1");
-        case ASTNode::Type::STRING: return TypedValue(node->strValue);
-        case ASTNode::Type::IDENTIFIER: return env->get(node->strValue);
+        case ASTNode::Type::NUMBER: return TypedValue(node->intValue);
+        case ASTNode::Type::BOOL: return TypedValue(node->intValue != 0);
+        case ASTNode::Type::STRING: {
+            // strings are immutable, so the first run's value is shared by every later one
+            auto &cache = node->cache;
+            if (cache.quick != ASTNode::Quick::CACHED) {
+                cache.slot = static_cast<uint32_t>(constants.size());
+                constants.emplace_back(node->strValue());
+                cache.quick = ASTNode::Quick::CACHED;
+            }
+            return constants[cache.slot];
+        }
+        case ASTNode::Type::IDENTIFIER:
+            if (node->address.slot != ASTNode::UNRESOLVED) return env->local(node->address);
+            return lookupCached(*node, env);
         case ASTNode::Type::SELF_REFERENCE:
             if (env->hasSelfRef()) return env->currentSelfRef();
             return TypedValue();
 
-        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: return handleAssignment(node, env, node->primitiveValue, true);
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: return handleAssignment(node, env, node->primitiveValue, node->primitiveValue == Primitive::NONE);
         case ASTNode::Type::STRUCT_ASSIGNMENT: return handleStructAssignment(node, env);
         case ASTNode::Type::NDARRAY_ASSIGN: return handleNDArrayAssignment(node, env);
 
@@ -369,11 +604,11 @@ TypedValue Executor::evaluateExpression(std::shared_ptr<ASTNode> node, ENV env)
             TypedValue arrVal = eval(node->children[0]);
             auto idxNode = node->children[1];
 
-            if (arrVal.type.kind != BaseType::Array) {
+            if (arrVal.kind() != BaseType::Array) {
                 throw std::runtime_error("Attempted array access on non-array");
             }
 
-            auto arr = arrVal.get<std::shared_ptr<Array>>();
+            auto arr = arrVal.get<PArray>();
             auto indices = getIndices(arr, idxNode, env);
 
             return arrayOperation(arr, indices);
@@ -384,11 +619,11 @@ TypedValue Executor::evaluateExpression(std::shared_ptr<ASTNode> node, ENV env)
             auto idxNode = node->children[1];
             auto valNode = node->children[2];
 
-            if (arrVal.type.kind != BaseType::Array) {
+            if (arrVal.kind() != BaseType::Array) {
                 throw std::runtime_error("Attempted array assignment on non-array");
             }
 
-            auto arr = arrVal.get<std::shared_ptr<Array>>();
+            auto arr = arrVal.get<PArray>();
             auto indices = getIndices(arr, idxNode, env);
 
             arrayOperation(arr, indices, valNode, env);
@@ -398,19 +633,19 @@ TypedValue Executor::evaluateExpression(std::shared_ptr<ASTNode> node, ENV env)
 
         case ASTNode::Type::ARRAY_LITERAL: {
             if (node->children.empty()) {
-                auto arr = std::make_shared<Array>();
+                auto arr = makeRef<Array>();
                 arr->elementType = Type(BaseType::NIL);
-                return TypedValue(arr, arr->elementType.array());
+                return TypedValue(arr);
             }
 
             TypedValue firstVal;
             bool firstValSet = false;
 
-            auto arr = std::make_shared<Array>();
+            auto arr = makeRef<Array>();
 
             for (auto &child : node->children) {
                 if (child->type == ASTNode::Type::RANGE) {
-                    if (firstValSet && !firstVal.type.match(BaseType::Int))
+                    if (firstValSet && !firstVal.is(BaseType::Int))
                         throw std::runtime_error("RANGE literal is only allowed for integer arrays");
 
                     int start = getIntValue(eval(child->children[0]));
@@ -426,12 +661,12 @@ TypedValue Executor::evaluateExpression(std::shared_ptr<ASTNode> node, ENV env)
                     TypedValue val = evaluateExpression(child, env);
                     if (!firstValSet) {
                         firstVal = val;
-                        arr->elementType = val.type;
+                        arr->elementType = val.type();
                         firstValSet = true;
-                    } else if (!val.type.match(arr->elementType)) {
+                    } else if (!val.type().match(arr->elementType)) {
                         throw std::runtime_error(
                             "Array literal elements must have the same type: got " +
-                            val.type.toString() + " but expected " + arr->elementType.toString()
+                            val.type().toString() + " but expected " + arr->elementType.toString()
                         );
                     }
                     env->pushSelfRef(val);
@@ -440,93 +675,48 @@ TypedValue Executor::evaluateExpression(std::shared_ptr<ASTNode> node, ENV env)
                 }
             }
 
-            return TypedValue(arr, arr->elementType.array());
+            return TypedValue(arr);
         }
 
         case ASTNode::Type::CALL: {
             auto calleeVal = eval(node->children[0]);
-            if (!calleeVal.type.match(BaseType::Function))
+            if (!calleeVal.is(BaseType::Function))
                 throw std::runtime_error("Attempted to call a non-function value");
             std::vector<std::shared_ptr<TypedValue>> args;
             for (size_t i = 1; i < node->children.size(); ++i) args.push_back(std::make_shared<TypedValue>(eval(node->children[i])));
-            return *calleeVal.get<std::shared_ptr<Function>>()->fn(args);
+
+            auto func = calleeVal.get<PFunction>();
+            if (node->typeChecked && func->data) return callFunction(func->data, func->env, args, true);
+            return *func->fn(args);
         }
 
         case ASTNode::Type::BINARY_OP: {
             auto lhs = eval(node->children[0]);
             auto rhs = eval(node->children[1]);
-            switch(node->binopValue) {
-                case PLUS: {
-                    if(lhs.type.kind != BaseType::String) break;
-                    std::ostringstream str;
-                    str << lhs.get<std::string>();
-                    if(rhs.type.kind != BaseType::String) {
-                        printValue(&str, rhs);
-                    } else {
-                        str << rhs.get<std::string>();
-                    }
-                    return TypedValue(str.str());
-                }
-                case MULTIPLY: {
-                    if(lhs.type.kind != BaseType::String) break;
-                    if(rhs.type.kind != BaseType::Int) 
-                        throw std::runtime_error("Cannot multiply a string with a non-integer");
-                    int amt = rhs.get<int>();
-                    std::string left = lhs.get<std::string>();
-                    std::ostringstream str;
-                    for(int i = 0; i < amt; ++i)
-                        str << left;
-                    return TypedValue(str.str());
-                }
-            }
-            printValue(&std::cout, lhs);
-            printf(" ");
-            printValue(&std::cout, rhs);
-            printf("\n");
-            int left = getIntValue(lhs);
-            int right = getIntValue(rhs);
-            switch(node->binopValue) {
-                case PLUS:          return TypedValue(left + right);
-                case MINUS:         return TypedValue(left - right);
-                case MULTIPLY:      return TypedValue(left * right);
-                case DIVIDE:        return TypedValue(left / right);
-                case MODULUS:       return TypedValue(left % right);
-                case COMPARISON:    return TypedValue(left == right);
-                case LESS:          return TypedValue(left < right);
-                case GREATER:       return TypedValue(left > right);
-                case LESS_EQUAL:    return TypedValue(left <= right);
-                case GREATER_EQUAL: return TypedValue(left >= right);
-                default: throw std::runtime_error("Unsupported binary op");
-            }
+            if (node->cache.quick == ASTNode::Quick::GENERIC) return evaluateBinaryOp(lhs, rhs, node->binopValue);
+            return evaluateQuickBinaryOp(*node, lhs, rhs);
         }
 
-        case ASTNode::Type::UNARY_OP: {
-            int val = getIntValue(eval(node->children[0]));
-            switch(node->binopValue) {
-                case MINUS: return TypedValue(-val);
-                case BITWISE_NOT: return TypedValue(~val);
-                case NOT: return TypedValue(!val);
-                default: throw std::runtime_error("Unsupported unary op");
-            }
-        }
+        case ASTNode::Type::UNARY_OP: return evaluateUnaryOp(eval(node->children[0]), node->binopValue);
 
         case ASTNode::Type::READ: {
             TypedValue target = eval(node->children[0]);
-            return evaluateReadProperty(target, node->children[1]->strValue);
+            if (target.kind() == BaseType::Struct) return structField(*node, target.get<PStruct>());
+            return evaluateReadProperty(target, node->children[1]->symbol);
         }
 
         case ASTNode::Type::SIZED_ARRAY_DECLARE: {
             int size = getIntValue(eval(node->children[0]));
             TypedValue val = primitiveValue(node->primitiveValue);
 
-            auto arr = std::make_shared<Array>();
-            arr->elementType = val.type;
+            auto arr = makeRef<Array>();
+            arr->elementType = val.type();
 
             for (int i = 0; i < size; ++i) {
                 arr->elements.push_back(val);
             }
 
-            return TypedValue(arr, arr->elementType.array());
+            return TypedValue(arr);
         }
 
 
@@ -0,0 +1,138 @@
+#include "resolver.hpp"
+
+void Resolver::resolve(const std::shared_ptr<ASTNode> &root) {
+    frames.clear();
+    visit(root);
+}
+
+void Resolver::pushFrame(ASTNode &owner, bool isModule) {
+    owner.frameSize = 0;
+    frames.push_back({&owner, {}, {}, 0, isModule});
+}
+
+void Resolver::popFrame() {
+    frames.pop_back();
+}
+
+void Resolver::beginScope() {
+    auto &frame = frames.back();
+    frame.scopes.push_back(frame.locals.size());
+    frame.blockDepth++;
+}
+
+void Resolver::endScope() {
+    auto &frame = frames.back();
+    frame.locals.resize(frame.scopes.back());
+    frame.scopes.pop_back();
+    frame.blockDepth--;
+}
+
+// Slots are never reused once their block ends, a closure made inside it may still read them.
+void Resolver::declare(ASTNode &node) {
+    auto &frame = frames.back();
+    if (frame.isModule && frame.blockDepth == 0) return;
+
+    // declaring a name twice in one block overwrites it, like Environment::set
+    size_t scopeStart = frame.scopes.empty() ? 0 : frame.scopes.back();
+    for (size_t i = frame.locals.size(); i-- > scopeStart;) {
+        if (frame.locals[i].name != node.strValue()) continue;
+        node.address = {0, frame.locals[i].slot};
+        return;
+    }
+
+    uint32_t slot = frame.owner->frameSize++;
+    frame.locals.push_back({node.strValue(), slot});
+    node.address = {0, slot};
+}
+
+void Resolver::use(ASTNode &node) {
+    for (size_t depth = 0; depth < frames.size(); ++depth) {
+        const auto &locals = frames[frames.size() - 1 - depth].locals;
+        for (auto it = locals.rbegin(); it != locals.rend(); ++it) {
+            if (it->name != node.strValue()) continue;
+            node.address = {static_cast<uint16_t>(depth), it->slot};
+            return;
+        }
+    }
+    node.address = {};
+}
+
+void Resolver::visitChildren(const std::shared_ptr<ASTNode> &node, size_t from) {
+    for (size_t i = from; i < node->children.size(); ++i) visit(node->children[i]);
+}
+
+void Resolver::visit(const std::shared_ptr<ASTNode> &node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case ASTNode::Type::PROGRAM: visitChildren(node); break;
+        case ASTNode::Type::PRAGMA:
+            // children[0] and [1] are the import and export lists
+            pushFrame(*node, true);
+            visitChildren(node, 2);
+            popFrame();
+            break;
+        case ASTNode::Type::BLOCK:
+            beginScope();
+            visitChildren(node);
+            endScope();
+            break;
+        case ASTNode::Type::FOR_STATEMENT: forStatement(node); break;
+        case ASTNode::Type::FUNCTION: function(node); break;
+        case ASTNode::Type::NATIVE_STATEMENT: declare(*node); break;
+        case ASTNode::Type::STRUCT_DECLARE: break;
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: assignment(node); break;
+        case ASTNode::Type::STRUCT_ASSIGNMENT:
+            // children[0] names the struct, named arguments are field: value pairs
+            for (size_t i = 1; i < node->children.size(); ++i) {
+                const auto &arg = node->children[i];
+                if (arg->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT) visitChildren(arg);
+                else visit(arg);
+            }
+            declare(*node);
+            break;
+        case ASTNode::Type::NDARRAY_ASSIGN:
+            visitChildren(node, 1);
+            declare(*node);
+            break;
+        case ASTNode::Type::IDENTIFIER: use(*node); break;
+        case ASTNode::Type::READ: visit(node->children[0]); break;
+        case ASTNode::Type::IMPORT_BLOCK: break;
+        default: visitChildren(node); break;
+    }
+}
+
+// The function's own name goes in the enclosing frame first, so the body can call itself through it.
+void Resolver::function(const std::shared_ptr<ASTNode> &node) {
+    declare(*node);
+
+    pushFrame(*node, false);
+    beginScope();
+    // parameters take the first slots in order, their children only describe the type
+    for (size_t i = 0; i + 1 < node->children.size(); ++i) declare(*node->children[i]);
+    visit(node->children.back());
+    endScope();
+    popFrame();
+}
+
+void Resolver::forStatement(const std::shared_ptr<ASTNode> &node) {
+    beginScope();
+    if (node->strValue() == "0") {
+        visitChildren(node);
+    } else {
+        // the loop variable is bound after the iterable is evaluated and its declaration never runs
+        visit(node->children[1]);
+        declare(*node->children[0]);
+        visit(node->children[2]);
+    }
+    endScope();
+}
+
+void Resolver::assignment(const std::shared_ptr<ASTNode> &node) {
+    visitChildren(node);
+    // struct property assignment
+    if (node->children.size() > 1 && node->children[0]->type == ASTNode::Type::READ) return;
+
+    if (node->primitiveValue == Primitive::NONE) use(*node);
+    else declare(*node);
+}
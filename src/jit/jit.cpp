@@ -0,0 +1,660 @@
+#include "jit.hpp"
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define LUMIN_JIT 1
+#include <sys/mman.h>
+#endif
+
+struct Jit::Region {
+    enum class State { Cold, Compiling, Compiled, Failed };
+
+    // variables a loop reads from the interpreter's environment, copied in on entry and back out on exit
+    struct OuterVar {
+        std::string name;
+        Symbol symbol;
+        ASTNode::Address address; // unresolved for globals, which are found by name
+        uint16_t slot;
+        StaticType type;
+        bool assigned;
+    };
+
+    // a function the native code calls directly, checked against the environment before every entry
+    struct Dependency {
+        std::string name;
+        Symbol symbol;
+        Region *callee;
+    };
+
+    State state = State::Cold;
+    uint32_t counter = 0;
+    const ASTNode *function = nullptr; // body of the compiled function, null for loops
+    void *code = nullptr;
+    size_t codeSize = 0;
+    uint16_t slotCount = 0;
+    std::vector<OuterVar> outer;
+    std::vector<Dependency> deps;
+
+    ~Region() {
+#ifdef LUMIN_JIT
+        if (code) munmap(code, codeSize);
+#endif
+    }
+};
+
+static std::optional<TypedValue> lookup(const ENV &env, Symbol name) {
+    for (Environment *e = env.get(); e; e = e->parent.get())
+        if (e->has(name)) return e->get(name);
+    return std::nullopt;
+}
+
+static std::optional<TypedValue> lookup(const ENV &env, Symbol name, const ASTNode::Address &address) {
+    if (address.slot != ASTNode::UNRESOLVED) return env->local(address);
+    return lookup(env, name);
+}
+
+[[noreturn]] static void unsupported() {
+    throw std::runtime_error("Region is not compilable");
+}
+
+namespace {
+
+enum Condition : uint8_t { CC_E = 0x4, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+bool isComparison(BinaryOp op) {
+    return op == COMPARISON || op == LESS || op == GREATER || op == LESS_EQUAL || op == GREATER_EQUAL;
+}
+
+uint8_t conditionOf(BinaryOp op) {
+    switch (op) {
+        case COMPARISON: return CC_E;
+        case LESS:       return CC_L;
+        case GREATER:    return CC_G;
+        case LESS_EQUAL: return CC_LE;
+        default:         return CC_GE;
+    }
+}
+
+class Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    void emit(std::initializer_list<uint8_t> bytes) { code.insert(code.end(), bytes); }
+
+    void imm32(int32_t value) {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &value, sizeof(bytes));
+        code.insert(code.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    void imm64(uint64_t value) {
+        uint8_t bytes[8];
+        std::memcpy(bytes, &value, sizeof(bytes));
+        code.insert(code.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    size_t here() const { return code.size(); }
+
+    // rel32 jumps, patched once the target is known
+    size_t jump() {
+        emit({0xE9});
+        imm32(0);
+        return here() - 4;
+    }
+
+    size_t jumpIf(uint8_t cc) {
+        emit({0x0F, static_cast<uint8_t>(0x80 | cc)});
+        imm32(0);
+        return here() - 4;
+    }
+
+    void patch(size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(target) - static_cast<int32_t>(at + 4);
+        std::memcpy(&code[at], &rel, sizeof(rel));
+    }
+
+    void patchHere(size_t at) { patch(at, here()); }
+    void jumpTo(size_t target) { patch(jump(), target); }
+};
+
+// right hand side of an arithmetic instruction whose left hand side is in eax
+struct Source {
+    enum Kind { Imm, Slot, Ecx } kind;
+    int32_t value;
+};
+
+}
+
+// Single pass code generator. Expressions leave their value in eax, slots are 8 bytes apart from rbx,
+// and depth tracks pushes so calls keep the stack 16 byte aligned.
+class RegionCompiler {
+public:
+    RegionCompiler(Jit &jit, Jit::Region &region, ENV env) : jit(jit), region(region), env(std::move(env)) {}
+
+    void function(const _FunctionData &data);
+    void loop(const std::shared_ptr<ASTNode> &node);
+
+private:
+    struct Local {
+        std::string name;
+        uint16_t slot;
+        StaticType type;
+    };
+
+    Jit &jit;
+    Jit::Region &region;
+    ENV env;
+    Assembler a;
+
+    std::vector<Local> locals;
+    std::vector<size_t> scopes;
+    std::vector<std::pair<uint16_t, StaticType>> selfRefs;
+    std::vector<size_t> returns;
+    StaticType retType = StaticType::Unknown;
+    int depth = 0;
+
+    uint16_t allocSlot();
+    Local resolve(const ASTNode &node, bool assign);
+    void finish();
+
+    void load(uint16_t slot) { a.emit({0x8B, 0x83}); a.imm32(slot * 8); }
+    void store(uint16_t slot) { a.emit({0x89, 0x83}); a.imm32(slot * 8); }
+    void loadImm(int32_t value) { a.emit({0xB8}); a.imm32(value); }
+    void push() { a.emit({0x50}); depth++; }
+    void epilogue() { a.emit({0x48, 0x8B, 0x5D, 0xF8, 0xC9, 0xC3}); }
+
+    void statement(const std::shared_ptr<ASTNode> &node, bool scoped);
+    StaticType assignment(const std::shared_ptr<ASTNode> &node, bool scoped);
+    void effect(const std::shared_ptr<ASTNode> &node);
+    void branchIfFalse(const std::shared_ptr<ASTNode> &cond, std::vector<size_t> &jumps);
+
+    StaticType expr(const std::shared_ptr<ASTNode> &node);
+    void arith(const std::shared_ptr<ASTNode> &node);
+    Source operand(const std::shared_ptr<ASTNode> &node);
+    void apply(BinaryOp op, const Source &src);
+    StaticType call(const std::shared_ptr<ASTNode> &node);
+};
+
+static bool alwaysReturns(const std::shared_ptr<ASTNode> &node) {
+    switch (node->type) {
+        case ASTNode::Type::RETURN_STATEMENT: return true;
+        case ASTNode::Type::BLOCK:
+            for (const auto &child : node->children)
+                if (alwaysReturns(child)) return true;
+            return false;
+        case ASTNode::Type::IF_STATEMENT:
+            return node->children.size() > 2 && node->children[2]->type == ASTNode::Type::ELSE_STATEMENT &&
+                   alwaysReturns(node->children[1]) && alwaysReturns(node->children[2]->children[0]);
+        default: return false;
+    }
+}
+
+void RegionCompiler::function(const _FunctionData &data) {
+    retType = staticTypeOf(data.retType);
+    if (retType != StaticType::Int && retType != StaticType::Bool) unsupported();
+    // falling off the end returns nil, which the interpreter reports as a type mismatch
+    if (!alwaysReturns(data.body)) unsupported();
+
+    // push rbp; mov rbp, rsp; push rbx; sub rsp, frame; mov rbx, rsp
+    a.emit({0x55, 0x48, 0x89, 0xE5, 0x53, 0x48, 0x81, 0xEC});
+    size_t frame = a.here();
+    a.imm32(0);
+    a.emit({0x48, 0x89, 0xE3});
+
+    for (size_t i = 0; i < data.params.size(); ++i) {
+        const Parameter &param = data.params[i];
+        StaticType type = staticTypeOf(param.type);
+        if (param.vararg || (type != StaticType::Int && type != StaticType::Bool)) unsupported();
+        uint16_t slot = allocSlot();
+        a.emit({0x8B, 0x87}); // mov eax, [rdi + 8i]
+        a.imm32(static_cast<int32_t>(i * 8));
+        store(slot);
+        locals.push_back({param.ident, slot, type});
+    }
+
+    statement(data.body, true);
+    for (size_t at : returns) a.patchHere(at);
+    epilogue();
+
+    int32_t frameSize = region.slotCount * 8;
+    if (frameSize % 16 == 0) frameSize += 8;
+    std::memcpy(&a.code[frame], &frameSize, sizeof(frameSize));
+    finish();
+}
+
+void RegionCompiler::loop(const std::shared_ptr<ASTNode> &node) {
+    bool isFor = node->type == ASTNode::Type::FOR_STATEMENT;
+    if (isFor && node->strValue() != "0") unsupported();
+
+    // push rbp; mov rbp, rsp; push rbx; sub rsp, 8; mov rbx, rdi
+    a.emit({0x55, 0x48, 0x89, 0xE5, 0x53, 0x48, 0x83, 0xEC, 0x08, 0x48, 0x89, 0xFB});
+
+    // entered where the interpreter would test the condition next
+    size_t top = a.here();
+    std::vector<size_t> exits;
+    branchIfFalse(node->children[isFor ? 1 : 0], exits);
+    if (isFor) {
+        statement(node->children[3], false);
+        effect(node->children[2]);
+    } else {
+        statement(node->children[1], false);
+    }
+    a.jumpTo(top);
+    for (size_t at : exits) a.patchHere(at);
+    epilogue();
+    finish();
+}
+
+uint16_t RegionCompiler::allocSlot() {
+    if (region.slotCount == UINT16_MAX) unsupported();
+    return region.slotCount++;
+}
+
+RegionCompiler::Local RegionCompiler::resolve(const ASTNode &node, bool assign) {
+    const std::string &name = node.strValue();
+    for (auto it = locals.rbegin(); it != locals.rend(); ++it)
+        if (it->name == name) return *it;
+    for (auto &var : region.outer) {
+        if (var.name != name || var.address.depth != node.address.depth || var.address.slot != node.address.slot) continue;
+        var.assigned |= assign;
+        return {name, var.slot, var.type};
+    }
+
+    // functions only see their parameters and locals, loops may use the interpreter's variables
+    if (region.function) unsupported();
+    auto val = lookup(env, node.symbol, node.address);
+    if (!val) unsupported();
+    StaticType type = staticTypeOf(val->type());
+    if (type != StaticType::Int && type != StaticType::Bool) unsupported();
+
+    uint16_t slot = allocSlot();
+    region.outer.push_back({name, node.symbol, node.address, slot, type, assign});
+    return {name, slot, type};
+}
+
+void RegionCompiler::finish() {
+#ifdef LUMIN_JIT
+    size_t size = a.code.size();
+    void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) throw std::runtime_error("Unable to map JIT code");
+    std::memcpy(mem, a.code.data(), size);
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        throw std::runtime_error("Unable to make JIT code executable");
+    }
+    region.code = mem;
+    region.codeSize = size;
+#else
+    unsupported();
+#endif
+}
+
+void RegionCompiler::statement(const std::shared_ptr<ASTNode> &node, bool scoped) {
+    if (!node) return;
+
+    switch (node->type) {
+        case ASTNode::Type::BLOCK:
+            scopes.push_back(locals.size());
+            for (const auto &child : node->children) statement(child, true);
+            locals.resize(scopes.back());
+            scopes.pop_back();
+            break;
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: assignment(node, scoped); break;
+        case ASTNode::Type::IF_STATEMENT: {
+            std::vector<size_t> skipThen;
+            branchIfFalse(node->children[0], skipThen);
+            statement(node->children[1], false);
+            if (node->children.size() > 2 && node->children[2]->type == ASTNode::Type::ELSE_STATEMENT) {
+                size_t skipElse = a.jump();
+                for (size_t at : skipThen) a.patchHere(at);
+                statement(node->children[2]->children[0], false);
+                a.patchHere(skipElse);
+            } else {
+                for (size_t at : skipThen) a.patchHere(at);
+            }
+            break;
+        }
+        case ASTNode::Type::WHILE_STATEMENT: {
+            size_t top = a.here();
+            std::vector<size_t> exits;
+            branchIfFalse(node->children[0], exits);
+            statement(node->children[1], false);
+            a.jumpTo(top);
+            for (size_t at : exits) a.patchHere(at);
+            break;
+        }
+        case ASTNode::Type::FOR_STATEMENT: {
+            if (node->strValue() != "0") unsupported();
+            scopes.push_back(locals.size());
+            statement(node->children[0], true);
+            size_t top = a.here();
+            std::vector<size_t> exits;
+            branchIfFalse(node->children[1], exits);
+            statement(node->children[3], false);
+            effect(node->children[2]);
+            a.jumpTo(top);
+            for (size_t at : exits) a.patchHere(at);
+            locals.resize(scopes.back());
+            scopes.pop_back();
+            break;
+        }
+        case ASTNode::Type::RETURN_STATEMENT:
+            // a loop can't leave the function it runs in
+            if (retType == StaticType::Unknown || node->children.empty()) unsupported();
+            if (expr(node->children[0]) != retType) unsupported();
+            returns.push_back(a.jump());
+            break;
+        default: expr(node); break;
+    }
+}
+
+StaticType RegionCompiler::assignment(const std::shared_ptr<ASTNode> &node, bool scoped) {
+    const auto &children = node->children;
+    if (children.size() > 1) unsupported(); // struct fields
+
+    if (node->primitiveValue == Primitive::NONE) {
+        if (children.empty()) unsupported();
+        Local var = resolve(*node, true);
+        selfRefs.emplace_back(var.slot, var.type);
+        StaticType type = expr(children[0]);
+        selfRefs.pop_back();
+        if (type != var.type) unsupported();
+        store(var.slot);
+        return type;
+    }
+
+    // a declaration outside a block lands in whatever environment the interpreter is in
+    if (!scoped) unsupported();
+    StaticType type;
+    switch (node->primitiveValue) {
+        case Primitive::INT: type = StaticType::Int; break;
+        case Primitive::BOOL: type = StaticType::Bool; break;
+        default: unsupported();
+    }
+    if (children.empty()) loadImm(0);
+    else if (expr(children[0]) != type) unsupported();
+
+    uint16_t slot = allocSlot();
+    store(slot);
+    locals.push_back({node->strValue(), slot, type});
+    return type;
+}
+
+void RegionCompiler::effect(const std::shared_ptr<ASTNode> &node) {
+    if (node->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT) assignment(node, false);
+    else expr(node);
+}
+
+void RegionCompiler::branchIfFalse(const std::shared_ptr<ASTNode> &cond, std::vector<size_t> &jumps) {
+    if (cond->type == ASTNode::Type::BINARY_OP && isComparison(cond->binopValue)) {
+        arith(cond);
+        jumps.push_back(a.jumpIf(conditionOf(cond->binopValue) ^ 1));
+        return;
+    }
+    if (expr(cond) != StaticType::Bool) unsupported();
+    a.emit({0x85, 0xC0}); // test eax, eax
+    jumps.push_back(a.jumpIf(CC_E));
+}
+
+StaticType RegionCompiler::expr(const std::shared_ptr<ASTNode> &node) {
+    switch (node->type) {
+        case ASTNode::Type::NUMBER:
+            loadImm(node->intValue);
+            return StaticType::Int;
+        case ASTNode::Type::BOOL:
+            loadImm(node->intValue != 0);
+            return StaticType::Bool;
+        case ASTNode::Type::IDENTIFIER: {
+            Local var = resolve(*node, false);
+            load(var.slot);
+            return var.type;
+        }
+        case ASTNode::Type::SELF_REFERENCE:
+            if (selfRefs.empty()) unsupported();
+            load(selfRefs.back().first);
+            return selfRefs.back().second;
+
+        case ASTNode::Type::BINARY_OP:
+            arith(node);
+            if (!isComparison(node->binopValue)) return StaticType::Int;
+            // setcc al; movzx eax, al
+            a.emit({0x0F, static_cast<uint8_t>(0x90 | conditionOf(node->binopValue)), 0xC0, 0x0F, 0xB6, 0xC0});
+            return StaticType::Bool;
+        case ASTNode::Type::UNARY_OP:
+            // the interpreter only applies unary operators to ints
+            if (expr(node->children[0]) != StaticType::Int) unsupported();
+            switch (node->binopValue) {
+                case MINUS: a.emit({0xF7, 0xD8}); return StaticType::Int;
+                case BITWISE_NOT: a.emit({0xF7, 0xD0}); return StaticType::Int;
+                case NOT: a.emit({0x85, 0xC0, 0x0F, 0x94, 0xC0, 0x0F, 0xB6, 0xC0}); return StaticType::Bool;
+                default: unsupported();
+            }
+        case ASTNode::Type::CALL: return call(node);
+        default: unsupported();
+    }
+}
+
+void RegionCompiler::arith(const std::shared_ptr<ASTNode> &node) {
+    BinaryOp op = node->binopValue;
+    switch (op) {
+        case PLUS: case MINUS: case MULTIPLY: case DIVIDE: case MODULUS: break;
+        default: if (!isComparison(op)) unsupported();
+    }
+    if (expr(node->children[0]) != StaticType::Int) unsupported();
+    apply(op, operand(node->children[1]));
+}
+
+Source RegionCompiler::operand(const std::shared_ptr<ASTNode> &node) {
+    if (node->type == ASTNode::Type::NUMBER) return {Source::Imm, node->intValue};
+    if (node->type == ASTNode::Type::IDENTIFIER) {
+        Local var = resolve(*node, false);
+        if (var.type != StaticType::Int) unsupported();
+        return {Source::Slot, var.slot};
+    }
+    if (node->type == ASTNode::Type::SELF_REFERENCE && !selfRefs.empty()) {
+        if (selfRefs.back().second != StaticType::Int) unsupported();
+        return {Source::Slot, selfRefs.back().first};
+    }
+
+    push();
+    if (expr(node) != StaticType::Int) unsupported();
+    a.emit({0x89, 0xC1, 0x58}); // mov ecx, eax; pop rax
+    depth--;
+    return {Source::Ecx, 0};
+}
+
+void RegionCompiler::apply(BinaryOp op, const Source &src) {
+    auto form = [this, &src](std::initializer_list<uint8_t> imm, std::initializer_list<uint8_t> slot,
+                             std::initializer_list<uint8_t> reg) {
+        switch (src.kind) {
+            case Source::Imm: a.emit(imm); a.imm32(src.value); break;
+            case Source::Slot: a.emit(slot); a.imm32(src.value * 8); break;
+            case Source::Ecx: a.emit(reg); break;
+        }
+    };
+
+    switch (op) {
+        case PLUS: form({0x05}, {0x03, 0x83}, {0x01, 0xC8}); break;
+        case MINUS: form({0x2D}, {0x2B, 0x83}, {0x29, 0xC8}); break;
+        case MULTIPLY: form({0x69, 0xC0}, {0x0F, 0xAF, 0x83}, {0x0F, 0xAF, 0xC1}); break;
+        case DIVIDE:
+        case MODULUS:
+            // divisor goes to ecx, then cdq; idiv ecx
+            if (src.kind == Source::Imm) {
+                a.emit({0xB9});
+                a.imm32(src.value);
+            } else if (src.kind == Source::Slot) {
+                a.emit({0x8B, 0x8B});
+                a.imm32(src.value * 8);
+            }
+            a.emit({0x99, 0xF7, 0xF9});
+            if (op == MODULUS) a.emit({0x89, 0xD0});
+            break;
+        default: form({0x3D}, {0x3B, 0x83}, {0x39, 0xC8}); break; // cmp
+    }
+}
+
+StaticType RegionCompiler::call(const std::shared_ptr<ASTNode> &node) {
+    const auto &callee = node->children[0];
+    if (callee->type != ASTNode::Type::IDENTIFIER) unsupported();
+    const std::string &name = callee->strValue();
+    for (const auto &local : locals)
+        if (local.name == name) unsupported();
+    for (const auto &var : region.outer)
+        if (var.name == name) unsupported();
+
+    auto val = lookup(env, callee->symbol);
+    if (!val || !val->is(BaseType::Function)) unsupported();
+    PFunction func = val->get<PFunction>();
+    if (!func->data) unsupported();
+
+    const ASTNode *body = func->data->body.get();
+    Jit::Region *target = body == region.function ? &region : jit.compileFunction(func->data, func->env);
+    if (!target) unsupported();
+
+    const auto &params = func->data->params;
+    size_t argc = node->children.size() - 1;
+    if (argc != params.size()) unsupported();
+
+    // arguments are pushed last to first so they sit in order at rsp
+    int pad = (depth + argc) % 2;
+    if (pad) {
+        a.emit({0x48, 0x83, 0xEC, 0x08});
+        depth++;
+    }
+    for (size_t i = argc; i-- > 0;) {
+        if (expr(node->children[i + 1]) != staticTypeOf(params[i].type)) unsupported();
+        push();
+    }
+    a.emit({0x48, 0x89, 0xE7}); // mov rdi, rsp
+    if (target == &region) {
+        a.emit({0xE8});
+        a.imm32(-static_cast<int32_t>(a.here() + 4));
+    } else {
+        a.emit({0x48, 0xB8});
+        a.imm64(reinterpret_cast<uint64_t>(target->code));
+        a.emit({0xFF, 0xD0});
+    }
+    int pops = static_cast<int>(argc) + pad;
+    if (pops) {
+        a.emit({0x48, 0x81, 0xC4});
+        a.imm32(pops * 8);
+        depth -= pops;
+    }
+
+    bool known = false;
+    for (const auto &dep : region.deps) known |= dep.name == name && dep.callee == target;
+    if (!known) region.deps.push_back({name, callee->symbol, target});
+    return staticTypeOf(func->data->retType);
+}
+
+Jit::Jit() = default;
+Jit::~Jit() = default;
+
+bool Jit::supported() {
+#ifdef LUMIN_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+Jit::Region *Jit::region(const ASTNode *node) {
+    auto &slot = regions[node];
+    if (!slot) slot = std::make_unique<Region>();
+    return slot.get();
+}
+
+Jit::Region *Jit::loop(const ASTNode *node) {
+    return region(node);
+}
+
+Jit::Region *Jit::compileFunction(const FunctionData &funcData, const ENV &env) {
+    Region *r = region(funcData->body.get());
+    if (r->state == Region::State::Compiled) return r;
+    if (r->state != Region::State::Cold) return nullptr;
+
+    r->state = Region::State::Compiling;
+    r->function = funcData->body.get();
+    try {
+        RegionCompiler(*this, *r, env).function(*funcData);
+        r->state = Region::State::Compiled;
+        return r;
+    } catch (const std::exception &) {
+        r->state = Region::State::Failed;
+        return nullptr;
+    }
+}
+
+bool Jit::compileLoop(Region &r, const std::shared_ptr<ASTNode> &node, const ENV &env) {
+    try {
+        RegionCompiler(*this, r, env).loop(node);
+        r.state = Region::State::Compiled;
+        return true;
+    } catch (const std::exception &) {
+        r.state = Region::State::Failed;
+        return false;
+    }
+}
+
+bool Jit::guard(const Region &r, const ENV &env) const {
+    for (const auto &dep : r.deps) {
+        auto val = lookup(env, dep.symbol);
+        if (!val || !val->is(BaseType::Function)) return false;
+        PFunction func = val->get<PFunction>();
+        if (!func->data || func->data->body.get() != dep.callee->function) return false;
+        if (dep.callee != &r && !guard(*dep.callee, func->env)) return false;
+    }
+    return true;
+}
+
+bool Jit::call(const FunctionData &funcData, const ENV &env,
+               const std::vector<std::shared_ptr<TypedValue>> &args, TypedValue &result) {
+    Region *r = region(funcData->body.get());
+    if (r->state == Region::State::Failed) return false;
+    if (r->state != Region::State::Compiled) {
+        if (++r->counter < HOT_CALLS || !compileFunction(funcData, env)) return false;
+    }
+
+    // anything the interpreter would complain about is left for it to report
+    const auto &params = funcData->params;
+    if (args.size() != params.size()) return false;
+    std::vector<int64_t> native(args.size());
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (!params[i].type.match(args[i]->type())) return false;
+        native[i] = args[i]->kind() == BaseType::Int ? args[i]->get<int>() : args[i]->get<bool>();
+    }
+    if (!guard(*r, env)) return false;
+
+    int32_t value = reinterpret_cast<int32_t (*)(const int64_t *)>(r->code)(native.data());
+    result = staticTypeOf(funcData->retType) == StaticType::Int ? TypedValue(value) : TypedValue(value != 0);
+    return true;
+}
+
+bool Jit::backEdge(Region *r, const std::shared_ptr<ASTNode> &node, const ENV &env) {
+    if (r->state == Region::State::Failed) return false;
+    if (r->state != Region::State::Compiled) {
+        if (++r->counter < HOT_BACK_EDGES || !compileLoop(*r, node, env)) return false;
+    }
+
+    std::vector<int64_t> vars(r->slotCount);
+    for (const auto &var : r->outer) {
+        auto val = lookup(env, var.symbol, var.address);
+        if (!val || staticTypeOf(val->type()) != var.type) return false;
+        vars[var.slot] = var.type == StaticType::Int ? val->get<int>() : val->get<bool>();
+    }
+    if (!guard(*r, env)) return false;
+
+    reinterpret_cast<void (*)(int64_t *)>(r->code)(vars.data());
+
+    for (const auto &var : r->outer) {
+        if (!var.assigned) continue;
+        int32_t value = static_cast<int32_t>(vars[var.slot]);
+        TypedValue val = var.type == StaticType::Int ? TypedValue(value) : TypedValue(value != 0);
+        if (var.address.slot != ASTNode::UNRESOLVED) env->local(var.address) = val;
+        else env->modify(var.symbol, val);
+    }
+    return true;
+}
@@ -7,8 +7,98 @@
 #include <algorithm>
 #include <numeric>
 #include <regex>
+#include <bit>
+#include <cstring>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// The runs the lexer skips most, whitespace, identifier bodies, string bodies and comments, are
+// scanned a whole vector of bytes at a time: each byte is classified with compares, the results
+// packed into a bit mask, and the first byte ending the run found from its lowest set bit. The
+// bytes left over at the end, and builds with neither AVX2 nor SSE2, go one at a time.
+#if defined(__AVX2__)
+struct Block {
+    static constexpr size_t width = 32;
+    __m256i v;
+
+    static Block load(const char *p) { return {_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))}; }
+    static __m256i splat(char c) { return _mm256_set1_epi8(c); }
+    __m256i eq(char c) const { return _mm256_cmpeq_epi8(v, splat(c)); }
+    // lo <= byte <= hi, compared unsigned
+    __m256i in(char lo, char hi) const {
+        __m256i offset = _mm256_sub_epi8(v, splat(lo));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, splat(hi - lo)), offset);
+    }
+    static __m256i any(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+    static uint32_t mask(__m256i m) { return static_cast<uint32_t>(_mm256_movemask_epi8(m)); }
+    static constexpr uint32_t all = 0xffffffff;
+};
+#elif defined(__SSE2__)
+struct Block {
+    static constexpr size_t width = 16;
+    __m128i v;
+
+    static Block load(const char *p) { return {_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))}; }
+    static __m128i splat(char c) { return _mm_set1_epi8(c); }
+    __m128i eq(char c) const { return _mm_cmpeq_epi8(v, splat(c)); }
+    __m128i in(char lo, char hi) const {
+        __m128i offset = _mm_sub_epi8(v, splat(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(offset, splat(hi - lo)), offset);
+    }
+    static __m128i any(__m128i a, __m128i b) { return _mm_or_si128(a, b); }
+    static uint32_t mask(__m128i m) { return static_cast<uint32_t>(_mm_movemask_epi8(m)); }
+    static constexpr uint32_t all = 0xffff;
+};
+#endif
+
+bool isSpace(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+bool isWordChar(unsigned char c) { return std::isalnum(c) || c == '_'; }
+
+// Each returns the first byte in [p, end) that stops the run, or end.
+const char *skipSpaces(const char *p, const char *end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; end - p >= static_cast<ptrdiff_t>(Block::width); p += Block::width) {
+        Block b = Block::load(p);
+        uint32_t stop = Block::all ^ Block::mask(Block::any(b.eq(' '), b.in('\t', '\r')));
+        if (stop) return p + std::countr_zero(stop);
+    }
+#endif
+    while (p < end && isSpace(*p)) ++p;
+    return p;
+}
 
-Lexer::Lexer(const std::string &source) : source(source), current(0), lineIndex(1), colIndex(1) {}
+const char *skipWord(const char *p, const char *end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; end - p >= static_cast<ptrdiff_t>(Block::width); p += Block::width) {
+        Block b = Block::load(p);
+        auto letter = Block::any(b.in('a', 'z'), b.in('A', 'Z'));
+        auto digitOrUnderscore = Block::any(b.in('0', '9'), b.eq('_'));
+        uint32_t stop = Block::all ^ Block::mask(Block::any(letter, digitOrUnderscore));
+        if (stop) return p + std::countr_zero(stop);
+    }
+#endif
+    while (p < end && isWordChar(*p)) ++p;
+    return p;
+}
+
+const char *findEither(const char *p, const char *end, char a, char b) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; end - p >= static_cast<ptrdiff_t>(Block::width); p += Block::width) {
+        Block block = Block::load(p);
+        uint32_t found = Block::mask(Block::any(block.eq(a), block.eq(b)));
+        if (found) return p + std::countr_zero(found);
+    }
+#endif
+    while (p < end && *p != a && *p != b) ++p;
+    return p;
+}
+
+} // namespace
+
+Lexer::Lexer(SourceFile file) : file(std::move(file)), source(this->file.text()) {}
 
 char Lexer::peek(size_t n) const {
     if (current + n >= source.size()) return '\0';
@@ -17,31 +107,41 @@ char Lexer::peek(size_t n) const {
 
 char Lexer::consume() {
     if (current >= source.size()) return '\0';
-    char c = source[current++];
-    if (c == '\n') {
+    return source[current++];
+}
+
+void Lexer::locate(size_t offset) {
+    const char *begin = source.data();
+    const char *p = begin + located;
+    const char *end = begin + offset;
+    while (const void *newline = std::memchr(p, '\n', end - p)) {
+        p = static_cast<const char *>(newline) + 1;
         lineIndex++;
-        colIndex = 1;
-    } else {
-        colIndex++;
+        lineStart = p - begin;
     }
-    return c;
+    located = offset;
+}
+
+void Lexer::error(const std::string &msg) {
+    locate(std::min(current, source.size()));
+    throw std::runtime_error(msg + " at " + std::to_string(lineIndex) + ":" + std::to_string(column(current)));
 }
 
-void Lexer::selfUpd(std::vector<Token>* tokens, const std::string &value, Token::Type type, unsigned long tokenLine, unsigned long tokenCol, int by) {
-    tokens->push_back(Token{Token::Type::SELF_REFERENCE, "@", tokenLine, tokenCol});
-    tokens->push_back(Token{type, value, tokenLine, tokenCol});
-    tokens->back().binopValue = binopMap.at(value);
-    if(by != 0) tokens->push_back(Token{Token::Type::NUMBER, std::to_string(by), tokenLine, tokenCol});
+void Lexer::selfUpd(std::vector<Token>* tokens, std::string_view value, Token::Type type, uint32_t tokenLine, uint32_t tokenCol, int by) {
+    tokens->push_back(Token{"@", tokenLine, tokenCol, Token::Type::SELF_REFERENCE});
+    tokens->push_back(Token{value, tokenLine, tokenCol, type});
+    tokens->back().binopValue = type == Token::Type::PLUS ? PLUS : MINUS;
+    if(by != 0) tokens->push_back(Token{"1", tokenLine, tokenCol, Token::Type::NUMBER});
 }
 
-void Lexer::pushSelfUpd(std::vector<Token>* tokens, const std::string &value, Token::Type type, unsigned long tokenLine, unsigned long tokenCol, int by) {
-    tokens->push_back(Token{Token::Type::EQUAL, "=", tokenLine, tokenCol});
+void Lexer::pushSelfUpd(std::vector<Token>* tokens, std::string_view value, Token::Type type, uint32_t tokenLine, uint32_t tokenCol, int by) {
+    tokens->push_back(Token{"=", tokenLine, tokenCol, Token::Type::EQUAL});
     selfUpd(tokens, value, type, tokenLine, tokenCol, by);
 }
 
-void Lexer::simplitiveBinOp(std::vector<Token>* tokens, const std::string &value, Token::Type type, unsigned long tokenLine, unsigned long tokenCol) {
+void Lexer::simplitiveBinOp(std::vector<Token>* tokens, std::string_view value, Token::Type type, uint32_t tokenLine, uint32_t tokenCol) {
     consume();
-    if(peek() == *value.c_str()) {
+    if(peek() == value[0]) {
         consume();
         pushSelfUpd(tokens, value, type, tokenLine, tokenCol, 1);
         return;
@@ -51,17 +151,68 @@ void Lexer::simplitiveBinOp(std::vector<Token>* tokens, const std::string &value
         pushSelfUpd(tokens, value, type, tokenLine, tokenCol, 0);
         return;
     }
-    Token token{type, value, tokenLine, tokenCol};
-    token.binopValue = binopMap.at(value);
+    Token token{value, tokenLine, tokenCol, type};
+    token.binopValue = type == Token::Type::PLUS ? PLUS : MINUS;
     tokens->push_back(token);
 }
 
-bool Lexer::skipWhitespace() {
-    if (std::isspace(static_cast<unsigned char>(peek()))) {
-        consume();
+// Operators are told apart by their first character, taking the longest one that matches. The
+// binary op is only set for operators the parser turns into BINARY_OP or UNARY_OP nodes.
+bool Lexer::scanOperator(std::vector<Token> &tokens, uint32_t tokenLine, uint32_t tokenCol) {
+    auto push = [&](Token::Type type, size_t length, BinaryOp binop = PLUS) {
+        size_t start = current;
+        for (size_t i = 0; i < length; ++i) consume();
+        tokens.push_back(Token{text(start), tokenLine, tokenCol, type, binop});
         return true;
+    };
+
+    switch (peek()) {
+        case '&':
+            if (peek(1) == '&') return push(Token::Type::AND, 2);
+            return push(Token::Type::BITWISE_AND, 1, BITWISE_AND);
+        case '|':
+            if (peek(1) == '|') return push(Token::Type::OR, 2);
+            return push(Token::Type::BITWISE_OR, 1, BITWISE_OR);
+        case '=':
+            if (peek(1) == '=') return push(Token::Type::COMPARISON, 2, COMPARISON);
+            return push(Token::Type::EQUAL, 1);
+        case '<':
+            if (peek(1) == '=') return push(Token::Type::LESS_EQUAL, 2, LESS_EQUAL);
+            return push(Token::Type::LESS, 1, LESS);
+        case '>':
+            if (peek(1) == '=') return push(Token::Type::GREATER_EQUAL, 2, GREATER_EQUAL);
+            return push(Token::Type::GREATER, 1, GREATER);
+        case '.':
+            if (peek(1) != '.') return push(Token::Type::READ, 1);
+            if (peek(2) == '.') return push(Token::Type::SPREAD, 3);
+            return push(Token::Type::RANGE, 2);
+        case '-':
+            if (peek(1) == '>') return push(Token::Type::ARROW, 2);
+            return false;
+        case '^': return push(Token::Type::BITWISE_XOR, 1, BITWISE_XOR);
+        case '~': return push(Token::Type::BITWISE_NOT, 1, BITWISE_NOT);
+        case '*': return push(Token::Type::MULTIPLY, 1, MULTIPLY);
+        case '/': return push(Token::Type::DIVIDE, 1, DIVIDE);
+        case '%': return push(Token::Type::MODULUS, 1, MODULUS);
+        case '!': return push(Token::Type::NOT, 1, NOT);
+        case ';': return push(Token::Type::SEMICOLON, 1);
+        case ',': return push(Token::Type::COMMA, 1);
+        case '(': return push(Token::Type::LPAREN, 1);
+        case ')': return push(Token::Type::RPAREN, 1);
+        case '[': return push(Token::Type::LBRACKET, 1);
+        case ']': return push(Token::Type::RBRACKET, 1);
+        case '{': return push(Token::Type::LBRACE, 1);
+        case '}': return push(Token::Type::RBRACE, 1);
+        case '?': return push(Token::Type::QUESTION_MARK, 1);
+        case ':': return push(Token::Type::COLON, 1);
+        default: return false;
     }
-    return false;
+}
+
+bool Lexer::skipWhitespace() {
+    size_t start = current;
+    current = skipSpaces(source.data() + current, source.data() + source.size()) - source.data();
+    return current != start;
 }
 
 std::vector<std::string> split(const std::string& str, char delimiter) {
@@ -109,19 +260,28 @@ void Lexer::applyHeader(const std::string &header) {
 
         std::string from = match[1].str();
         std::string to = match[2].str();
+        auto wordChar = [](unsigned char c) { return std::isalnum(c) || c == '_'; };
+        if (std::isdigit(static_cast<unsigned char>(from[0])) || !std::all_of(from.begin(), from.end(), wordChar)) {
+            throw std::runtime_error("Alias name must be an identifier: " + from);
+        }
 
-        aliases[from] = to;
+        Alias alias{std::make_unique<Lexer>(std::move(to)), {}};
+        alias.tokens = alias.lexer->tokenize();
+        alias.tokens.pop_back(); // END_OF_FILE
+        aliases.insert_or_assign(std::move(from), std::move(alias));
     }
 }
 
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
+    tokens.reserve(source.size() / 4); // about one token per four bytes of typical source
+    while (scan(tokens)) {}
+    return tokens;
+}
 
-    std::vector<std::pair<std::string, Token::Type>> sortedOps(operators.begin(), operators.end());
-    std::sort(sortedOps.begin(), sortedOps.end(), [](const auto &a, const auto &b) {
-        return a.first.size() > b.first.size();
-    });
-
+// #headers may only come before the first token.
+void Lexer::readHeaders() {
+    headersRead = true;
     while(peek()) {
         if(skipWhitespace()) continue;
 
@@ -141,18 +301,19 @@ std::vector<Token> Lexer::tokenize() {
 
         break;
     }
+}
 
-    for (const auto& [from, to] : aliases) {
-        std::regex re(R"((^|[^"])\b)" + from + R"(\b($|[^"]))");
-        source = std::regex_replace(source, re, "$1" + to + "$2");
-    }
+// A lexeme is one token, unless it is something like `x++` or an alias that stands for several.
+bool Lexer::scan(std::vector<Token> &tokens) {
+    if (!headersRead) readHeaders();
 
     while (peek()) {
         if(skipWhitespace()) continue;
 
         if(peek() == '/') {
             if(peek(1) == '/') {
-                while (peek() && peek() != '\n') consume();
+                const void *newline = std::memchr(source.data() + current, '\n', source.size() - current);
+                current = newline ? static_cast<const char *>(newline) - source.data() : source.size();
                 continue;
             } else if(peek(1) == '*') {
                 while (peek() && peek(1) && peek() != '*' && peek(1) != '/') consume();
@@ -160,44 +321,19 @@ std::vector<Token> Lexer::tokenize() {
             }
         }
 
-        size_t tokenLine = lineIndex;
-        size_t tokenCol = colIndex;
+        locate(current);
+        uint32_t tokenLine = lineIndex;
+        uint32_t tokenCol = column(current);
 
-        bool matched = false;
-
-        // Operator matching
-        for (const auto &entry : sortedOps) {
-            const std::string &opString = entry.first;
-            const Token::Type type = entry.second;
-
-            bool ok = true;
-            for (size_t i = 0; i < opString.size(); i++) {
-                if (peek(i) != opString[i]) {
-                    ok = false;
-                    break;
-                }
-            }
-            if (!ok) continue;
-
-            for (size_t i = 0; i < opString.size(); i++) consume();
-
-            Token token{type, opString, tokenLine, tokenCol};
-            if (binopMap.find(opString) != binopMap.end())
-                token.binopValue = binopMap.at(opString);
-
-            tokens.push_back(token);
-            matched = true;
-            break;
-        }
-        if (matched) continue;
+        if (scanOperator(tokens, tokenLine, tokenCol)) return true;
         
         if (peek() == '+') {
             simplitiveBinOp(&tokens, "+", Token::Type::PLUS, tokenLine, tokenCol);
-            continue;
+            return true;
         }
         if (peek() == '-') {
             simplitiveBinOp(&tokens, "-", Token::Type::MINUS, tokenLine, tokenCol);
-            continue;
+            return true;
         }
         if (peek() == '@') {
             consume();
@@ -205,47 +341,53 @@ std::vector<Token> Lexer::tokenize() {
                 if(peek() == '-') {
                     consume();
                     selfUpd(&tokens, "-", Token::Type::MINUS, tokenLine, tokenCol, 1);
-                    continue;
+                    return true;
                 }
                 if (peek() == '+') {
                     consume();
                     selfUpd(&tokens, "+", Token::Type::PLUS, tokenLine, tokenCol, 1);
-                    continue;
+                    return true;
                 }
             }
-            tokens.push_back(Token{Token::Type::SELF_REFERENCE, "@", tokenLine, tokenCol});
-            continue;
+            tokens.push_back(Token{"@", tokenLine, tokenCol, Token::Type::SELF_REFERENCE});
+            return true;
         }
 
-        // String literal
+        // String literal, viewing the source unless it has escapes to undo
         if (peek() == '"') {
             consume();
+            size_t start = current;
+            bool escaped = false;
             std::string str;
-            while (peek() && peek() != '"') {
-                char c = consume();
-                if (c == '\\') {
-                    char next = consume();
-                    switch (next) {
-                        case 'n': str += '\n'; break;
-                        case 't': str += '\t'; break;
-                        case '\\': str += '\\'; break;
-                        case '"': str += '"'; break;
-                        default: str += next; break;
-                    }
-                } else {
-                    str += c;
+            for (;;) {
+                size_t stop = findEither(source.data() + current, source.data() + source.size(), '"', '\\') - source.data();
+                if (escaped) str.append(source, current, stop - current);
+                current = stop;
+                if (current == source.size()) error("Unterminated string literal");
+                if (source[current] == '"') break;
+
+                if (!escaped) str.assign(source, start, current - start);
+                escaped = true;
+                current++;
+                char next = consume();
+                switch (next) {
+                    case 'n': str += '\n'; break;
+                    case 't': str += '\t'; break;
+                    case '\\': str += '\\'; break;
+                    case '"': str += '"'; break;
+                    default: str += next; break;
                 }
             }
-            if (peek() != '"') throw std::runtime_error("Unterminated string literal");
+            std::string_view value = escaped ? strings.emplace_back(std::move(str)) : text(start);
             consume();
-            tokens.push_back(Token{Token::Type::STRING, str, tokenLine, tokenCol});
-            continue;
+            tokens.push_back(Token{value, tokenLine, tokenCol, Token::Type::STRING});
+            return true;
         }
 
         // Number literal
         if (std::isdigit(peek()) || (peek() == '-' && std::isdigit(peek(1)))) {
-            std::string number;
-            if (peek() == '-') number += consume();
+            size_t start = current;
+            if (peek() == '-') consume();
             bool decimal = false;
             char last = ' ';
             while (std::isdigit(peek()) || peek() == '.') {
@@ -256,39 +398,79 @@ std::vector<Token> Lexer::tokenize() {
                         goto out;
                     }
                     if (decimal) {
-                        throw std::runtime_error("Multiple decimal points in number");
+                        error("Multiple decimal points in number");
                     }
                     decimal = true;
                 }
-                number += c;
                 last = c;
                 consume();
             }
             out:
-            tokens.push_back(Token{Token::Type::NUMBER, number, tokenLine, tokenCol});
-            continue;
+            tokens.push_back(Token{text(start), tokenLine, tokenCol, Token::Type::NUMBER});
+            return true;
         }
 
         if (std::isalpha(peek()) || peek() == '_') {
-            std::string ident;
-            while (std::isalnum(peek()) || peek() == '_') ident += consume();
-
-            Token token{Token::Type::IDENTIFIER, ident, tokenLine, tokenCol};
+            size_t start = current;
+            current = skipWord(source.data() + current, source.data() + source.size()) - source.data();
+
+            // aliases are expanded on words only, so never inside string literals
+            if (!aliases.empty()) {
+                auto alias = aliases.find(text(start));
+                if (alias != aliases.end()) {
+                    for (Token token : alias->second.tokens) {
+                        token.lineIndex = tokenLine;
+                        token.colIndex = tokenCol;
+                        tokens.push_back(token);
+                    }
+                    return true;
+                }
+            }
 
-            if (keywords.find(ident) != keywords.end()) {
-                token.type = Token::Type::KEYWORD;
-            } else if (primitives.find(ident) != primitives.end()) {
-                token.type = Token::Type::PRIMITIVE;
-                token.primitiveValue = primitives.at(ident);
+            Token token{text(start), tokenLine, tokenCol, Token::Type::IDENTIFIER};
+            if (const Word *word = findWord(token.value)) {
+                token.type = word->type;
+                token.primitiveValue = word->primitive;
             }
 
             tokens.push_back(token);
-            continue;
+            return true;
         }
 
-        throw std::runtime_error("Unexpected character: " + std::string(1, consume()));
+        error("Unexpected character: " + std::string(1, peek()));
     }
 
-    tokens.push_back(Token{Token::Type::END_OF_FILE, "", lineIndex, colIndex});
-    return tokens;
-}
\ No newline at end of file
+    locate(current);
+    tokens.push_back(Token{"", lineIndex, column(current), Token::Type::END_OF_FILE});
+    return false;
+}
+
+void TokenStream::fill(size_t n) {
+    if (n >= LOOKAHEAD) throw std::runtime_error("Cannot look " + std::to_string(n) + " tokens ahead");
+    while (count <= n) {
+        // an alias may expand to nothing, so a scan can leave pending empty
+        while (pendingPos == pending.size()) {
+            if (ended) {
+                pendingPos--; // END_OF_FILE, again
+                break;
+            }
+            pending.clear();
+            pendingPos = 0;
+            ended = !lexer.scan(pending);
+        }
+        ring[(head + count++) % LOOKAHEAD] = pending[pendingPos++];
+    }
+}
+
+Token TokenStream::peek(size_t n) {
+    fill(n);
+    return ring[(head + n) % LOOKAHEAD];
+}
+
+Token TokenStream::consume() {
+    fill(0);
+    Token token = ring[head];
+    head = (head + 1) % LOOKAHEAD;
+    count--;
+    return token;
+}
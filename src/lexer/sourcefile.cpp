@@ -0,0 +1,46 @@
+#include "sourcefile.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+std::optional<SourceFile> SourceFile::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return std::nullopt;
+
+    SourceFile file;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+            file.mapping = mapping;
+            file.mappedSize = info.st_size;
+            file.view = std::string_view(static_cast<const char *>(mapping), info.st_size);
+            close(fd);
+            return file;
+        }
+    }
+
+    char chunk[1 << 16];
+    ssize_t got;
+    while ((got = read(fd, chunk, sizeof(chunk))) > 0) file.buffer.append(chunk, got);
+    close(fd);
+    if (got < 0) return std::nullopt;
+    file.view = file.buffer;
+    return file;
+}
+
+SourceFile::SourceFile(SourceFile &&other) noexcept
+    : buffer(std::move(other.buffer)),
+      mapping(std::exchange(other.mapping, nullptr)),
+      mappedSize(std::exchange(other.mappedSize, 0)) {
+    // a short buffer moves its characters, so the view is taken again
+    view = mapping ? other.view : std::string_view(buffer);
+    other.view = {};
+}
+
+SourceFile::~SourceFile() {
+    if (mapping) munmap(mapping, mappedSize);
+}
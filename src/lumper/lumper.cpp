@@ -1,4 +1,5 @@
 #include "lumper.hpp"
+#include "parserutils.hpp"
 #include <sstream>
 #include <fstream>
 #include <cstdint>
@@ -6,9 +7,10 @@
 #include <stdexcept>
 #include <zstd.h>
 #include <cstring>
+#include <unordered_map>
 
 constexpr char LUMP_MAGIC[4] = {'L','U','M','P'};
-constexpr uint8_t LUMP_VERSION = 5;
+constexpr uint8_t LUMP_VERSION = 7;
 constexpr uint64_t MAX_DSIZE = 1ULL << 30; 
 constexpr uint64_t MAX_CSIZE = 1ULL << 30; 
 constexpr uint32_t MAX_AST_DEPTH = 2000;
@@ -84,7 +86,30 @@ static std::string readString(std::istream &in) {
     return s;
 }
 
-static void encodeNode(const std::shared_ptr<ASTNode> &node, std::ostream &out) {
+// Every name and literal is written once, in a table ahead of the nodes, which refer to it by index.
+// Unlumping interns each entry once and hands nodes its Symbol.
+struct StringTable {
+    std::unordered_map<Symbol, uint32_t> ids;
+    std::vector<Symbol> symbols;
+
+    uint32_t id(Symbol symbol) {
+        auto [it, inserted] = ids.try_emplace(symbol, static_cast<uint32_t>(symbols.size()));
+        if (inserted) symbols.push_back(symbol);
+        return it->second;
+    }
+};
+
+struct Strings {
+    std::vector<Symbol> symbols;
+
+    Symbol read(std::istream &in) const {
+        uint32_t id = readVarint(in);
+        if (id >= symbols.size()) throw std::runtime_error("String index out of range");
+        return symbols[id];
+    }
+};
+
+static void encodeNode(const std::shared_ptr<ASTNode> &node, std::ostream &out, StringTable &table) {
     if (!node) throw std::runtime_error("Null AST node");
     uint32_t childCount = static_cast<uint32_t>(node->children.size());
     uint8_t tval = uint8_t(node->type);
@@ -93,6 +118,7 @@ static void encodeNode(const std::shared_ptr<ASTNode> &node, std::ostream &out)
     if (childCount < 7) header |= uint8_t(childCount);
     else header |= 0b111;
     writeByte(out, header);
+    writeVarint(out, node->line);
 
     switch (node->type) {
         case ASTNode::Type::BINARY_OP:
@@ -113,7 +139,7 @@ static void encodeNode(const std::shared_ptr<ASTNode> &node, std::ostream &out)
 
     switch (node->type) {
         case ASTNode::Type::FUNCTION:
-            writeString(out, node->retType);
+            writeVarint(out, table.id(node->retSymbol));
         case ASTNode::Type::NUMBER:
         case ASTNode::Type::STRING:
         case ASTNode::Type::IDENTIFIER:
@@ -125,24 +151,25 @@ static void encodeNode(const std::shared_ptr<ASTNode> &node, std::ostream &out)
         case ASTNode::Type::PRAGMA:
         case ASTNode::Type::BOOL:
         case ASTNode::Type::FOR_STATEMENT:
-            writeString(out, node->strValue);
+            writeVarint(out, table.id(node->symbol));
             break;
         default:
             break;
     }
 
     if (childCount >= 7) writeVarint(out, childCount);
-    for (const auto &c : node->children) encodeNode(c, out);
+    for (const auto &c : node->children) encodeNode(c, out, table);
 }
 
-static std::shared_ptr<ASTNode> decodeNode(std::istream &in, uint32_t depth) {
+static std::shared_ptr<ASTNode> decodeNode(std::istream &in, const Strings &strings, uint32_t depth) {
     if (depth > MAX_AST_DEPTH) throw std::runtime_error("AST depth exceeded safe limit");
-    auto n = std::make_shared<ASTNode>();
+    auto n = std::allocate_shared<ASTNode>(ASTAllocator<ASTNode>());
     uint8_t header = readByte(in);
     uint8_t tval = header >> 3;
     if (tval > TYPE_MAX_VALUE) throw std::runtime_error("Invalid node type");
     n->type = ASTNode::Type(tval);
     uint8_t small = header & 0b111;
+    n->line = readVarint(in);
 
     switch (n->type) {
         case ASTNode::Type::BINARY_OP:
@@ -163,7 +190,7 @@ static std::shared_ptr<ASTNode> decodeNode(std::istream &in, uint32_t depth) {
 
     switch (n->type) {
         case ASTNode::Type::FUNCTION:
-            n->retType = readString(in);
+            n->retSymbol = strings.read(in);
         case ASTNode::Type::NUMBER:
         case ASTNode::Type::STRING:
         case ASTNode::Type::IDENTIFIER:
@@ -175,16 +202,24 @@ static std::shared_ptr<ASTNode> decodeNode(std::istream &in, uint32_t depth) {
         case ASTNode::Type::PRAGMA:
         case ASTNode::Type::BOOL:
         case ASTNode::Type::FOR_STATEMENT:
-            n->strValue = readString(in);
+            n->symbol = strings.read(in);
             break;
         default:
             break;
     }
 
+    if (n->type == ASTNode::Type::NUMBER) {
+        auto value = parseNumberLiteral(n->strValue());
+        if (!value) throw std::runtime_error("Number literal out of range: " + n->strValue());
+        n->intValue = *value;
+    } else if (n->type == ASTNode::Type::BOOL) {
+        n->intValue = n->strValue() == "1";
+    }
+
     uint32_t cc = (small < 7) ? small : readVarint(in);
     if (cc > 10000000) throw std::runtime_error("Child count unreasonable");
     n->children.reserve(cc);
-    for (uint32_t i = 0; i < cc; ++i) n->children.push_back(decodeNode(in, depth + 1));
+    for (uint32_t i = 0; i < cc; ++i) n->children.push_back(decodeNode(in, strings, depth + 1));
     return n;
 }
 
@@ -193,10 +228,15 @@ Lumper::Lumper(const std::shared_ptr<ASTNode> &ast) : ast(ast) {}
 void Lumper::lump(const std::string &loc) {
     if (!ast) throw std::runtime_error("Cannot lump a null AST root node");
 
-    std::ostringstream uncompressed;
+    StringTable table;
+    std::ostringstream nodes;
+    for (const auto &c : ast->children) encodeNode(c, nodes, table);
 
+    std::ostringstream uncompressed;
+    writeVarint(uncompressed, static_cast<uint32_t>(table.symbols.size()));
+    for (Symbol symbol : table.symbols) writeString(uncompressed, Symbols::name(symbol));
     writeVarint(uncompressed, static_cast<uint32_t>(ast->children.size()));
-    for (const auto &c : ast->children) encodeNode(c, uncompressed);
+    uncompressed << nodes.str();
 
     const std::string inData = uncompressed.str();
     const size_t inSize = inData.size();
@@ -242,13 +282,20 @@ std::shared_ptr<ASTNode> Lumper::unlump(const std::string &loc) {
     if (ds != dsize) throw std::runtime_error("Decompressed size mismatch");
 
     std::istringstream iss(std::string(dbuf.data(), ds));
-    auto root = std::make_shared<ASTNode>();
+    ASTArena::Scope arena;
+    auto root = std::allocate_shared<ASTNode>(ASTAllocator<ASTNode>());
     root->type = ASTNode::Type::PROGRAM;
 
+    Strings strings;
+    uint32_t sc = readVarint(iss);
+    if (sc > dsize) throw std::runtime_error("String table size unreasonable");
+    strings.symbols.reserve(sc);
+    for (uint32_t i = 0; i < sc; ++i) strings.symbols.push_back(Symbols::intern(readString(iss)));
+
     uint32_t cc = readVarint(iss);
     if (cc > 10000000) throw std::runtime_error("Top-level child count unreasonable");
 
     root->children.reserve(cc);
-    for (uint32_t i = 0; i < cc; ++i) root->children.push_back(decodeNode(iss, 0));
+    for (uint32_t i = 0; i < cc; ++i) root->children.push_back(decodeNode(iss, strings, 0));
     return root;
 }
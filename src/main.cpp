@@ -8,6 +8,12 @@
 #include "parser.hpp"
 #include "lumper.hpp"
 #include "executor.hpp"
+#include "vm.hpp"
+#include "closure.hpp"
+#include "cppemitter.hpp"
+#include "typechecker.hpp"
+#include "consteval.hpp"
+#include "optimizer.hpp"
 
 std::string stringifyToken(const Token& token) {
     static const std::unordered_map<Token::Type, std::string> tokenTypeMap = {
@@ -51,11 +57,12 @@ struct ParsedData {
     std::string lumpPath;
 };
 
-ParsedData parseAndLumpIfNeeded(const std::string& filename, const std::string& source, bool forceLump) {
-    Lexer lexer(source);
-    auto tokens = lexer.tokenize();
+ParsedData parseAndLumpIfNeeded(const std::string& filename, SourceFile source, bool forceLump, int optLevel) {
+    TokenStream tokens(std::move(source));
     Parser parser(tokens, filename);
     auto ast = parser.parseProgram();
+    ConstEvaluator().evaluate(ast);
+    Optimizer(optLevel).optimize(ast);
 
     std::ofstream debug("astdebug.txt");
     debug << astToString(ast);
@@ -72,10 +79,13 @@ ParsedData parseAndLumpIfNeeded(const std::string& filename, const std::string&
 int main(int argc, char *argv[]) {
     if (argc < 2) {
         std::cout << "Usage: " << argv[0] << " [options] <file>\n";
+        std::cout << "Options: --lmp, --run, --emit-cpp, --engine=ast|vm|closure, --dump-bytecode, --no-jit, -O0|-O1|-O2\n";
         return 1;
     }
 
-    bool runLumper = false, exec = false;
+    bool runLumper = false, exec = false, emitCpp = false, jit = true, dumpBytecode = false;
+    int optLevel = 0;
+    std::string engine = "ast";
     std::string expFileName;
     std::string filename;
 
@@ -89,6 +99,15 @@ int main(int argc, char *argv[]) {
         expFileName = "";
         exec = true;
     };
+    commands["--emit-cpp"] = [&](int& i, char**) {
+        emitCpp = true;
+    };
+    commands["--dump-bytecode"] = [&](int& i, char**) {
+        dumpBytecode = true;
+    };
+    commands["--no-jit"] = [&](int& i, char**) {
+        jit = false;
+    };
 
     int i = 1;
     while (i < argc) {
@@ -101,6 +120,26 @@ int main(int argc, char *argv[]) {
             continue;
         }
 
+        if (arg.starts_with("--engine=")) {
+            engine = arg.substr(9);
+            if (engine != "ast" && engine != "vm" && engine != "closure") {
+                std::cerr << "Unknown engine: " << engine << ". Expected ast, vm or closure.\n";
+                return 1;
+            }
+            i++;
+            continue;
+        }
+
+        if (arg.starts_with("-O")) {
+            if (arg.size() != 3 || arg[2] < '0' || arg[2] > '2') {
+                std::cerr << "Unknown optimization level: " << arg << ". Expected -O0, -O1 or -O2.\n";
+                return 1;
+            }
+            optLevel = arg[2] - '0';
+            i++;
+            continue;
+        }
+
         filename = arg;
         break;
     }
@@ -110,27 +149,23 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    std::ifstream file(filename);
-    if (!file) {
+    auto source = SourceFile::open(filename);
+    if (!source) {
         std::cerr << "Path: " << filename << "\n";
         perror("Failed to open file");
         return 1;
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string source = buffer.str();
-
     if (runLumper) {
-        parseAndLumpIfNeeded(filename, source, true);
+        parseAndLumpIfNeeded(filename, std::move(*source), true, optLevel);
         return 0;
-    } else if (exec) {
+    } else if (exec || emitCpp) {
         std::string ext = filename.substr(filename.size() - 4);
         std::string lumpLoc;
 
         std::shared_ptr<ASTNode> ast;
         if (ext == ".lum") {
-            auto parsed = parseAndLumpIfNeeded(filename, source, true);
+            auto parsed = parseAndLumpIfNeeded(filename, std::move(*source), true, optLevel);
             ast = parsed.ast;
             lumpLoc = parsed.lumpPath;
         } else if (ext == ".lmp") {
@@ -147,7 +182,30 @@ int main(int argc, char *argv[]) {
             return 1;
         }
 
-        Executor(decoded).run();
+        std::ofstream debugUnlumped("astdebug2.txt");
+        debugUnlumped << astToString(decoded);
+        debugUnlumped.close();
+
+        auto typeErrors = TypeChecker().check(decoded);
+        if (!typeErrors.empty()) {
+            for (const auto &err : typeErrors) std::cerr << err << "\n";
+            return 1;
+        }
+
+        if (emitCpp) {
+            std::string cppPath = filename.substr(0, filename.size() - 4) + ".cpp";
+            std::ofstream cpp(cppPath);
+            if (!cpp) {
+                std::cerr << "Failed to write " << cppPath << "\n";
+                return 1;
+            }
+            cpp << CppEmitter(decoded).emit();
+            return 0;
+        }
+
+        if (engine == "vm") VM(decoded, dumpBytecode).run();
+        else if (engine == "closure") ClosureEngine(decoded).run();
+        else Executor(decoded, jit).run();
         return 0;
     }
 
@@ -0,0 +1,252 @@
+#include "consteval.hpp"
+#include "executor.hpp"
+#include "parserutils.hpp"
+#include <algorithm>
+#include <climits>
+#include <exception>
+
+// A call needing more than this is left for the run, so one that never finishes or would overflow the
+// stack cannot stop the lump.
+constexpr size_t STEP_LIMIT = 250'000; // calls and loop iterations
+constexpr size_t DEPTH_LIMIT = 1'000; // nested calls
+
+// How often each name is declared or assigned anywhere in the module, a const fin is only resolved by
+// a name that stands for nothing else.
+static void countBindings(const ASTNode &node, std::unordered_map<Symbol, size_t> &bindings) {
+    switch (node.type) {
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT:
+            if (node.children.size() < 2 || node.children[0]->type != ASTNode::Type::READ) bindings[node.symbol]++;
+            break;
+        case ASTNode::Type::FUNCTION:
+            for (size_t i = 0; i + 1 < node.children.size(); ++i) bindings[node.children[i]->symbol]++;
+            [[fallthrough]];
+        case ASTNode::Type::STRUCT_ASSIGNMENT:
+        case ASTNode::Type::NDARRAY_ASSIGN:
+        case ASTNode::Type::NATIVE_STATEMENT:
+            bindings[node.symbol]++;
+            break;
+        case ASTNode::Type::IMPORT_BLOCK:
+            for (const auto &import : node.children)
+                if (!import->children.empty()) bindings[import->children[0]->symbol]++;
+            return;
+        default:
+            break;
+    }
+    for (const auto &child : node.children)
+        if (child) countBindings(*child, bindings);
+}
+
+// Dividing by zero traps, so the sandbox divides through fins that throw instead and the call is left
+// for the run, where it may never happen.
+static void checkDivisions(std::shared_ptr<ASTNode> &node) {
+    if (!node) return;
+    for (auto &child : node->children) checkDivisions(child);
+    if (node->type != ASTNode::Type::BINARY_OP || (node->binopValue != DIVIDE && node->binopValue != MODULUS)) return;
+
+    auto call = makeNode(ASTNode::Type::CALL, node->line);
+    call->children.push_back(makeNode(ASTNode::Type::IDENTIFIER, node->line,
+                                      Symbols::intern(node->binopValue == DIVIDE ? "0divide" : "0modulus")));
+    call->children.push_back(node->children[0]);
+    call->children.push_back(node->children[1]);
+    node = call;
+}
+
+static TypedValue checkedDivision(bool modulus) {
+    return {makeRef<Function>(Function{
+        [modulus](const std::vector<std::shared_ptr<TypedValue>> &args) {
+            int left = args[0]->get<int>(), right = args[1]->get<int>();
+            if (right == 0 || (right == -1 && left == INT_MIN)) throw std::runtime_error("Division overflow");
+            return std::make_shared<TypedValue>(modulus ? left % right : left / right);
+        }
+    })};
+}
+
+// Structs and fins have no literal, nor does an empty array, which would have no element type.
+static std::shared_ptr<ASTNode> literalOf(const TypedValue &value, uint32_t line) {
+    switch (value.kind()) {
+        case BaseType::Int: {
+            int32_t number = value.get<int>();
+            auto node = makeNode(ASTNode::Type::NUMBER, line, Symbols::intern(std::to_string(number)));
+            node->intValue = number;
+            return node;
+        }
+        case BaseType::Bool: {
+            bool flag = value.get<bool>();
+            auto node = makeNode(ASTNode::Type::BOOL, line, Symbols::intern(flag ? "1" : "0"));
+            node->intValue = flag;
+            return node;
+        }
+        case BaseType::String:
+            return makeNode(ASTNode::Type::STRING, line, Symbols::intern(value.str()));
+        case BaseType::Array: {
+            const auto &elements = value.point<Array>()->elements;
+            if (elements.empty()) return nullptr;
+            auto node = makeNode(ASTNode::Type::ARRAY_LITERAL, line);
+            for (const auto &element : elements) {
+                auto literal = literalOf(element, line);
+                if (!literal) return nullptr;
+                node->children.push_back(literal);
+            }
+            return node;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+void ConstEvaluator::evaluate(const std::shared_ptr<ASTNode> &root) {
+    for (const auto &pragma : root->children) {
+        std::unordered_map<Symbol, size_t> bindings;
+        countBindings(*pragma, bindings);
+        Module &module = addModule(modules, pragma, [&](Symbol alias) { return bindings[alias] == 1; });
+
+        for (size_t i = 2; i < pragma->children.size(); ++i) {
+            const auto &node = pragma->children[i];
+            if (node->type == ASTNode::Type::FUNCTION && node->constant && bindings[node->symbol] == 1 &&
+                node->strValue() != "main")
+                module.fins[node->symbol] = node;
+        }
+
+        for (size_t i = 2; i < pragma->children.size(); ++i) visit(pragma->children[i], module);
+    }
+}
+
+// Innermost first, so a call whose arguments are calls of const fins themselves is run with their values.
+void ConstEvaluator::visit(std::shared_ptr<ASTNode> &node, const Module &module) {
+    if (!node) return;
+    for (auto &child : node->children) visit(child, module);
+
+    std::shared_ptr<ASTNode> value;
+    if (node->type == ASTNode::Type::CALL) value = call(*node, module);
+    else if (node->type == ASTNode::Type::NDARRAY_ASSIGN) value = table(*node, module);
+    if (value) node = value;
+}
+
+// The const fin callee names, either in this module or exported by one it imports, and that module.
+std::pair<const ASTNode *, const ConstEvaluator::Module *> ConstEvaluator::resolve(const ASTNode &callee, const Module &module) const {
+    const Module *home = &module;
+    Symbol name = callee.symbol;
+    if (callee.type == ASTNode::Type::READ && callee.children[0]->type == ASTNode::Type::IDENTIFIER) {
+        auto alias = module.aliases.find(callee.children[0]->symbol);
+        if (alias == module.aliases.end()) return {};
+        home = alias->second;
+        name = callee.children[1]->symbol;
+
+        const auto &exports = home->pragma->children[1]->children;
+        if (std::none_of(exports.begin(), exports.end(), [&](const auto &node) { return node->symbol == name; })) return {};
+    } else if (callee.type != ASTNode::Type::IDENTIFIER) {
+        return {};
+    }
+
+    auto it = home->fins.find(name);
+    if (it == home->fins.end()) return {};
+    return {it->second.get(), home};
+}
+
+std::shared_ptr<ASTNode> ConstEvaluator::call(const ASTNode &call, const Module &module) {
+    auto [function, home] = resolve(*call.children[0], module);
+    // only an int, bool or string has a literal to take the call's place
+    if (!function || function->primitiveValue == Primitive::NONE) return nullptr;
+
+    std::string key = home->pragma->strValue() + "\n" + function->strValue();
+    for (size_t i = 1; i < call.children.size(); ++i) {
+        if (!isLiteral(*call.children[i])) return nullptr;
+        key += "\n" + astToString(call.children[i], 0);
+    }
+
+    auto it = results.find(key);
+    if (it == results.end()) {
+        auto callNode = makeNode(ASTNode::Type::CALL, call.line);
+        callNode->children.push_back(makeNode(ASTNode::Type::IDENTIFIER, call.line, function->symbol));
+        for (size_t i = 1; i < call.children.size(); ++i) callNode->children.push_back(call.children[i]->clone());
+
+        // a name no source can write
+        auto statement = makeNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT, call.line, Symbols::intern("0const"));
+        statement->primitiveValue = function->primitiveValue;
+        statement->children.push_back(callNode);
+        it = results.emplace(key, run(*home, statement)).first;
+    }
+    if (!it->second) return nullptr;
+
+    auto value = it->second->clone();
+    value->line = call.line;
+    return value;
+}
+
+// Initializers that only call const fins of this module on literals and `@` give the same array every
+// time, which is declared as an array literal instead.
+std::shared_ptr<ASTNode> ConstEvaluator::table(const ASTNode &ndarray, const Module &module) {
+    // children[0] is the kind of initializer, the shape follows
+    for (size_t i = 0; i + 1 < ndarray.children.size(); ++i)
+        if (ndarray.children[i]->type != ASTNode::Type::NUMBER) return nullptr;
+
+    bool calls = false;
+    if (!constant(*ndarray.children.back(), module, calls) || !calls) return nullptr;
+
+    auto array = run(module, ndarray.clone());
+    if (!array || array->type != ASTNode::Type::ARRAY_LITERAL) return nullptr;
+    for (const auto &element : array->children)
+        if (element->type != ASTNode::Type::NUMBER) return nullptr;
+
+    auto declaration = makeNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT, ndarray.line, ndarray.symbol);
+    declaration->primitiveValue = Primitive::INT;
+    declaration->children.push_back(array);
+    return declaration;
+}
+
+bool ConstEvaluator::constant(const ASTNode &expr, const Module &module, bool &calls) const {
+    switch (expr.type) {
+        case ASTNode::Type::NUMBER:
+        case ASTNode::Type::BOOL:
+        case ASTNode::Type::STRING:
+            return true;
+        case ASTNode::Type::CALL:
+            if (expr.children[0]->type != ASTNode::Type::IDENTIFIER || !module.fins.contains(expr.children[0]->symbol))
+                return false;
+            calls = true;
+            for (size_t i = 1; i < expr.children.size(); ++i)
+                if (!constant(*expr.children[i], module, calls)) return false;
+            return true;
+        case ASTNode::Type::SELF_REFERENCE:
+        case ASTNode::Type::BINARY_OP:
+        case ASTNode::Type::UNARY_OP:
+        case ASTNode::Type::ARRAY_ACCESS:
+        case ASTNode::Type::ARRAY_LITERAL:
+        case ASTNode::Type::BLOCK:
+        case ASTNode::Type::RANGE:
+            for (const auto &child : expr.children)
+                if (!constant(*child, module, calls)) return false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Runs statement after the structs and const fins of module, and gives the value it declares as a
+// literal, or null when it fails or has none.
+std::shared_ptr<ASTNode> ConstEvaluator::run(const Module &module, const std::shared_ptr<ASTNode> &statement) {
+    auto pragma = makeNode(ASTNode::Type::PRAGMA, statement->line, module.pragma->symbol);
+    pragma->children.push_back(makeNode(ASTNode::Type::IMPORT_BLOCK, 0));
+    pragma->children.push_back(makeNode(ASTNode::Type::IMPORT_BLOCK, 0));
+    for (size_t i = 2; i < module.pragma->children.size(); ++i) {
+        const auto &node = module.pragma->children[i];
+        if (node->type == ASTNode::Type::STRUCT_DECLARE || (node->type == ASTNode::Type::FUNCTION && node->constant))
+            pragma->children.push_back(node->clone());
+    }
+    pragma->children.push_back(statement);
+    checkDivisions(pragma);
+
+    auto program = makeNode(ASTNode::Type::PROGRAM, 0);
+    program->children.push_back(pragma);
+
+    try {
+        Executor executor(program);
+        executor.limit(STEP_LIMIT, DEPTH_LIMIT);
+        executor.define(Symbols::intern("0divide"), checkedDivision(false));
+        executor.define(Symbols::intern("0modulus"), checkedDivision(true));
+        executor.run();
+        return literalOf(executor.global(statement->symbol), statement->line);
+    } catch (const std::exception &) {
+        return nullptr;
+    }
+}
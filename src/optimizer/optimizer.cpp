@@ -0,0 +1,604 @@
+#include "optimizer.hpp"
+#include "optimizerutils.hpp"
+#include "parserutils.hpp"
+#include "treeshaker.hpp"
+#include "typechecker.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr size_t INLINE_MAX_NODES = 24; // in the expression a fin returns
+
+static std::shared_ptr<ASTNode> makeNumber(int32_t value, uint32_t line) {
+    auto node = makeNode(ASTNode::Type::NUMBER, line, Symbols::intern(std::to_string(value)));
+    node->intValue = value;
+    return node;
+}
+
+static std::shared_ptr<ASTNode> makeBool(bool value, uint32_t line) {
+    auto node = makeNode(ASTNode::Type::BOOL, line, Symbols::intern(value ? "1" : "0"));
+    node->intValue = value;
+    return node;
+}
+
+static std::shared_ptr<ASTNode> makeString(const std::string &value, uint32_t line) {
+    return makeNode(ASTNode::Type::STRING, line, Symbols::intern(value));
+}
+
+void Optimizer::optimize(const std::shared_ptr<ASTNode> &root) {
+    if (level < 1) return;
+
+    // children[0] and [1] of a PRAGMA are the import and export lists
+    for (auto &pragma : root->children) statements(pragma->children, 2, false);
+    if (level < 2) return;
+
+    // only calls the checker proved are inlined, a program it rejects is left for it to report
+    TypeChecker checker;
+    bool checked = checker.check(root).empty();
+    if (checked) {
+        for (auto &pragma : root->children)
+            for (size_t i = 2; i < pragma->children.size(); ++i) inlineCalls(pragma->children[i], checker);
+
+        // loops are rewritten with the types of what inlining left
+        TypeChecker inlinedChecker;
+        if (inlinedChecker.check(root).empty()) {
+            collectDeclared(*root);
+            for (auto &pragma : root->children)
+                for (size_t i = 2; i < pragma->children.size(); ++i) hoistLoops(pragma->children[i], inlinedChecker);
+        }
+    }
+
+    for (auto &pragma : root->children) {
+        uses.clear();
+        uses[Symbols::intern("main")]++; // looked up by name once the main module has run
+        for (const auto &name : pragma->children[1]->children) uses[name->symbol]++;
+        countUses(pragma);
+        dropUnusedIn(pragma);
+    }
+
+    // what the checker rejects is reported, even in fins nothing calls
+    if (checked) TreeShaker().shake(root);
+}
+
+void Optimizer::visit(std::shared_ptr<ASTNode> &node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case ASTNode::Type::BLOCK: statements(node->children, 0, true); break;
+        case ASTNode::Type::BINARY_OP:
+            visit(node->children[0]);
+            visit(node->children[1]);
+            foldBinaryOp(node);
+            break;
+        case ASTNode::Type::UNARY_OP:
+            visit(node->children[0]);
+            foldUnaryOp(node);
+            break;
+        case ASTNode::Type::IF_STATEMENT: {
+            for (auto &child : node->children) keep(child);
+            if (node->children[0]->type != ASTNode::Type::BOOL) break;
+
+            // an arm that is not a block runs in the enclosing scope already, so it can take the if's place
+            std::shared_ptr<ASTNode> arm;
+            if (node->children[0]->intValue) arm = node->children[1];
+            else if (node->children.size() > 2 && node->children[2]->type == ASTNode::Type::ELSE_STATEMENT)
+                arm = node->children[2]->children[0];
+            node = arm;
+            break;
+        }
+        case ASTNode::Type::WHILE_STATEMENT:
+            for (auto &child : node->children) keep(child);
+            if (node->children[0]->type == ASTNode::Type::BOOL && !node->children[0]->intValue) node = nullptr;
+            break;
+        default:
+            for (auto &child : node->children) keep(child);
+            break;
+    }
+}
+
+// Statement lists drop what can never run, anywhere else a statement that folded away leaves an empty
+// block in its place.
+void Optimizer::keep(std::shared_ptr<ASTNode> &node) {
+    if (!node) return;
+    uint32_t line = node->line;
+    visit(node);
+    if (!node) node = makeNode(ASTNode::Type::BLOCK, line);
+}
+
+void Optimizer::statements(ASTChildren &list, size_t from, bool block) {
+    size_t kept = from;
+    for (size_t i = from; i < list.size(); ++i) {
+        auto statement = list[i];
+        visit(statement);
+        if (!statement) continue;
+        list[kept++] = statement;
+        // a module keeps running its top level after a return, a block does not
+        if (block && statement->type == ASTNode::Type::RETURN_STATEMENT) break;
+    }
+    list.erase(list.begin() + kept, list.end());
+}
+
+// Only int operands are folded, and strings joined with a literal, matching Executor::evaluateBinaryOp.
+void Optimizer::foldBinaryOp(std::shared_ptr<ASTNode> &node) {
+    const ASTNode &lhs = *node->children[0];
+    const ASTNode &rhs = *node->children[1];
+    BinaryOp op = node->binopValue;
+
+    if (lhs.type == ASTNode::Type::STRING && op == PLUS) {
+        std::string text = lhs.strValue();
+        switch (rhs.type) {
+            case ASTNode::Type::STRING: text += rhs.strValue(); break;
+            case ASTNode::Type::NUMBER: text += std::to_string(rhs.intValue); break;
+            case ASTNode::Type::BOOL: text += rhs.intValue ? "true" : "false"; break;
+            default: return;
+        }
+        node = makeString(text, node->line);
+        return;
+    }
+
+    if (lhs.type != ASTNode::Type::NUMBER || rhs.type != ASTNode::Type::NUMBER) return;
+    int64_t left = lhs.intValue;
+    int64_t right = rhs.intValue;
+    int64_t value;
+    switch (op) {
+        case PLUS:     value = left + right; break;
+        case MINUS:    value = left - right; break;
+        case MULTIPLY: value = left * right; break;
+        case DIVIDE:
+        case MODULUS:
+            // left to trap while running
+            if (right == 0 || (left == INT32_MIN && right == -1)) return;
+            value = op == DIVIDE ? left / right : left % right;
+            break;
+        case COMPARISON:    node = makeBool(left == right, node->line); return;
+        case LESS:          node = makeBool(left < right, node->line); return;
+        case GREATER:       node = makeBool(left > right, node->line); return;
+        case LESS_EQUAL:    node = makeBool(left <= right, node->line); return;
+        case GREATER_EQUAL: node = makeBool(left >= right, node->line); return;
+        default: return;
+    }
+    if (value < INT32_MIN || value > INT32_MAX) return;
+    node = makeNumber(static_cast<int32_t>(value), node->line);
+}
+
+void Optimizer::foldUnaryOp(std::shared_ptr<ASTNode> &node) {
+    const ASTNode &operand = *node->children[0];
+    if (operand.type != ASTNode::Type::NUMBER) return;
+
+    switch (node->binopValue) {
+        case MINUS:
+            if (operand.intValue == INT32_MIN) return;
+            node = makeNumber(-operand.intValue, node->line);
+            break;
+        case BITWISE_NOT: node = makeNumber(~operand.intValue, node->line); break;
+        case NOT: node = makeBool(!operand.intValue, node->line); break;
+        default: break;
+    }
+}
+
+static const ASTNode *returnedExpression(const ASTNode &function) {
+    const ASTNode *body = function.children.back().get();
+    if (body->type == ASTNode::Type::BLOCK && body->children.size() == 1) body = body->children[0].get();
+    if (body->type != ASTNode::Type::RETURN_STATEMENT || body->children.size() != 1) return nullptr;
+    return body->children[0].get();
+}
+
+static size_t countNodes(const ASTNode &node) {
+    size_t count = 1;
+    for (const auto &child : node.children) count += countNodes(*child);
+    return count;
+}
+
+// Reads that are the same wherever and however often they are evaluated.
+static bool isSimple(const ASTNode &node) {
+    switch (node.type) {
+        case ASTNode::Type::NUMBER:
+        case ASTNode::Type::BOOL:
+        case ASTNode::Type::STRING:
+        case ASTNode::Type::IDENTIFIER:
+            return true;
+        case ASTNode::Type::SELF_REFERENCE:
+            return node.children.empty();
+        case ASTNode::Type::READ:
+            return isSimple(*node.children[0]);
+        case ASTNode::Type::ARRAY_ACCESS:
+            for (const auto &index : node.children[1]->children)
+                if (index->type != ASTNode::Type::NUMBER && index->type != ASTNode::Type::IDENTIFIER) return false;
+            return isSimple(*node.children[0]);
+        default:
+            return false;
+    }
+}
+
+// Expressions without effects, evaluating them later or not at all only changes which error is reported.
+static bool isPure(const ASTNode &node) {
+    switch (node.type) {
+        case ASTNode::Type::BINARY_OP:
+        case ASTNode::Type::UNARY_OP:
+            break;
+        case ASTNode::Type::READ:
+            return isPure(*node.children[0]);
+        case ASTNode::Type::ARRAY_ACCESS:
+            for (const auto &index : node.children[1]->children)
+                if (index->type == ASTNode::Type::RANGE || !isPure(*index)) return false;
+            return isPure(*node.children[0]);
+        default:
+            return isSimple(node);
+    }
+    for (const auto &child : node.children)
+        if (!isPure(*child)) return false;
+    return true;
+}
+
+static int parameterIndex(const ASTNode &node, const ASTNode &function) {
+    if (node.type != ASTNode::Type::IDENTIFIER) return -1;
+    for (size_t i = 0; i + 1 < function.children.size(); ++i)
+        if (function.children[i]->symbol == node.symbol) return static_cast<int>(i);
+    return -1;
+}
+
+static void countParameters(const ASTNode &node, const ASTNode &function, std::vector<size_t> &counts) {
+    if (int index = parameterIndex(node, function); index >= 0) counts[index]++;
+    // the right of a READ names a field
+    size_t end = node.type == ASTNode::Type::READ ? 1 : node.children.size();
+    for (size_t i = 0; i < end; ++i) countParameters(*node.children[i], function, counts);
+}
+
+// A copy of expr with each parameter replaced by its argument, on the line of the call it replaces.
+static std::shared_ptr<ASTNode> substitute(const ASTNode &node, const ASTNode &function, const ASTNode &call) {
+    if (int index = parameterIndex(node, function); index >= 0) return call.children[index + 1]->clone();
+
+    auto copy = makeNode(node.type, call.line);
+    copy->binopValue = node.binopValue;
+    copy->primitiveValue = node.primitiveValue;
+    copy->symbol = node.symbol;
+    copy->intValue = node.intValue;
+    for (size_t i = 0; i < node.children.size(); ++i) {
+        bool field = node.type == ASTNode::Type::READ && i == 1;
+        copy->children.push_back(field ? node.children[i]->clone() : substitute(*node.children[i], function, call));
+    }
+    return copy;
+}
+
+// Calls are inlined innermost first, an argument is final before it is substituted. What a call is
+// replaced with is only folded, it holds no calls of the callee's own.
+void Optimizer::inlineCalls(std::shared_ptr<ASTNode> &node, const TypeChecker &checker) {
+    if (!node) return;
+    for (auto &child : node->children) inlineCalls(child, checker);
+    if (node->type != ASTNode::Type::CALL || !node->typeChecked) return;
+
+    const ASTNode *function = checker.callee(*node);
+    if (!function) return;
+    if (auto expr = inlined(*node, *function, checker)) {
+        node = expr;
+        visit(node);
+    }
+}
+
+// The callee must be small, return a single expression the checker can type from its parameters
+// alone, and so never call anything. Arguments are evaluated where the parameter is used instead of
+// before the call, so only ones without effects may move, be copied or dropped.
+std::shared_ptr<ASTNode> Optimizer::inlined(const ASTNode &call, const ASTNode &function, const TypeChecker &checker) {
+    const ASTNode *expr = returnedExpression(function);
+    if (!expr || countNodes(*expr) > INLINE_MAX_NODES || !checker.returnsDeclaredType(function, *expr)) return nullptr;
+
+    size_t paramCount = function.children.size() - 1;
+    if (call.children.size() - 1 != paramCount) return nullptr;
+
+    std::vector<size_t> counts(paramCount);
+    countParameters(*expr, function, counts);
+
+    size_t effects = 0, literals = 0;
+    for (size_t i = 0; i < paramCount; ++i) {
+        const ASTNode &arg = *call.children[i + 1];
+        if (arg.type == ASTNode::Type::RANGE) return nullptr;
+        bool literal = arg.type == ASTNode::Type::NUMBER || arg.type == ASTNode::Type::BOOL || arg.type == ASTNode::Type::STRING;
+        literals += literal;
+        if (counts[i] == 0 && !literal && arg.type != ASTNode::Type::IDENTIFIER) return nullptr;
+        if (counts[i] > 1 && !isSimple(arg)) return nullptr;
+        if (!isPure(arg)) {
+            if (counts[i] != 1) return nullptr;
+            effects++;
+        }
+    }
+    // an argument with effects may not move past the reads of the others
+    if (effects > 1 || (effects == 1 && literals + 1 < paramCount)) return nullptr;
+
+    return substitute(*expr, function, call);
+}
+
+static bool same(const ASTNode &a, const ASTNode &b) {
+    if (a.type != b.type || a.symbol != b.symbol || a.binopValue != b.binopValue || a.intValue != b.intValue ||
+        a.children.size() != b.children.size())
+        return false;
+    for (size_t i = 0; i < a.children.size(); ++i)
+        if (!same(*a.children[i], *b.children[i])) return false;
+    return true;
+}
+
+// Loops are rewritten innermost first, so what an inner loop hoisted can move on out of the outer one.
+// The loop and its temporaries go in a block of their own.
+void Optimizer::hoistLoops(std::shared_ptr<ASTNode> &node, const TypeChecker &checker) {
+    if (!node) return;
+    for (auto &child : node->children) hoistLoops(child, checker);
+
+    // the parts run on every iteration, a classic for's init and an enhanced for's iterable run once
+    size_t from;
+    switch (node->type) {
+        case ASTNode::Type::WHILE_STATEMENT:
+            // a body that is not a block declares in the enclosing scope
+            if (node->children[1]->type != ASTNode::Type::BLOCK) return;
+            from = 0;
+            break;
+        case ASTNode::Type::FOR_STATEMENT: from = node->strValue() == "0" ? 1 : 2; break;
+        default: return;
+    }
+
+    Effects effects = loopEffects(*node, checker);
+    if (effects.unknown) return;
+
+    ASTChildren temps;
+    for (size_t i = from; i < node->children.size(); ++i) hoist(node->children[i], effects, checker, temps);
+    if (temps.empty()) return;
+
+    auto block = makeNode(ASTNode::Type::BLOCK, node->line);
+    block->children = std::move(temps);
+    block->children.push_back(node);
+    node = block;
+}
+
+void Optimizer::hoist(std::shared_ptr<ASTNode> &node, const Effects &effects, const TypeChecker &checker, ASTChildren &temps) {
+    if (!node) return;
+    size_t from = 0, end = node->children.size();
+    switch (node->type) {
+        case ASTNode::Type::FUNCTION: return; // runs in a frame of its own
+        case ASTNode::Type::BINARY_OP:
+        case ASTNode::Type::UNARY_OP:
+        case ASTNode::Type::READ: {
+            auto type = checker.expressionType(*node);
+            Primitive primitive = Primitive::NONE;
+            if (type) {
+                switch (type->kind()) {
+                    case BaseType::Int: primitive = Primitive::INT; break;
+                    case BaseType::Bool: primitive = Primitive::BOOL; break;
+                    case BaseType::String: primitive = Primitive::STRING; break;
+                    default: break;
+                }
+            }
+            if (primitive != Primitive::NONE && invariant(*node, effects, checker)) {
+                node = temporary(node, primitive, temps);
+                return;
+            }
+            if (node->type == ASTNode::Type::READ) end = 1; // the field name
+            break;
+        }
+        case ASTNode::Type::ARRAY_ASSIGN: from = 1; break; // the target stays as written
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT:
+            if (end > 1 && node->children[0]->type == ASTNode::Type::READ) from = 1;
+            break;
+        default: break;
+    }
+    for (size_t i = from; i < end; ++i) hoist(node->children[i], effects, checker, temps);
+}
+
+// Whether expr has the same value on every iteration of a loop with the given effects, and can neither
+// fail nor have effects of its own, so evaluating it once before the loop, even one that never runs,
+// changes nothing.
+bool Optimizer::invariant(const ASTNode &expr, const Effects &effects, const TypeChecker &checker) const {
+    auto type = checker.expressionType(expr);
+    if (!type) return false;
+
+    switch (expr.type) {
+        case ASTNode::Type::NUMBER:
+        case ASTNode::Type::BOOL:
+        case ASTNode::Type::STRING:
+            return true;
+        case ASTNode::Type::IDENTIFIER:
+            return !effects.names.contains(expr.symbol);
+        case ASTNode::Type::UNARY_OP: {
+            auto operand = checker.expressionType(*expr.children[0]);
+            return operand && operand->kind() == BaseType::Int && invariant(*expr.children[0], effects, checker);
+        }
+        case ASTNode::Type::BINARY_OP: {
+            const ASTNode &lhs = *expr.children[0];
+            const ASTNode &rhs = *expr.children[1];
+            if (!invariant(lhs, effects, checker) || !invariant(rhs, effects, checker)) return false;
+            // a string repeated a huge number of times is left to a loop that runs
+            if (checker.expressionType(lhs)->kind() == BaseType::String) return expr.binopValue == PLUS;
+            switch (expr.binopValue) {
+                case DIVIDE:
+                case MODULUS:
+                    return rhs.type == ASTNode::Type::NUMBER && rhs.intValue != 0 && rhs.intValue != -1;
+                default:
+                    return binaryResultType(expr.binopValue, StaticType::Int) != StaticType::Unknown;
+            }
+        }
+        case ASTNode::Type::READ: {
+            const ASTNode &target = *expr.children[0];
+            if (!invariant(target, effects, checker)) return false;
+            // arrays never change length
+            if (checker.expressionType(target)->kind() == BaseType::Array) return true;
+            return !effects.memory;
+        }
+        default:
+            return false;
+    }
+}
+
+// The same expression hoisted twice shares its temporary. Temporaries are named so that no source
+// can name them.
+std::shared_ptr<ASTNode> Optimizer::temporary(const std::shared_ptr<ASTNode> &expr, Primitive primitive, ASTChildren &temps) {
+    Symbol name = 0;
+    for (const auto &temp : temps)
+        if (same(*temp->children[0], *expr)) name = temp->symbol;
+
+    if (!name) {
+        auto temp = makeNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT, expr->line);
+        temp->symbol = name = Symbols::intern(std::to_string(temporaries++) + "invariant");
+        temp->primitiveValue = primitive;
+        temp->children.push_back(expr);
+        temps.push_back(temp);
+    }
+
+    auto identifier = makeNode(ASTNode::Type::IDENTIFIER, expr->line);
+    identifier->symbol = name;
+    return identifier;
+}
+
+Optimizer::Effects Optimizer::loopEffects(const ASTNode &loop, const TypeChecker &checker) {
+    Effects effects;
+    collectEffects(loop, effects, nullptr, checker);
+
+    std::unordered_set<const ASTNode *> seen;
+    std::vector<const ASTNode *> pending = effects.calls;
+    while (!pending.empty()) {
+        const ASTNode *function = pending.back();
+        pending.pop_back();
+        if (!seen.insert(function).second) continue;
+
+        const Effects &called = finEffects(*function, checker);
+        effects.names.insert(called.names.begin(), called.names.end());
+        effects.memory = effects.memory || called.memory;
+        effects.unknown = effects.unknown || called.unknown;
+        pending.insert(pending.end(), called.calls.begin(), called.calls.end());
+    }
+    return effects;
+}
+
+const Optimizer::Effects &Optimizer::finEffects(const ASTNode &function, const TypeChecker &checker) {
+    if (auto it = fins.find(&function); it != fins.end()) return it->second;
+
+    Effects effects;
+    Scopes scopes(1);
+    for (size_t i = 0; i + 1 < function.children.size(); ++i) scopes[0].insert(function.children[i]->symbol);
+    collectEffects(*function.children.back(), effects, &scopes, checker);
+    return fins.emplace(&function, std::move(effects)).first->second;
+}
+
+// The builtins of outstream only ever write to the output.
+static bool writesOutputOnly(const ASTNode &callee, const std::unordered_set<Symbol> &declared) {
+    static const Symbol names[] = {Symbols::intern("print"), Symbols::intern("println"), Symbols::intern("printf")};
+    if (callee.type != ASTNode::Type::IDENTIFIER || declared.contains(callee.symbol)) return false;
+    return std::find(std::begin(names), std::end(names), callee.symbol) != std::end(names);
+}
+
+// Without scopes every name declared is collected too: a loop declares its locals anew on each
+// iteration.
+void Optimizer::collectEffects(const ASTNode &node, Effects &effects, Scopes *scopes, const TypeChecker &checker) const {
+    auto declare = [&](Symbol name) {
+        if (scopes) scopes->back().insert(name);
+        else effects.names.insert(name);
+    };
+    auto local = [&](Symbol name) {
+        if (scopes)
+            for (const auto &scope : *scopes)
+                if (scope.contains(name)) return true;
+        return false;
+    };
+    auto children = [&] {
+        for (const auto &child : node.children)
+            if (child) collectEffects(*child, effects, scopes, checker);
+    };
+
+    switch (node.type) {
+        case ASTNode::Type::FUNCTION:
+        case ASTNode::Type::NATIVE_STATEMENT:
+            // a fin's body only runs when it is called
+            declare(node.symbol);
+            break;
+        case ASTNode::Type::BLOCK:
+        case ASTNode::Type::FOR_STATEMENT:
+            if (scopes) scopes->emplace_back();
+            children();
+            if (scopes) scopes->pop_back();
+            break;
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT:
+            children();
+            if (node.children.size() > 1 && node.children[0]->type == ASTNode::Type::READ) effects.memory = true;
+            else if (node.primitiveValue != Primitive::NONE) declare(node.symbol);
+            else if (!local(node.symbol)) effects.names.insert(node.symbol);
+            break;
+        case ASTNode::Type::STRUCT_ASSIGNMENT:
+        case ASTNode::Type::NDARRAY_ASSIGN:
+            children();
+            declare(node.symbol);
+            break;
+        case ASTNode::Type::ARRAY_ASSIGN:
+            children();
+            effects.memory = true;
+            break;
+        case ASTNode::Type::CALL:
+            children();
+            if (const ASTNode *function = checker.callee(node)) effects.calls.push_back(function);
+            else if (!writesOutputOnly(*node.children[0], declared)) effects.unknown = true;
+            break;
+        default:
+            children();
+            break;
+    }
+}
+
+void Optimizer::collectDeclared(const ASTNode &node) {
+    switch (node.type) {
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT:
+            if (node.primitiveValue != Primitive::NONE) declared.insert(node.symbol);
+            break;
+        case ASTNode::Type::FUNCTION:
+            for (size_t i = 0; i + 1 < node.children.size(); ++i) declared.insert(node.children[i]->symbol);
+            [[fallthrough]];
+        case ASTNode::Type::STRUCT_ASSIGNMENT:
+        case ASTNode::Type::NDARRAY_ASSIGN:
+        case ASTNode::Type::NATIVE_STATEMENT:
+            declared.insert(node.symbol);
+            break;
+        case ASTNode::Type::IMPORT_BLOCK:
+            for (const auto &import : node.children)
+                if (!import->children.empty()) declared.insert(import->children[0]->symbol);
+            break;
+        default:
+            break;
+    }
+    for (const auto &child : node.children)
+        if (child) collectDeclared(*child);
+}
+
+// Every name the module reads or assigns, whatever scope it is in, so shadowing only ever keeps more.
+void Optimizer::countUses(const std::shared_ptr<ASTNode> &node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case ASTNode::Type::IDENTIFIER:
+        case ASTNode::Type::NDARRAY_ASSIGN:
+            uses[node->symbol]++;
+            break;
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT:
+            if (node->primitiveValue == Primitive::NONE) uses[node->symbol]++;
+            break;
+        default:
+            break;
+    }
+    for (const auto &child : node->children) countUses(child);
+}
+
+// A declaration of a literal cannot fail or have effects, so one whose name is never used can go.
+void Optimizer::dropUnused(ASTChildren &list, size_t from) {
+    size_t kept = from;
+    for (size_t i = from; i < list.size(); ++i) {
+        const auto &node = list[i];
+        bool unused = node->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT && node->primitiveValue != Primitive::NONE &&
+                      !uses.contains(node->symbol) &&
+                      (node->children.empty() ||
+                       (node->children.size() == 1 && isLiteralOf(*node->children[0], node->primitiveValue)));
+        if (!unused) list[kept++] = node;
+    }
+    list.erase(list.begin() + kept, list.end());
+}
+
+void Optimizer::dropUnusedIn(const std::shared_ptr<ASTNode> &node) {
+    if (!node) return;
+
+    if (node->type == ASTNode::Type::PRAGMA) dropUnused(node->children, 2);
+    else if (node->type == ASTNode::Type::BLOCK) dropUnused(node->children, 0);
+    for (const auto &child : node->children) dropUnusedIn(child);
+}
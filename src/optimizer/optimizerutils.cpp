@@ -0,0 +1,37 @@
+#include "optimizerutils.hpp"
+
+bool isLiteral(const ASTNode &node) {
+    switch (node.type) {
+        case ASTNode::Type::NUMBER:
+        case ASTNode::Type::BOOL:
+        case ASTNode::Type::STRING:
+            return true;
+        case ASTNode::Type::UNARY_OP:
+            return node.binopValue == MINUS && node.children[0]->type == ASTNode::Type::NUMBER;
+        case ASTNode::Type::ARRAY_LITERAL:
+            // an empty one has no element type to declare
+            if (node.children.empty()) return false;
+            for (const auto &element : node.children)
+                if (!element || !isLiteral(*element)) return false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isLiteralOf(const ASTNode &node, Primitive primitive) {
+    if (!isLiteral(node)) return false;
+    switch (node.type) {
+        case ASTNode::Type::NUMBER:
+        case ASTNode::Type::UNARY_OP:
+            return primitive == Primitive::INT;
+        case ASTNode::Type::BOOL: return primitive == Primitive::BOOL;
+        case ASTNode::Type::STRING: return primitive == Primitive::STRING;
+        case ASTNode::Type::ARRAY_LITERAL:
+            for (const auto &element : node.children)
+                if (!isLiteralOf(*element, primitive)) return false;
+            return true;
+        default:
+            return false;
+    }
+}
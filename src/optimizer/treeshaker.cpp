@@ -0,0 +1,83 @@
+#include "treeshaker.hpp"
+
+// Defining these cannot fail or have effects, so one nothing reaches never has to run.
+static bool isDroppable(const ASTNode &node) {
+    switch (node.type) {
+        case ASTNode::Type::FUNCTION:
+        case ASTNode::Type::STRUCT_DECLARE:
+            return true;
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT:
+            return node.primitiveValue != Primitive::NONE &&
+                   (node.children.empty() || (node.children.size() == 1 && isLiteralOf(*node.children[0], node.primitiveValue)));
+        default:
+            return false;
+    }
+}
+
+void TreeShaker::shake(const std::shared_ptr<ASTNode> &root) {
+    for (const auto &pragma : root->children) {
+        Module &module = addModule(modules, pragma);
+        for (size_t i = 2; i < pragma->children.size(); ++i) {
+            const auto &node = pragma->children[i];
+            if (isDroppable(*node)) module.declarations[node->symbol].push_back(node.get());
+        }
+    }
+
+    for (auto &[file, module] : modules) {
+        const auto &children = module.pragma->children;
+        for (size_t i = 2; i < children.size(); ++i)
+            if (!isDroppable(*children[i])) pending.emplace_back(&module, children[i].get());
+    }
+
+    // the Executor looks main up by name, and checks the main module's exports exist
+    Module &main = modules[root->children.back()->strValue()];
+    reach(main, Symbols::intern("main"));
+    for (const auto &name : main.pragma->children[1]->children) reach(main, name->symbol);
+
+    while (!pending.empty()) {
+        auto [module, node] = pending.back();
+        pending.pop_back();
+        walk(*module, *node);
+    }
+
+    for (auto &[file, module] : modules) drop(module);
+}
+
+void TreeShaker::reach(Module &module, Symbol name) {
+    if (!module.live.insert(name).second) return;
+    auto it = module.declarations.find(name);
+    if (it == module.declarations.end()) return;
+    for (const ASTNode *declaration : it->second) pending.emplace_back(&module, declaration);
+}
+
+// Any name counts, a local or a field named like a declaration keeps it too.
+void TreeShaker::walk(Module &module, const ASTNode &node) {
+    if (node.type == ASTNode::Type::READ && node.children[0]->type == ASTNode::Type::IDENTIFIER) {
+        if (auto it = module.aliases.find(node.children[0]->symbol); it != module.aliases.end()) {
+            reach(*it->second, node.children[1]->symbol);
+            return;
+        }
+    }
+    if (node.type == ASTNode::Type::IDENTIFIER) {
+        if (auto it = module.aliases.find(node.symbol); it != module.aliases.end())
+            for (const auto &name : it->second->pragma->children[1]->children) reach(*it->second, name->symbol);
+    }
+
+    if (node.symbol) reach(module, node.symbol);
+    if (node.retSymbol) reach(module, node.retSymbol);
+    for (const auto &child : node.children)
+        if (child) walk(module, *child);
+}
+
+void TreeShaker::drop(Module &module) {
+    auto &children = module.pragma->children;
+    size_t kept = 2;
+    for (size_t i = 2; i < children.size(); ++i) {
+        const auto &node = children[i];
+        if (!isDroppable(*node) || module.live.contains(node->symbol)) children[kept++] = node;
+    }
+    children.erase(children.begin() + kept, children.end());
+
+    auto &exports = module.pragma->children[1]->children;
+    std::erase_if(exports, [&](const auto &name) { return !module.live.contains(name->symbol); });
+}
@@ -5,21 +5,25 @@
 #include <fstream>
 #include <sstream>
 #include <functional>
-
-const Token &Parser::peek(size_t n) const {
-    if (current + n >= tokens.size()) return tokens.back();
-    return tokens[current + n];
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+Token Parser::peek(size_t n) const {
+    return tokens.peek(n);
 }
 
-const Token &Parser::consume(int amount) {
-    if(amount == 1) {
-        if (current >= tokens.size()) return tokens.back();
-        return tokens[current++];
-    }
+Token Parser::consume(int amount) {
     for(int i=0;i<amount - 1;i++) {
-        consume();
+        tokens.consume();
     }
-    return consume();
+    Token token = tokens.consume();
+    parsingLine = token.lineIndex;
+    return token;
 }
 
 bool Parser::match(Token::Type type, int offset) {
@@ -37,7 +41,7 @@ Token Parser::expectMultiple(const std::vector<Token::Type> &types, const std::s
         if (match(t)) return consume();
     }
     error(err);
-    return tokens.back();
+    return peek();
 }
 
 Token Parser::expect(Token::Type type, const std::string &err, bool doConsume) {
@@ -51,68 +55,163 @@ void Parser::error(const std::string &msg) const {
     throw std::runtime_error(msg + " at " + fileName + ":" + std::to_string(peek().lineIndex) + ":" + std::to_string(peek().colIndex));
 }
 
-std::string readFileContents(const std::string &filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) throw std::runtime_error("Cannot open file: " + filename);
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+SourceFile readFileContents(const std::string &filename) {
+    auto file = SourceFile::open(filename);
+    if (!file) throw std::runtime_error("Cannot open file: " + filename);
+    return std::move(*file);
 }
 
-std::shared_ptr<ASTNode> Parser::parseWithPragma(const std::shared_ptr<ASTNode> &programNode,
-                                                 const std::string &currentFile,
-                                                 const std::vector<Token> &currentTokens) {
+std::shared_ptr<ASTNode> Parser::parsePragma() {
+    auto pragmaNode = makeNode(ASTNode::Type::PRAGMA);
+    pragmaNode->symbol = Symbols::intern(fileName);
 
-    saveParsedFile(currentFile);
+    importBlock = makeNode(ASTNode::Type::IMPORT_BLOCK);
+    pragmaNode->children.push_back(importBlock);
+    exportBlock = makeNode(ASTNode::Type::IMPORT_BLOCK);
+    pragmaNode->children.push_back(exportBlock);
 
-    auto pragmaNode = makeTypedNode(ASTNode::Type::PRAGMA, 1);
-    pragmaNode->strValue = currentFile;
+    while (!match(Token::Type::END_OF_FILE)) {
+        auto stmt = parseStatement(0);
+        if (stmt != nullptr) pragmaNode->children.push_back(stmt);
+    }
+    return pragmaNode;
+}
 
-    Parser tempParser(currentTokens, currentFile);
-    tempParser.parent = this;
+std::vector<std::string> Parser::importedFiles() const {
+    std::vector<std::string> files;
+    for (const auto &child : importBlock->children) {
+        if (child->type == ASTNode::Type::STRING && child->strValue().size() > 4 && child->strValue().ends_with(".lum"))
+            files.push_back(child->strValue());
+    }
+    return files;
+}
 
-    tempParser.importBlock = makeTypedNode(ASTNode::Type::IMPORT_BLOCK, 0);
-    pragmaNode->children.push_back(tempParser.importBlock);
-    tempParser.exportBlock = makeTypedNode(ASTNode::Type::IMPORT_BLOCK, 0);
-    pragmaNode->children.push_back(tempParser.exportBlock);
+namespace {
+
+// Parses each module of a program once, on a pool of worker threads that grows as imports are found,
+// so reading, lexing and parsing one module overlaps with the others. Every module is built in an
+// arena of its own, and a failed parse is kept to be rethrown in the order a sequential parse would
+// have hit it.
+class ModuleLoader {
+public:
+    struct Module {
+        std::shared_ptr<ASTNode> pragma;
+        std::vector<std::string> imports;
+        std::exception_ptr error;
+    };
+
+    // the main file is parsed by the caller, never again if a module imports it back
+    explicit ModuleLoader(const std::string &mainFile) { modules.try_emplace(mainFile); }
+
+    ~ModuleLoader() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        for (auto &worker : workers) worker.join();
+    }
 
-    while (!tempParser.match(Token::Type::END_OF_FILE)) {
-        auto stmt = tempParser.parseStatement(0);
-        if (stmt != nullptr) pragmaNode->children.push_back(stmt);
+    // Queues the files not claimed yet, each file is only ever parsed once.
+    void request(const std::vector<std::string> &files) {
+        std::lock_guard lock(mutex);
+        claim(files);
     }
 
-    for (const auto &child : tempParser.importBlock->children) {
-        if (child->type == ASTNode::Type::STRING &&
-            child->strValue.size() > 4 &&
-            child->strValue.substr(child->strValue.size() - 4) == ".lum") {
+    // Helps the workers until every module requested is parsed.
+    std::unordered_map<std::string, Module> &wait() {
+        work();
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return pending == 0; });
+        return modules;
+    }
 
-            const std::string &importFile = child->strValue;
-            if (!isFileParsed(importFile)) {
-                auto fileContents = readFileContents(importFile);
-                auto importedTokens = Lexer(fileContents).tokenize();
-                addPragma(programNode, importedTokens, importFile);
-            }
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> queue;
+    std::unordered_map<std::string, Module> modules; // every claimed file, filled in once parsed
+    size_t pending = 0; // claimed and not parsed yet
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void claim(const std::vector<std::string> &files) {
+        for (const auto &file : files) {
+            if (!modules.try_emplace(file).second) continue;
+            queue.push_back(file);
+            pending++;
+            if (workers.size() < std::max(1u, std::thread::hardware_concurrency()) - 1)
+                workers.emplace_back([this] { work(); });
         }
+        changed.notify_all();
     }
 
-    return pragmaNode;
-}
+    void work() {
+        std::unique_lock lock(mutex);
+        while (true) {
+            changed.wait(lock, [&] { return !queue.empty() || pending == 0 || stopping; });
+            if (queue.empty() || stopping) return;
+            std::string file = std::move(queue.front());
+            queue.pop_front();
+
+            lock.unlock();
+            Module module = parse(file);
+            lock.lock();
+
+            claim(module.imports);
+            modules[file] = std::move(module);
+            pending--;
+            changed.notify_all();
+        }
+    }
+
+    static Module parse(const std::string &file) {
+        ASTArena::Scope arena;
+        Module module;
+        try {
+            TokenStream tokens(readFileContents(file));
+            Parser parser(tokens, file);
+            module.pragma = parser.parsePragma();
+            module.imports = parser.importedFiles();
+        } catch (...) {
+            module.error = std::current_exception();
+        }
+        return module;
+    }
+};
+
+} // namespace
 
+// The PRAGMA nodes are added depth first, each module after the ones it imports, in the order a
+// sequential parse that followed every import as it finished a file would produce.
 std::shared_ptr<ASTNode> Parser::parseProgram() {
-    auto programNode = makeTypedNode(ASTNode::Type::PROGRAM, 67);
-    addPragma(programNode, tokens, fileName);
+    ASTArena::Scope arena;
+    auto programNode = makeNode(ASTNode::Type::PROGRAM);
+
+    ModuleLoader loader(fileName);
+    auto mainPragma = parsePragma();
+    auto mainImports = importedFiles();
+    loader.request(mainImports);
+    auto &modules = loader.wait();
+
+    std::unordered_set<std::string> added{fileName};
+    std::function<void(const std::vector<std::string> &)> addImports = [&](const std::vector<std::string> &files) {
+        for (const auto &file : files) {
+            if (!added.insert(file).second) continue;
+            const auto &module = modules.at(file);
+            if (module.error) std::rethrow_exception(module.error);
+            addImports(module.imports);
+            programNode->children.push_back(module.pragma);
+        }
+    };
+    addImports(mainImports);
+    programNode->children.push_back(mainPragma);
     return programNode;
 }
 
-void Parser::addPragma(const std::shared_ptr<ASTNode> &programNode,
-                       const std::vector<Token> &newTokens,
-                       const std::string &newFileName) {
-    programNode->children.push_back(parseWithPragma(programNode, newFileName, newTokens));
-}
-
 std::shared_ptr<ASTNode> Parser::parseArrayLiteral() {
     expect(Token::Type::LBRACKET, "Expected '[' after array declaration", true);
-    auto node = makeTypedNode(ASTNode::Type::ARRAY_LITERAL, 1);
+    auto node = makeNode(ASTNode::Type::ARRAY_LITERAL);
     while (!match(Token::Type::RBRACKET)) {
         node->children.push_back(parseExpression());
         if (match(Token::Type::COMMA)) consume();
@@ -140,16 +239,16 @@ std::shared_ptr<ASTNode> Parser::parseOptionalArraySize(bool &isArray) {
 }
 
 std::shared_ptr<ASTNode> Parser::buildSizedArrayDeclareNode(const Token &typeToken, std::shared_ptr<ASTNode> sizeNode, bool isPrimitive) {
-    auto sad = makeTypedNode(ASTNode::Type::SIZED_ARRAY_DECLARE, 1);
+    auto sad = makeNode(ASTNode::Type::SIZED_ARRAY_DECLARE);
     if (isPrimitive) sad->primitiveValue = typeToken.primitiveValue;
-    sad->strValue = typeToken.value;
+    sad->symbol = Symbols::intern(typeToken.value);
     sad->children.push_back(sizeNode);
     return sad;
 }
 
 std::shared_ptr<ASTNode> Parser::buildTypeNodeFromToken(const Token &typeToken) {
-    auto typeNode = makeTypedNode(ASTNode::Type::IDENTIFIER, 1);
-    typeNode->strValue = typeToken.value;
+    auto typeNode = makeNode(ASTNode::Type::IDENTIFIER);
+    typeNode->symbol = Symbols::intern(typeToken.value);
     return typeNode;
 }
 
@@ -162,8 +261,8 @@ std::shared_ptr<ASTNode> Parser::parseDeclarationWithTypeAndName(
     bool skipSemicolon
 ) {
     ASTNode::Type nodeType = isPrimitive ? ASTNode::Type::PRIMITIVE_ASSIGNMENT : ASTNode::Type::STRUCT_ASSIGNMENT;
-    auto node = makeTypedNode(nodeType, 1);
-    node->strValue = nameToken.value;
+    auto node = makeNode(nodeType);
+    node->symbol = Symbols::intern(nameToken.value);
 
     if (!isPrimitive) {
         node->children.push_back(buildTypeNodeFromToken(typeToken));
@@ -201,9 +300,9 @@ std::shared_ptr<ASTNode> Parser::parseStatement(int depth, bool dataBit) {
             if(match(Token::Type::EQUAL, 1)) {
                 auto nameTok = consume();
                 consume();
-                auto node = makeTypedNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT, 1);
+                auto node = makeNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT);
                 auto value = parseExpression();
-                node->strValue = nameTok.value;
+                node->symbol = Symbols::intern(nameTok.value);
                 node->children.push_back(value);
                 expect(Token::Type::SEMICOLON, "Expected ';' after assignment", true);
                 return node;
@@ -238,10 +337,11 @@ std::shared_ptr<ASTNode> Parser::parseStatement(int depth, bool dataBit) {
                     initNode = parseExpression();
                 }
 
-                auto node = makeTypedNode(ASTNode::Type::NDARRAY_ASSIGN, 1);
-                node->strValue = nameTok.value;
-                auto effNode = makeTypedNode(ASTNode::Type::NUMBER, 1);
-                effNode->strValue = std::to_string(selfRefLevel);
+                auto node = makeNode(ASTNode::Type::NDARRAY_ASSIGN);
+                node->symbol = Symbols::intern(nameTok.value);
+                auto effNode = makeNode(ASTNode::Type::NUMBER);
+                effNode->symbol = Symbols::intern(std::to_string(selfRefLevel));
+                effNode->intValue = selfRefLevel;
                 node->children.push_back(effNode);
                 for(auto &shape : ndarrayShape) {
                     node->children.push_back(shape);
@@ -262,16 +362,16 @@ std::shared_ptr<ASTNode> Parser::parseStatement(int depth, bool dataBit) {
 
                     expect(Token::Type::LBRACE, "Expected '{' after struct declaration", true);
 
-                    auto initNode = makeTypedNode(ASTNode::Type::STRUCT_ASSIGNMENT, 0);
-                    initNode->strValue = nameTok.value;
-                    auto type = makeTypedNode(ASTNode::Type::STRING, 1);
-                    type->strValue = typeTok.value;
+                    auto initNode = makeNode(ASTNode::Type::STRUCT_ASSIGNMENT);
+                    initNode->symbol = Symbols::intern(nameTok.value);
+                    auto type = makeNode(ASTNode::Type::STRING);
+                    type->symbol = Symbols::intern(typeTok.value);
                     initNode->children.push_back(type);
 
                     while (!match(Token::Type::RBRACE)) {
                         if(match(Token::Type::IDENTIFIER) && match(Token::Type::COLON, 1)) {
-                            auto assign = makeTypedNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT, 1);
-                            assign->strValue = consume().value; // variable name
+                            auto assign = makeNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT);
+                            assign->symbol = Symbols::intern(consume().value); // variable name
                             consume(); // :
                             assign->children.push_back(parseExpression()); // value
                             initNode->children.push_back(assign);
@@ -291,7 +391,7 @@ std::shared_ptr<ASTNode> Parser::parseStatement(int depth, bool dataBit) {
             break;
 
         case Token::Type::KEYWORD: {
-            const std::string kw = consume().value;
+            const std::string kw(consume().value);
 
             auto it = kwMap.find(kw);
             if (it == kwMap.end())
@@ -311,7 +411,7 @@ std::shared_ptr<ASTNode> Parser::parseStatement(int depth, bool dataBit) {
 
 std::shared_ptr<ASTNode> Parser::parseBlock(int depth) {
     expect(Token::Type::LBRACE, "Expected '{' at start of block", true);
-    auto node = makeTypedNode(ASTNode::Type::BLOCK, 0);
+    auto node = makeNode(ASTNode::Type::BLOCK);
     while (peek().type != Token::Type::RBRACE && peek().type != Token::Type::END_OF_FILE)
         node->children.push_back(parseStatement(depth+1));
     expect(Token::Type::RBRACE, "Expected '}' at end of block", true);
@@ -325,9 +425,12 @@ std::shared_ptr<ASTNode> Parser::parseExpression() {
 std::shared_ptr<ASTNode> Parser::parsePrimary() {
     const Token &tok = peek();
     if (tok.type == Token::Type::NUMBER) {
+        auto value = parseNumberLiteral(tok.value);
+        if (!value) error("Number literal out of range: " + std::string(tok.value));
         consume();
-        auto node = makeTypedNode(ASTNode::Type::NUMBER, 1);
-        node->strValue = tok.value;
+        auto node = makeNode(ASTNode::Type::NUMBER);
+        node->symbol = Symbols::intern(tok.value);
+        node->intValue = *value;
         return node;
     }
 
@@ -338,27 +441,28 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
     if(tok.type == Token::Type::KEYWORD) {
         if(tok.value == "true" || tok.value == "false") {
             consume();
-            auto node = makeTypedNode(ASTNode::Type::BOOL, 1);
-            node->strValue = tok.value == "true" ? "1" : "0";
+            auto node = makeNode(ASTNode::Type::BOOL);
+            node->symbol = Symbols::intern(tok.value == "true" ? "1" : "0");
+            node->intValue = tok.value == "true";
             return node;
         }
-        throw std::runtime_error("Unexpected keyword: " + tok.value);
+        throw std::runtime_error("Unexpected keyword: " + std::string(tok.value));
     }
 
     if (tok.type == Token::Type::SELF_REFERENCE) {
         consume();
-        std::shared_ptr<ASTNode> node = makeTypedNode(ASTNode::Type::SELF_REFERENCE, 0);
+        std::shared_ptr<ASTNode> node = makeNode(ASTNode::Type::SELF_REFERENCE);
 
         while (true) {
             if (match(Token::Type::LBRACKET)) {
                 consume();
-                auto indicesNode = makeTypedNode(ASTNode::Type::BLOCK, 0);
+                auto indicesNode = makeNode(ASTNode::Type::BLOCK);
                 while (true) {
                     auto start = parseExpression();
                     if (match(Token::Type::RANGE)) {
                         consume();
                         auto end = parseExpression();
-                        auto rangeNode = makeTypedNode(ASTNode::Type::RANGE, 0);
+                        auto rangeNode = makeNode(ASTNode::Type::RANGE);
                         rangeNode->children.push_back(start);
                         rangeNode->children.push_back(end);
                         indicesNode->children.push_back(rangeNode);
@@ -376,14 +480,14 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
                 if (match(Token::Type::EQUAL)) {
                     consume();
                     auto valueNode = (match(Token::Type::LBRACKET)) ? parseArrayLiteral() : parseExpression();
-                    auto assignNode = makeTypedNode(ASTNode::Type::ARRAY_ASSIGN, 0);
+                    auto assignNode = makeNode(ASTNode::Type::ARRAY_ASSIGN);
                     assignNode->children.push_back(node);
                     assignNode->children.push_back(indicesNode);
                     assignNode->children.push_back(valueNode);
                     return assignNode;
                 }
 
-                auto accessNode = makeTypedNode(ASTNode::Type::ARRAY_ACCESS, 0);
+                auto accessNode = makeNode(ASTNode::Type::ARRAY_ACCESS);
                 accessNode->children.push_back(node);
                 accessNode->children.push_back(indicesNode);
                 node = accessNode;
@@ -398,28 +502,38 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
 
     if (tok.type == Token::Type::STRING) {
         consume();
-        auto node = makeTypedNode(ASTNode::Type::STRING, 1);
-        node->strValue = tok.value;
+        auto node = makeNode(ASTNode::Type::STRING);
+        node->symbol = Symbols::intern(tok.value);
         return node;
     }
 
     if (tok.type == Token::Type::IDENTIFIER) {
         consume();
-        auto identNode = makeTypedNode(ASTNode::Type::IDENTIFIER, 1);
-        identNode->strValue = tok.value;
+
+        // plain reassignment inside an expression, e.g. the update clause of a for loop
+        if (match(Token::Type::EQUAL)) {
+            consume();
+            auto assignNode = makeNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT);
+            assignNode->symbol = Symbols::intern(tok.value);
+            assignNode->children.push_back(parseExpression());
+            return assignNode;
+        }
+
+        auto identNode = makeNode(ASTNode::Type::IDENTIFIER);
+        identNode->symbol = Symbols::intern(tok.value);
 
         std::shared_ptr<ASTNode> node = identNode;
 
         while (true) {
             if (match(Token::Type::LBRACKET)) {
                 consume();
-                auto indicesNode = makeTypedNode(ASTNode::Type::BLOCK, 0);
+                auto indicesNode = makeNode(ASTNode::Type::BLOCK);
                 while (true) {
                     auto start = parseExpression();
                     if (match(Token::Type::RANGE)) {
                         consume();
                         auto end = parseExpression();
-                        auto rangeNode = makeTypedNode(ASTNode::Type::RANGE, 0);
+                        auto rangeNode = makeNode(ASTNode::Type::RANGE);
                         rangeNode->children.push_back(start);
                         rangeNode->children.push_back(end);
                         indicesNode->children.push_back(rangeNode);
@@ -437,14 +551,14 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
                 if (match(Token::Type::EQUAL)) {
                     consume();
                     auto valueNode = (match(Token::Type::LBRACKET)) ? parseArrayLiteral() : parseExpression();
-                    auto assignNode = makeTypedNode(ASTNode::Type::ARRAY_ASSIGN, 0);
+                    auto assignNode = makeNode(ASTNode::Type::ARRAY_ASSIGN);
                     assignNode->children.push_back(node);
                     assignNode->children.push_back(indicesNode);
                     assignNode->children.push_back(valueNode);
                     return assignNode;
                 }
 
-                auto accessNode = makeTypedNode(ASTNode::Type::ARRAY_ACCESS, 0);
+                auto accessNode = makeNode(ASTNode::Type::ARRAY_ACCESS);
                 accessNode->children.push_back(node);
                 accessNode->children.push_back(indicesNode);
                 node = accessNode;
@@ -454,10 +568,10 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
                 auto leftNode = node;
 
                 while (true) {
-                    auto rightNode = makeTypedNode(ASTNode::Type::IDENTIFIER, 1);
-                    rightNode->strValue = expect(Token::Type::IDENTIFIER, "Expected identifier after '.'", true).value;
+                    auto rightNode = makeNode(ASTNode::Type::IDENTIFIER);
+                    rightNode->symbol = Symbols::intern(expect(Token::Type::IDENTIFIER, "Expected identifier after '.'", true).value);
 
-                    auto readNode = makeTypedNode(ASTNode::Type::READ, 0);
+                    auto readNode = makeNode(ASTNode::Type::READ);
                     readNode->children.push_back(leftNode);
                     readNode->children.push_back(rightNode);
                     leftNode = readNode;
@@ -470,7 +584,7 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
 
                 if (match(Token::Type::EQUAL)) {
                     consume();
-                    auto assignNode = makeTypedNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT, 0);
+                    auto assignNode = makeNode(ASTNode::Type::PRIMITIVE_ASSIGNMENT);
                     assignNode->children.push_back(node);
                     assignNode->children.push_back(parseExpression());
                     return assignNode;
@@ -478,7 +592,7 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
             }
             else if (match(Token::Type::LPAREN)) {
                 consume();
-                auto callNode = makeTypedNode(ASTNode::Type::CALL, 0);
+                auto callNode = makeNode(ASTNode::Type::CALL);
                 callNode->children.push_back(node);
 
                 while (peek().type != Token::Type::RPAREN) {
@@ -487,7 +601,7 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
                     if (match(Token::Type::RANGE)) {
                         consume();
                         auto val2 = parseExpression();
-                        auto rangeNode = makeTypedNode(ASTNode::Type::RANGE, 0);
+                        auto rangeNode = makeNode(ASTNode::Type::RANGE);
                         rangeNode->children.push_back(val1);
                         rangeNode->children.push_back(val2);
                         callNode->children.push_back(rangeNode);
@@ -516,13 +630,13 @@ std::shared_ptr<ASTNode> Parser::parsePrimary() {
 
     if (tok.type == Token::Type::MINUS || tok.type == Token::Type::NOT || tok.type == Token::Type::BITWISE_NOT) {
         consume();
-        auto node = makeTypedNode(ASTNode::Type::UNARY_OP, 0);
+        auto node = makeNode(ASTNode::Type::UNARY_OP);
         node->binopValue = tok.binopValue;
         node->children.push_back(parsePrimary());
         return node;
     }
 
-    error("Unexpected token in primary expression: " + tok.value);
+    error("Unexpected token in primary expression: " + std::string(tok.value));
     return nullptr;
 }
 
@@ -534,7 +648,7 @@ std::shared_ptr<ASTNode> Parser::parseBinaryOp(std::shared_ptr<ASTNode> left, in
         auto right = parsePrimary();
         const int nextPrec = getPrecedence(peek().type);
         if (prec < nextPrec) right = parseBinaryOp(right, prec + 1);
-        auto node = makeTypedNode(ASTNode::Type::BINARY_OP, 0);
+        auto node = makeNode(ASTNode::Type::BINARY_OP);
         node->binopValue = op.binopValue;
         node->children.push_back(left);
         node->children.push_back(right);
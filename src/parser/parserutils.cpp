@@ -1,5 +1,6 @@
 #include "parser.hpp"
 #include "parserutils.hpp"
+#include <charconv>
 
 int Parser::getPrecedence(Token::Type type) const {
     switch(type) {
@@ -68,7 +69,7 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
         {
             "native",
             [](Parser* p, int depth) {
-                if(!p->match(Token::Type::KEYWORD) || p->peek().value != "fin") {
+                if(!p->match(Token::Type::KEYWORD) || (p->peek().value != "fin" && p->peek().value != "const")) {
                     p->error("Expected 'fin' keyword after 'native'");
                 }
                 auto func = p->parseStatement(depth);
@@ -82,11 +83,21 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
                 return nativeNode;
             }
         },
+        {
+            "const",
+            [](Parser* p, int depth) {
+                if(!p->match(Token::Type::KEYWORD) || (p->peek().value != "fin" && p->peek().value != "const")) {
+                    p->error("Expected 'fin' keyword after 'const'");
+                }
+                auto func = p->parseStatement(depth);
+                func->constant = true;
+                return func;
+            }
+        },
         {
             "fin",
             [](Parser* p, int depth) {
                 auto node = makeNode(ASTNode::Type::FUNCTION);
-                node->valueType = 1;
 
                 Token first = p->peek();
                 Token second = p->peek(1);
@@ -97,23 +108,23 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
                 if (alt) {
                     Token t = p->consume();
                     Token name = p->consume();
-                    node->retType = t.value;
+                    node->retSymbol = Symbols::intern(t.value);
                     if (t.type == Token::Type::PRIMITIVE) node->primitiveValue = t.primitiveValue;
-                    node->strValue = name.value;
+                    node->symbol = Symbols::intern(name.value);
                 } else {
-                    node->strValue = p->expect(Token::Type::IDENTIFIER, "Expected identifier after 'fin'", true).value;
+                    node->symbol = Symbols::intern(p->expect(Token::Type::IDENTIFIER, "Expected identifier after 'fin'", true).value);
                 }
 
                 p->expect(Token::Type::LPAREN, "Expected '(' after function name", true);
 
                 while (p->match(Token::Type::IDENTIFIER) || p->match(Token::Type::PRIMITIVE)) {
                     auto param = makeNode(ASTNode::Type::STRING);
-                    std::shared_ptr<ASTNode> typeNode = makeTypedNode(ASTNode::Type::STRING, 1);
+                    std::shared_ptr<ASTNode> typeNode = makeNode(ASTNode::Type::STRING);
 
                     if (p->match(Token::Type::PRIMITIVE)) {
                         typeNode->primitiveValue = p->consume().primitiveValue;
                     } else {
-                        typeNode->strValue = p->consume().value;
+                        typeNode->symbol = Symbols::intern(p->consume().value);
                     }
                     param->children.push_back(typeNode);
 
@@ -125,7 +136,7 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
                         spread = true;
                     }
 
-                    param->strValue = p->expect(Token::Type::IDENTIFIER, "Expected identifier after parameter", true).value;
+                    param->symbol = Symbols::intern(p->expect(Token::Type::IDENTIFIER, "Expected identifier after parameter", true).value);
 
                     node->children.push_back(param);
 
@@ -150,7 +161,7 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
                         value = "nil";
                     }
 
-                    node->retType = value;
+                    node->retSymbol = Symbols::intern(value);
                     if (primitive != Primitive::NONE) node->primitiveValue = primitive;
                 }
 
@@ -181,16 +192,16 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
                     node->children.push_back(p->parseStatement(depth + 1, true));
                     p->consume(); // colon
                     auto name = p->expect(Token::Type::IDENTIFIER, "Expected identifier after enhanced for", true);
-                    auto array = makeTypedNode(ASTNode::Type::IDENTIFIER, 0);
-                    array->strValue = name.value;
+                    auto array = makeNode(ASTNode::Type::IDENTIFIER);
+                    array->symbol = Symbols::intern(name.value);
                     node->children.push_back(array);
-                    node->strValue = "1";
+                    node->symbol = Symbols::intern("1");
                 } else {
                     node->children.push_back(p->parseStatement(depth + 1));
                     node->children.push_back(p->parseExpression());
                     p->expect(Token::Type::SEMICOLON, "Expected ';' after for loop condition", true);
                     node->children.push_back(p->parseExpression());
-                    node->strValue = "0";
+                    node->symbol = Symbols::intern("0");
                 }
                 p->expect(Token::Type::RPAREN, "Expected ')' after for loop innards", true);
                 node->children.push_back(p->parseStatement(depth + 1));
@@ -201,8 +212,7 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
             "struct",
             [](Parser* p, int depth) {
                 auto node = makeNode(ASTNode::Type::STRUCT_DECLARE);
-                node->valueType = 1;
-                node->strValue = p->expect(Token::Type::IDENTIFIER, "Expected struct name", true).value;
+                node->symbol = Symbols::intern(p->expect(Token::Type::IDENTIFIER, "Expected struct name", true).value);
 
                 p->expect(Token::Type::LBRACE, "Expected '{' after struct declaration", true);
                 while (p->peek().type != Token::Type::RBRACE && p->peek().type != Token::Type::END_OF_FILE) {
@@ -223,16 +233,15 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
                     p->error("Import statements are only allowed at top-level");
 
                 auto node = makeNode(ASTNode::Type::STRING);
-                node->valueType = 1;
-                node->strValue = p->expect(Token::Type::STRING, "Expected import string", true).value;
+                node->symbol = Symbols::intern(p->expect(Token::Type::STRING, "Expected import string", true).value);
 
-                if(node->strValue.ends_with(".lum")) {
-                    std::string v = p->expect(Token::Type::KEYWORD, "Expected 'as' after import statement", true).value;
+                if(node->strValue().ends_with(".lum")) {
+                    std::string_view v = p->expect(Token::Type::KEYWORD, "Expected 'as' after import statement", true).value;
                     if(v != "as") p->error("Expected 'as' after import statement");
 
-                    std::string alias = p->expect(Token::Type::IDENTIFIER, "Expected namespace identifier after 'as' in import statement", true).value;
-                    auto aliasNode = makeTypedNode(ASTNode::Type::IDENTIFIER, 1);
-                    aliasNode->strValue = alias;
+                    std::string_view alias = p->expect(Token::Type::IDENTIFIER, "Expected namespace identifier after 'as' in import statement", true).value;
+                    auto aliasNode = makeNode(ASTNode::Type::IDENTIFIER);
+                    aliasNode->symbol = Symbols::intern(alias);
                     node->children.push_back(aliasNode);
                 }
 
@@ -247,7 +256,7 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
                 if (depth!= 0)
                     p->error("Export statements are only allowed at top-level");
 
-                if(!p->match(Token::Type::IDENTIFIER) && (!p->match(Token::Type::KEYWORD) || p->peek().value != "fin") && !p->match(Token::Type::PRIMITIVE)) {
+                if(!p->match(Token::Type::IDENTIFIER) && (!p->match(Token::Type::KEYWORD) || (p->peek().value != "fin" && p->peek().value != "const")) && !p->match(Token::Type::PRIMITIVE)) {
                     p->error("Expected function, type, or primitive after export keyword");
                 }
                 
@@ -258,8 +267,7 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
                 }
                 
                 auto dataNode = makeNode(ASTNode::Type::STRING);
-                dataNode->valueType = 1;
-                dataNode->strValue = node->strValue;
+                dataNode->symbol = node->symbol;
                 p->exportBlock->children.push_back(dataNode);
 
                 return node;
@@ -268,16 +276,17 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
         {
             "true",
             [](Parser* p, int depth) {
-                auto node = makeTypedNode(ASTNode::Type::BOOL, 1);
-                node->strValue = "1";
+                auto node = makeNode(ASTNode::Type::BOOL);
+                node->symbol = Symbols::intern("1");
+                node->intValue = 1;
                 return node;
             }
         },
         {
             "false",
             [](Parser* p, int depth) {
-                auto node = makeTypedNode(ASTNode::Type::BOOL, 1);
-                node->strValue = "0";
+                auto node = makeNode(ASTNode::Type::BOOL);
+                node->symbol = Symbols::intern("0");
                 return node;
             }
         },
@@ -286,7 +295,7 @@ std::unordered_map<std::string, KwHandler> Parser::initKwMap() {
             [](Parser* p, int depth) {
                 if(depth != 0)
                     throw std::runtime_error("Cannot link to dll outside of top-level");
-                auto node = makeTypedNode(ASTNode::Type::STRING, 1);
+                auto node = makeNode(ASTNode::Type::STRING);
                 return node;
             }
         }
@@ -378,8 +387,8 @@ std::string astToString(const std::shared_ptr<ASTNode> &node, int indent) {
     std::stringstream ss;
     std::string ind(indent * 2, ' ');
     ss << ind << astTypeToString(node->type);
-    if (!node->strValue.empty()) {
-        ss << "{\"" << node->strValue << "\"}";
+    if (!node->strValue().empty()) {
+        ss << "{\"" << node->strValue() << "\"}";
     }
     if (node->primitiveValue != Primitive::NONE) {
         ss << "{" << static_cast<int>(node->primitiveValue) << "}";
@@ -388,7 +397,7 @@ std::string astToString(const std::shared_ptr<ASTNode> &node, int indent) {
         ss << "{" << static_cast<int>(node->binopValue) << "}";
     }
     if (node->type == ASTNode::Type::FUNCTION) {
-        ss << "{" << node->retType << "}";
+        ss << "{" << node->retType() << "}";
     }
     if (!node->children.empty()) {
         ss << ".[\n";
@@ -401,13 +410,23 @@ std::string astToString(const std::shared_ptr<ASTNode> &node, int indent) {
     return ss.str();
 }
 
-std::shared_ptr<ASTNode> makeTypedNode(ASTNode::Type t, int valueType) {
-    auto node = std::make_shared<ASTNode>();
-    node->type = t;
-    node->valueType = valueType;
-    return node;
+thread_local uint32_t parsingLine = 0;
+
+std::optional<int32_t> parseNumberLiteral(std::string_view text) {
+    int32_t value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || (end != text.data() + text.size() && *end != '.')) return std::nullopt;
+    return value;
 }
-// because of intellisense
+
 std::shared_ptr<ASTNode> makeNode(ASTNode::Type t) {
-    return makeTypedNode(t, 67);
+    return makeNode(t, parsingLine);
+}
+
+std::shared_ptr<ASTNode> makeNode(ASTNode::Type t, uint32_t line, Symbol symbol) {
+    auto node = std::allocate_shared<ASTNode>(ASTAllocator<ASTNode>());
+    node->type = t;
+    node->line = line;
+    node->symbol = symbol;
+    return node;
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "bytecode.hpp"
+#include <sstream>
+
+static const char *opName(Op op) {
+    switch (op) {
+        case Op::MOVE: return "MOVE";
+        case Op::LOADK: return "LOADK";
+        case Op::LOADI: return "LOADI";
+        case Op::LOADNIL: return "LOADNIL";
+        case Op::GETGLOBAL: return "GETGLOBAL";
+        case Op::SETGLOBAL: return "SETGLOBAL";
+        case Op::DEFGLOBAL: return "DEFGLOBAL";
+        case Op::ARITH: return "ARITH";
+        case Op::UNARY: return "UNARY";
+        case Op::ADDI: return "ADDI";
+        case Op::SUBI: return "SUBI";
+        case Op::MULI: return "MULI";
+        case Op::DIVI: return "DIVI";
+        case Op::MODI: return "MODI";
+        case Op::EQI: return "EQI";
+        case Op::LTI: return "LTI";
+        case Op::GTI: return "GTI";
+        case Op::LEI: return "LEI";
+        case Op::GEI: return "GEI";
+        case Op::ADDKI: return "ADDKI";
+        case Op::JMP: return "JMP";
+        case Op::JMPF: return "JMPF";
+        case Op::JEQI: return "JEQI";
+        case Op::JNEI: return "JNEI";
+        case Op::JLTI: return "JLTI";
+        case Op::JLEI: return "JLEI";
+        case Op::JGTI: return "JGTI";
+        case Op::JGEI: return "JGEI";
+        case Op::CHECKTYPE: return "CHECKTYPE";
+        case Op::CHECKSAME: return "CHECKSAME";
+        case Op::NEWARRAY: return "NEWARRAY";
+        case Op::APPEND: return "APPEND";
+        case Op::APPENDRANGE: return "APPENDRANGE";
+        case Op::NEWSIZED: return "NEWSIZED";
+        case Op::INDEX: return "INDEX";
+        case Op::INDEXN: return "INDEXN";
+        case Op::SETINDEX: return "SETINDEX";
+        case Op::SETINDEXN: return "SETINDEXN";
+        case Op::ITERCHECK: return "ITERCHECK";
+        case Op::LEN: return "LEN";
+        case Op::GETPROP: return "GETPROP";
+        case Op::GETFIELD: return "GETFIELD";
+        case Op::SETFIELD: return "SETFIELD";
+        case Op::NEWSTRUCT: return "NEWSTRUCT";
+        case Op::DEFSTRUCT: return "DEFSTRUCT";
+        case Op::CLOSURE: return "CLOSURE";
+        case Op::NATIVE: return "NATIVE";
+        case Op::CALL: return "CALL";
+        case Op::RET: return "RET";
+        case Op::RETNIL: return "RETNIL";
+        case Op::NDPUSH: return "NDPUSH";
+        case Op::NDSTEP: return "NDSTEP";
+        case Op::ERROR: return "ERROR";
+    }
+    return "?";
+}
+
+std::string disassemble(const Proto &proto, int indent) {
+    std::ostringstream out;
+    std::string pad(indent * 2, ' ');
+
+    out << pad << "proto " << proto.name << " (" << proto.maxRegs << " registers)\n";
+    for (size_t i = 0; i < proto.code.size(); ++i) {
+        const Instr &in = proto.code[i];
+        out << pad << "  " << i << "\t" << opName(in.op) << "\t" << in.a << " " << in.b << " " << in.c;
+        if (in.sx) out << " " << in.sx;
+        switch (in.op) {
+            case Op::GETGLOBAL: case Op::SETGLOBAL: case Op::DEFGLOBAL:
+                out << "\t; " << proto.names[in.b];
+                break;
+            case Op::GETPROP: case Op::GETFIELD:
+                out << "\t; " << proto.names[in.c];
+                break;
+            case Op::JMP: case Op::JMPF: case Op::JEQI: case Op::JNEI:
+            case Op::JLTI: case Op::JLEI: case Op::JGTI: case Op::JGEI:
+                out << "\t; -> " << static_cast<long>(i) + 1 + in.sx;
+                break;
+            default: break;
+        }
+        out << "\n";
+    }
+    for (const auto &child : proto.protos) out << disassemble(*child, indent + 1);
+    return out.str();
+}
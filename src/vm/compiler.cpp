@@ -0,0 +1,698 @@
+#include "vm.hpp"
+#include <stdexcept>
+
+std::shared_ptr<Proto> Compiler::compileModule(const std::shared_ptr<ASTNode> &pragma) {
+    auto proto = std::make_shared<Proto>();
+    proto->name = pragma->strValue();
+
+    FuncState state;
+    state.proto = proto;
+    state.isModule = true;
+    fs = &state;
+
+    // a top level return only ends the statement it appears in
+    const auto &children = pragma->children;
+    for (size_t i = 2; i < children.size(); ++i) {
+        statement(children[i]);
+        for (size_t at : fs->moduleReturns) patch(at);
+        fs->moduleReturns.clear();
+    }
+    emit(Op::RETNIL);
+
+    fs = nullptr;
+    return proto;
+}
+
+size_t Compiler::emit(Op op, uint16_t a, uint16_t b, uint16_t c, int32_t sx) {
+    fs->proto->code.push_back(Instr{op, a, b, c, sx});
+    return fs->proto->code.size() - 1;
+}
+
+void Compiler::patch(size_t at) {
+    auto &code = fs->proto->code;
+    code[at].sx = static_cast<int32_t>(code.size() - (at + 1));
+}
+
+void Compiler::jumpTo(size_t target) {
+    int32_t offset = static_cast<int32_t>(target) - static_cast<int32_t>(fs->proto->code.size() + 1);
+    emit(Op::JMP, 0, 0, 0, offset);
+}
+
+uint16_t Compiler::allocReg(StaticType type) {
+    if (fs->freeReg == NO_REG)
+        throw std::runtime_error("Function " + fs->proto->name + " needs too many registers");
+    uint16_t reg = fs->freeReg++;
+    if (fs->regTypes.size() <= reg) fs->regTypes.resize(reg + 1);
+    fs->regTypes[reg] = type;
+    fs->proto->maxRegs = std::max(fs->proto->maxRegs, fs->freeReg);
+    return reg;
+}
+
+uint16_t Compiler::constant(const TypedValue &val) {
+    auto &constants = fs->proto->constants;
+    constants.push_back(val);
+    return static_cast<uint16_t>(constants.size() - 1);
+}
+
+uint16_t Compiler::name(const std::string &str) {
+    auto &names = fs->proto->names;
+    auto it = std::find(names.begin(), names.end(), str);
+    if (it != names.end()) return static_cast<uint16_t>(it - names.begin());
+    names.push_back(str);
+    fs->proto->symbols.push_back(Symbols::intern(str));
+    return static_cast<uint16_t>(names.size() - 1);
+}
+
+uint16_t Compiler::typeIndex(const Type &type) {
+    fs->proto->types.push_back(type);
+    return static_cast<uint16_t>(fs->proto->types.size() - 1);
+}
+
+void Compiler::error(const std::string &msg) {
+    emit(Op::ERROR, 0, constant(TypedValue(msg)));
+}
+
+uint16_t Compiler::floor() const {
+    if (fs->locals.empty()) return fs->scopes.empty() ? 0 : fs->scopes.back().second;
+    return std::max<uint16_t>(fs->locals.back().reg + 1, fs->scopes.empty() ? 0 : fs->scopes.back().second);
+}
+
+void Compiler::beginScope() {
+    fs->scopes.emplace_back(fs->locals.size(), fs->freeReg);
+}
+
+void Compiler::endScope() {
+    auto [localCount, freeReg] = fs->scopes.back();
+    fs->scopes.pop_back();
+    fs->locals.resize(localCount);
+    fs->freeReg = freeReg;
+}
+
+std::optional<uint16_t> Compiler::resolveLocal(const std::string &ident) {
+    for (auto it = fs->locals.rbegin(); it != fs->locals.rend(); ++it)
+        if (it->name == ident) return it->reg;
+    return std::nullopt;
+}
+
+bool Compiler::capturesLocal(const std::string &ident) {
+    for (FuncState *state = fs->enclosing; state; state = state->enclosing)
+        for (const auto &local : state->locals)
+            if (local.name == ident) return true;
+    return false;
+}
+
+bool Compiler::definesGlobal() const {
+    return fs->isModule && fs->blockDepth == 0;
+}
+
+void Compiler::define(const std::string &ident, uint16_t reg, StaticType type) {
+    if (definesGlobal()) {
+        emit(Op::DEFGLOBAL, reg, name(ident));
+        return;
+    }
+    fs->locals.push_back({ident, reg});
+    fs->regTypes[reg] = type;
+}
+
+void Compiler::statement(const std::shared_ptr<ASTNode> &node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case ASTNode::Type::BLOCK:
+            beginScope();
+            fs->blockDepth++;
+            block(node->children);
+            fs->blockDepth--;
+            endScope();
+            break;
+        case ASTNode::Type::STRUCT_DECLARE: structDeclaration(node); break;
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: assignment(node, NO_REG); break;
+        case ASTNode::Type::STRUCT_ASSIGNMENT: structAssignment(node); break;
+        case ASTNode::Type::NDARRAY_ASSIGN: ndarrayAssignment(node, NO_REG); break;
+        case ASTNode::Type::RETURN_STATEMENT: {
+            if (fs->isModule) {
+                if (!node->children.empty()) discard(node->children[0]);
+                fs->moduleReturns.push_back(emit(Op::JMP));
+                break;
+            }
+            if (node->children.empty()) {
+                emit(Op::RETNIL);
+                break;
+            }
+            auto [reg, type] = exprAny(node->children[0]);
+            emit(Op::RET, reg);
+            break;
+        }
+        case ASTNode::Type::IF_STATEMENT: ifStatement(node); break;
+        case ASTNode::Type::WHILE_STATEMENT: whileStatement(node); break;
+        case ASTNode::Type::FOR_STATEMENT: forStatement(node); break;
+        case ASTNode::Type::FUNCTION: function(node); break;
+        case ASTNode::Type::NATIVE_STATEMENT: nativeStatement(node); break;
+        default: discard(node); break;
+    }
+
+    fs->freeReg = floor();
+}
+
+void Compiler::block(const ASTChildren &nodes) {
+    for (const auto &node : nodes) statement(node);
+}
+
+void Compiler::ifStatement(const std::shared_ptr<ASTNode> &node) {
+    std::vector<size_t> skipThen;
+    jumpIfFalse(node->children[0], skipThen);
+    statement(node->children[1]);
+
+    if (node->children.size() > 2 && node->children[2]->type == ASTNode::Type::ELSE_STATEMENT) {
+        size_t skipElse = emit(Op::JMP);
+        for (size_t at : skipThen) patch(at);
+        statement(node->children[2]->children[0]);
+        patch(skipElse);
+        return;
+    }
+    for (size_t at : skipThen) patch(at);
+}
+
+void Compiler::whileStatement(const std::shared_ptr<ASTNode> &node) {
+    size_t loop = fs->proto->code.size();
+    std::vector<size_t> exits;
+    jumpIfFalse(node->children[0], exits);
+    statement(node->children[1]);
+    jumpTo(loop);
+    for (size_t at : exits) patch(at);
+}
+
+void Compiler::forStatement(const std::shared_ptr<ASTNode> &node) {
+    beginScope();
+    fs->blockDepth++;
+
+    if (node->strValue() == "0") {
+        statement(node->children[0]);
+        size_t loop = fs->proto->code.size();
+        std::vector<size_t> exits;
+        jumpIfFalse(node->children[1], exits);
+        statement(node->children[3]);
+        discard(node->children[2]);
+        fs->freeReg = floor();
+        jumpTo(loop);
+        for (size_t at : exits) patch(at);
+    } else {
+        const auto &varDecl = node->children[0];
+
+        uint16_t arr = allocReg();
+        expr(node->children[1], arr);
+        emit(Op::ITERCHECK, arr);
+        uint16_t len = allocReg(StaticType::Int);
+        emit(Op::LEN, len, arr);
+        uint16_t idx = allocReg(StaticType::Int);
+        emit(Op::LOADI, idx);
+        uint16_t var = allocReg();
+        define(varDecl->strValue(), var, StaticType::Unknown);
+
+        size_t loop = fs->proto->code.size();
+        size_t exit = emit(Op::JGEI, idx, len);
+        emit(Op::INDEX, var, arr, idx);
+        statement(node->children[2]);
+        emit(Op::ADDKI, idx, idx, 0, 1);
+        jumpTo(loop);
+        patch(exit);
+    }
+
+    fs->blockDepth--;
+    endScope();
+}
+
+void Compiler::function(const std::shared_ptr<ASTNode> &node) {
+    auto funcData = executor.executeFunctionDefinition(node, nullptr);
+
+    auto proto = std::make_shared<Proto>();
+    proto->name = node->strValue();
+    proto->signature = funcData;
+
+    FuncState state;
+    state.proto = proto;
+    state.enclosing = fs;
+    FuncState *parent = fs;
+    fs = &state;
+
+    // arguments are type checked on entry, so the parameter registers keep their static type
+    for (const auto &param : funcData->params) {
+        uint16_t reg = allocReg(param.vararg ? StaticType::Unknown : staticTypeOf(param.type));
+        fs->locals.push_back({param.ident, reg});
+    }
+    statement(funcData->body);
+    emit(Op::RETNIL);
+
+    fs = parent;
+    fs->proto->protos.push_back(proto);
+    uint16_t reg = allocReg();
+    emit(Op::CLOSURE, reg, static_cast<uint16_t>(fs->proto->protos.size() - 1));
+    define(node->strValue(), reg, StaticType::Unknown);
+}
+
+void Compiler::nativeStatement(const std::shared_ptr<ASTNode> &node) {
+    auto funcData = executor.executeFunctionDefinition(node->children[0], nullptr);
+    fs->proto->natives.push_back({node->strValue(), funcData});
+    uint16_t reg = allocReg();
+    emit(Op::NATIVE, reg, static_cast<uint16_t>(fs->proto->natives.size() - 1));
+    define(node->strValue(), reg, StaticType::Unknown);
+}
+
+void Compiler::structDeclaration(const std::shared_ptr<ASTNode> &node) {
+    auto structType = std::make_shared<StructType>(node->strValue());
+    for (const auto &child : node->children) {
+        if (child->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT)
+            structType->fields.emplace_back(child->symbol, child->primitiveValue);
+        else
+            structType->fields.emplace_back(child->symbol, child->children[0]->strValue());
+    }
+    fs->proto->structs.push_back(structType);
+    emit(Op::DEFSTRUCT, static_cast<uint16_t>(fs->proto->structs.size() - 1));
+}
+
+uint16_t Compiler::structAssignment(const std::shared_ptr<ASTNode> &node) {
+    uint16_t reg = allocReg();
+
+    StructInit init;
+    init.structName = node->children[0]->strValue();
+    init.structSymbol = node->children[0]->symbol;
+    uint16_t base = fs->freeReg;
+    for (size_t i = 1; i < node->children.size(); ++i) allocReg();
+    for (size_t i = 1; i < node->children.size(); ++i) {
+        const auto &arg = node->children[i];
+        uint16_t argReg = base + static_cast<uint16_t>(i - 1);
+        if (arg->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT) {
+            init.argNames.push_back(arg->strValue());
+            expr(arg->children[0], argReg);
+        } else {
+            init.argNames.emplace_back();
+            expr(arg, argReg);
+        }
+    }
+
+    fs->proto->structInits.push_back(init);
+    emit(Op::NEWSTRUCT, reg, base, static_cast<uint16_t>(fs->proto->structInits.size() - 1));
+    define(node->strValue(), reg, StaticType::Unknown);
+    return reg;
+}
+
+void Compiler::assignment(const std::shared_ptr<ASTNode> &node, uint16_t dst) {
+    const auto &children = node->children;
+
+    // struct property assignment
+    if (children.size() > 1 && children[0]->type == ASTNode::Type::READ) {
+        const auto &readNode = children[0];
+        uint16_t field = name(readNode->children[1]->strValue());
+        auto [obj, objType] = exprAny(readNode->children[0]);
+        uint16_t old = allocReg();
+        emit(Op::GETFIELD, old, obj, field);
+
+        fs->selfRefs.emplace_back(old, StaticType::Unknown);
+        uint16_t val = allocReg();
+        expr(children[1], val);
+        fs->selfRefs.pop_back();
+
+        if (children[1]->type == ASTNode::Type::ARRAY_LITERAL && children[1]->children.empty())
+            emit(Op::CHECKTYPE, val, typeIndex(Type(BaseType::Array)));
+        else
+            emit(Op::CHECKSAME, old, val, field);
+        emit(Op::SETFIELD, obj, field, val);
+        if (dst != NO_REG) emit(Op::MOVE, dst, val);
+        return;
+    }
+
+    const std::string &ident = node->strValue();
+    bool isLiteral = !children.empty() && children[0]->type == ASTNode::Type::ARRAY_LITERAL;
+
+    if (node->primitiveValue == Primitive::NONE) {
+        if (auto local = resolveLocal(ident)) {
+            uint16_t reg = *local;
+            StaticType varType = fs->regTypes[reg];
+            fs->selfRefs.emplace_back(reg, varType);
+            if (varType != StaticType::Unknown && predict(children[0]) == varType) {
+                expr(children[0], reg);
+            } else {
+                uint16_t val = allocReg();
+                expr(children[0], val);
+                // registers with a static type must keep it, so only untyped ones get the literal leniency
+                if (!isLiteral || varType != StaticType::Unknown)
+                    emit(Op::CHECKSAME, reg, val, NO_REG);
+                else if (children[0]->children.empty())
+                    emit(Op::CHECKTYPE, val, typeIndex(Type(BaseType::Array)));
+                emit(Op::MOVE, reg, val);
+            }
+            fs->selfRefs.pop_back();
+            if (dst != NO_REG && dst != reg) emit(Op::MOVE, dst, reg);
+            return;
+        }
+        if (capturesLocal(ident)) {
+            error("VM engine cannot capture local variable: " + ident);
+            return;
+        }
+
+        uint16_t old = allocReg();
+        emit(Op::GETGLOBAL, old, name(ident));
+        fs->selfRefs.emplace_back(old, StaticType::Unknown);
+        uint16_t val = allocReg();
+        expr(children[0], val);
+        fs->selfRefs.pop_back();
+
+        if (!isLiteral)
+            emit(Op::CHECKSAME, old, val, NO_REG);
+        else if (children[0]->children.empty())
+            emit(Op::CHECKTYPE, val, typeIndex(Type(BaseType::Array)));
+        emit(Op::SETGLOBAL, val, name(ident));
+        if (dst != NO_REG) emit(Op::MOVE, dst, val);
+        return;
+    }
+
+    uint16_t reg = allocReg();
+    StaticType declared = StaticType::Unknown;
+    if (children.empty()) {
+        emit(Op::LOADK, reg, constant(executor.primitiveValue(node->primitiveValue)));
+        declared = staticTypeOf(Type(node->primitiveValue));
+    } else if (isLiteral) {
+        expr(children[0], reg);
+        if (children[0]->children.empty())
+            emit(Op::CHECKTYPE, reg, typeIndex(Type(BaseType::Array)));
+    } else if (children[0]->type == ASTNode::Type::SIZED_ARRAY_DECLARE) {
+        expr(children[0], reg);
+        if (children[0]->primitiveValue != node->primitiveValue)
+            emit(Op::CHECKTYPE, reg, typeIndex(Type(node->primitiveValue).array()));
+    } else {
+        Type expected(node->primitiveValue);
+        declared = staticTypeOf(expected);
+        if (expr(children[0], reg) != declared)
+            emit(Op::CHECKTYPE, reg, typeIndex(expected));
+    }
+    define(ident, reg, declared);
+    if (dst != NO_REG) emit(Op::MOVE, dst, reg);
+}
+
+void Compiler::ndarrayAssignment(const std::shared_ptr<ASTNode> &node, uint16_t dst) {
+    const auto &children = node->children;
+    int efficiency = children[0]->intValue;
+
+    uint16_t result = allocReg();
+    std::vector<uint16_t> shape;
+    for (size_t i = 1; i < children.size() - 1; ++i) {
+        shape.push_back(allocReg());
+        expr(children[i], shape.back());
+    }
+    uint16_t total = allocReg(StaticType::Int);
+    emit(Op::LOADI, total, 0, 0, 1);
+    for (uint16_t dim : shape) emit(Op::ARITH, total, total, dim, MULTIPLY);
+
+    emit(Op::NEWARRAY, result, static_cast<uint16_t>(Primitive::INT));
+    const auto &rhs = children.back();
+    uint16_t flat = allocReg(StaticType::Int);
+    emit(Op::LOADI, flat);
+    uint16_t val = allocReg();
+
+    uint16_t indexArr = NO_REG, shapeArr = NO_REG;
+    if (efficiency == 0) {
+        expr(rhs, val);
+    } else if (efficiency == 2) {
+        indexArr = allocReg();
+        emit(Op::NEWARRAY, indexArr, static_cast<uint16_t>(Primitive::INT));
+        shapeArr = allocReg();
+        emit(Op::NEWARRAY, shapeArr, static_cast<uint16_t>(Primitive::INT));
+        uint16_t zero = allocReg(StaticType::Int);
+        emit(Op::LOADI, zero);
+        for (uint16_t dim : shape) {
+            emit(Op::APPEND, indexArr, zero, 0, 1);
+            emit(Op::APPEND, shapeArr, dim, 0, 1);
+        }
+    }
+
+    size_t loop = fs->proto->code.size();
+    size_t exit = emit(Op::JGEI, flat, total);
+    if (efficiency == 1) {
+        fs->selfRefs.emplace_back(flat, StaticType::Int);
+        expr(rhs, val);
+        fs->selfRefs.pop_back();
+    } else if (efficiency == 2) {
+        fs->selfRefs.emplace_back(indexArr, StaticType::Unknown);
+        expr(rhs, val);
+        fs->selfRefs.pop_back();
+    }
+    emit(Op::NDPUSH, result, val, flat);
+    if (efficiency == 2) emit(Op::NDSTEP, indexArr, shapeArr);
+    emit(Op::ADDKI, flat, flat, 0, 1);
+    jumpTo(loop);
+    patch(exit);
+
+    define(node->strValue(), result, StaticType::Unknown);
+    if (dst != NO_REG) emit(Op::MOVE, dst, result);
+}
+
+void Compiler::discard(const std::shared_ptr<ASTNode> &node) {
+    if (node->type == ASTNode::Type::PRIMITIVE_ASSIGNMENT) {
+        assignment(node, NO_REG);
+        return;
+    }
+    expr(node, allocReg());
+}
+
+void Compiler::jumpIfFalse(const std::shared_ptr<ASTNode> &cond, std::vector<size_t> &jumps) {
+    uint16_t saved = fs->freeReg;
+
+    if (cond->type == ASTNode::Type::BINARY_OP) {
+        Op inverse;
+        bool compare = true;
+        switch (cond->binopValue) {
+            case COMPARISON:    inverse = Op::JNEI; break;
+            case LESS:          inverse = Op::JGEI; break;
+            case GREATER:       inverse = Op::JLEI; break;
+            case LESS_EQUAL:    inverse = Op::JGTI; break;
+            case GREATER_EQUAL: inverse = Op::JLTI; break;
+            default: compare = false; break;
+        }
+        if (compare) {
+            auto [lhs, lhsType] = exprAny(cond->children[0]);
+            auto [rhs, rhsType] = exprAny(cond->children[1]);
+            if (lhsType == StaticType::Int && rhsType == StaticType::Int) {
+                jumps.push_back(emit(inverse, lhs, rhs));
+            } else {
+                uint16_t result = allocReg();
+                emit(Op::ARITH, result, lhs, rhs, cond->binopValue);
+                jumps.push_back(emit(Op::JMPF, result));
+            }
+            fs->freeReg = saved;
+            return;
+        }
+    }
+
+    auto [reg, type] = exprAny(cond);
+    jumps.push_back(emit(Op::JMPF, reg));
+    fs->freeReg = saved;
+}
+
+StaticType Compiler::predict(const std::shared_ptr<ASTNode> &node) {
+    switch (node->type) {
+        case ASTNode::Type::NUMBER: return StaticType::Int;
+        case ASTNode::Type::BOOL: return StaticType::Bool;
+        case ASTNode::Type::STRING: return StaticType::String;
+        case ASTNode::Type::IDENTIFIER: {
+            auto reg = resolveLocal(node->strValue());
+            return reg ? fs->regTypes[*reg] : StaticType::Unknown;
+        }
+        case ASTNode::Type::SELF_REFERENCE:
+            return fs->selfRefs.empty() ? StaticType::Unknown : fs->selfRefs.back().second;
+        case ASTNode::Type::BINARY_OP: {
+            StaticType lhs = predict(node->children[0]);
+            if (lhs == StaticType::Int && predict(node->children[1]) == StaticType::Int)
+                return binaryResultType(node->binopValue, StaticType::Int);
+            return binaryResultType(node->binopValue, lhs);
+        }
+        case ASTNode::Type::UNARY_OP:
+            if (node->binopValue == MINUS || node->binopValue == BITWISE_NOT) return StaticType::Int;
+            if (node->binopValue == NOT) return StaticType::Bool;
+            return StaticType::Unknown;
+        default:
+            return StaticType::Unknown;
+    }
+}
+
+StaticType Compiler::expr(const std::shared_ptr<ASTNode> &node, uint16_t dst) {
+    uint16_t saved = fs->freeReg;
+    StaticType result = StaticType::Unknown;
+
+    switch (node->type) {
+        case ASTNode::Type::NUMBER:
+            emit(Op::LOADI, dst, 0, 0, node->intValue);
+            result = StaticType::Int;
+            break;
+        case ASTNode::Type::BOOL:
+            emit(Op::LOADK, dst, constant(TypedValue(node->intValue != 0)));
+            result = StaticType::Bool;
+            break;
+        case ASTNode::Type::STRING:
+            emit(Op::LOADK, dst, constant(TypedValue(node->strValue())));
+            result = StaticType::String;
+            break;
+        case ASTNode::Type::IDENTIFIER: {
+            if (auto reg = resolveLocal(node->strValue())) {
+                if (*reg != dst) emit(Op::MOVE, dst, *reg);
+                result = fs->regTypes[*reg];
+            } else if (capturesLocal(node->strValue())) {
+                error("VM engine cannot capture local variable: " + node->strValue());
+            } else {
+                emit(Op::GETGLOBAL, dst, name(node->strValue()));
+            }
+            break;
+        }
+        case ASTNode::Type::SELF_REFERENCE:
+            if (fs->selfRefs.empty()) {
+                emit(Op::LOADNIL, dst);
+            } else {
+                auto [reg, type] = fs->selfRefs.back();
+                if (reg != dst) emit(Op::MOVE, dst, reg);
+                result = type;
+            }
+            break;
+
+        case ASTNode::Type::PRIMITIVE_ASSIGNMENT: assignment(node, dst); break;
+        case ASTNode::Type::STRUCT_ASSIGNMENT: emit(Op::MOVE, dst, structAssignment(node)); break;
+        case ASTNode::Type::NDARRAY_ASSIGN: ndarrayAssignment(node, dst); break;
+
+        case ASTNode::Type::ARRAY_ACCESS: {
+            auto [arr, arrType] = exprAny(node->children[0]);
+            bool single;
+            uint16_t idx = indices(node->children[1], single);
+            emit(single ? Op::INDEX : Op::INDEXN, dst, arr, idx);
+            break;
+        }
+        case ASTNode::Type::ARRAY_ASSIGN: {
+            auto [arr, arrType] = exprAny(node->children[0]);
+            bool single;
+            uint16_t idx = indices(node->children[1], single);
+            auto [val, valType] = exprAny(node->children[2]);
+            emit(single ? Op::SETINDEX : Op::SETINDEXN, arr, idx, val);
+            if (arr != dst) emit(Op::MOVE, dst, arr);
+            break;
+        }
+        case ASTNode::Type::ARRAY_LITERAL: arrayLiteral(node, dst); break;
+
+        case ASTNode::Type::CALL: call(node, dst); break;
+        case ASTNode::Type::BINARY_OP: result = binaryOp(node, dst); break;
+        case ASTNode::Type::UNARY_OP: {
+            auto [val, valType] = exprAny(node->children[0]);
+            emit(Op::UNARY, dst, val, 0, node->binopValue);
+            result = predict(node);
+            break;
+        }
+        case ASTNode::Type::READ: {
+            auto [target, targetType] = exprAny(node->children[0]);
+            emit(Op::GETPROP, dst, target, name(node->children[1]->strValue()));
+            break;
+        }
+        case ASTNode::Type::SIZED_ARRAY_DECLARE: {
+            auto [size, sizeType] = exprAny(node->children[0]);
+            emit(Op::NEWSIZED, dst, size, static_cast<uint16_t>(node->primitiveValue));
+            break;
+        }
+
+        default:
+            error("Unsupported expression type: " + std::to_string(static_cast<int>(node->type)));
+            break;
+    }
+
+    fs->freeReg = std::max(saved, floor());
+    return result;
+}
+
+std::pair<uint16_t, StaticType> Compiler::exprAny(const std::shared_ptr<ASTNode> &node) {
+    if (node->type == ASTNode::Type::IDENTIFIER) {
+        if (auto reg = resolveLocal(node->strValue())) return {*reg, fs->regTypes[*reg]};
+    }
+    if (node->type == ASTNode::Type::SELF_REFERENCE && !fs->selfRefs.empty())
+        return fs->selfRefs.back();
+
+    uint16_t reg = allocReg();
+    StaticType type = expr(node, reg);
+    return {reg, type};
+}
+
+StaticType Compiler::binaryOp(const std::shared_ptr<ASTNode> &node, uint16_t dst) {
+    BinaryOp op = node->binopValue;
+    const auto &rhsNode = node->children[1];
+    auto [lhs, lhsType] = exprAny(node->children[0]);
+
+    // small integer literal on the right of + and -
+    if (lhsType == StaticType::Int && rhsNode->type == ASTNode::Type::NUMBER && (op == PLUS || op == MINUS)) {
+        int k = rhsNode->intValue;
+        emit(Op::ADDKI, dst, lhs, 0, op == PLUS ? k : -k);
+        return StaticType::Int;
+    }
+
+    auto [rhs, rhsType] = exprAny(rhsNode);
+    if (lhsType == StaticType::Int && rhsType == StaticType::Int) {
+        Op typed;
+        switch (op) {
+            case PLUS:          typed = Op::ADDI; break;
+            case MINUS:         typed = Op::SUBI; break;
+            case MULTIPLY:      typed = Op::MULI; break;
+            case DIVIDE:        typed = Op::DIVI; break;
+            case MODULUS:       typed = Op::MODI; break;
+            case COMPARISON:    typed = Op::EQI; break;
+            case LESS:          typed = Op::LTI; break;
+            case GREATER:       typed = Op::GTI; break;
+            case LESS_EQUAL:    typed = Op::LEI; break;
+            case GREATER_EQUAL: typed = Op::GEI; break;
+            default:
+                emit(Op::ARITH, dst, lhs, rhs, op);
+                return StaticType::Unknown;
+        }
+        emit(typed, dst, lhs, rhs);
+        return binaryResultType(op, StaticType::Int);
+    }
+
+    emit(Op::ARITH, dst, lhs, rhs, op);
+    return binaryResultType(op, lhsType);
+}
+
+void Compiler::call(const std::shared_ptr<ASTNode> &node, uint16_t dst) {
+    // callee and arguments occupy consecutive registers, the callee frame starts right after the callee
+    uint16_t base = allocReg();
+    expr(node->children[0], base);
+    for (size_t i = 1; i < node->children.size(); ++i) expr(node->children[i], allocReg());
+    emit(Op::CALL, dst, base, static_cast<uint16_t>(node->children.size() - 1));
+}
+
+void Compiler::arrayLiteral(const std::shared_ptr<ASTNode> &node, uint16_t dst) {
+    uint16_t arr = allocReg();
+    emit(Op::NEWARRAY, arr, static_cast<uint16_t>(Primitive::NONE));
+    for (const auto &child : node->children) {
+        if (child->type == ASTNode::Type::RANGE) {
+            auto [start, startType] = exprAny(child->children[0]);
+            auto [end, endType] = exprAny(child->children[1]);
+            emit(Op::APPENDRANGE, arr, start, end);
+        } else {
+            auto [val, valType] = exprAny(child);
+            emit(Op::APPEND, arr, val);
+        }
+    }
+    emit(Op::MOVE, dst, arr);
+}
+
+uint16_t Compiler::indices(const std::shared_ptr<ASTNode> &indicesNode, bool &single) {
+    const auto &children = indicesNode->children;
+    single = children.size() == 1 && children[0]->type != ASTNode::Type::RANGE;
+    if (single) return exprAny(children[0]).first;
+
+    // index lists are collected raw (sx = 1): mixing ranges and ints is allowed here
+    uint16_t list = allocReg();
+    emit(Op::NEWARRAY, list, static_cast<uint16_t>(Primitive::INT));
+    for (const auto &child : children) {
+        if (child->type == ASTNode::Type::RANGE) {
+            auto [start, startType] = exprAny(child->children[0]);
+            auto [end, endType] = exprAny(child->children[1]);
+            emit(Op::APPENDRANGE, list, start, end, 1);
+        } else {
+            auto [val, valType] = exprAny(child);
+            emit(Op::APPEND, list, val, 0, 1);
+        }
+    }
+    return list;
+}
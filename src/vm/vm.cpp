@@ -0,0 +1,351 @@
+#include "vm.hpp"
+#include "executils.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+VM::VM(std::shared_ptr<ASTNode> root, bool dumpBytecode)
+    : root(root), dumpBytecode(dumpBytecode), executor(root), compiler(executor) {
+    globalEnv = std::make_shared<Environment>();
+    globalEnv->set("nil", TypedValue());
+    stack.resize(256);
+}
+
+TypedValue VM::run() {
+    std::ofstream debugFile;
+    if (dumpBytecode) debugFile.open("bytecodedebug.txt");
+    for (auto &child : root->children) {
+        pragmas[child->strValue()] = child;
+        modules[child->strValue()] = compiler.compileModule(child);
+        if (debugFile.is_open()) debugFile << disassemble(*modules[child->strValue()]);
+    }
+    if (debugFile.is_open()) debugFile.close();
+
+    executePragma(root->children.back(), globalEnv);
+    if (globalEnv->has("main")) {
+        auto mainFunc = globalEnv->get("main");
+        if (!mainFunc.is(BaseType::Function))
+            throw std::runtime_error("main is not a function type - received " + mainFunc.type().toString());
+        return *mainFunc.get<PFunction>()->fn({});
+    }
+    return TypedValue(0);
+}
+
+void VM::handleImports(const ASTChildren &children, ENV env) {
+    const auto &maps = getImportMaps();
+    for (auto &child : children) {
+        const std::string &name = child->strValue();
+        if (name.ends_with(".lum")) {
+            if (!exportData.contains(name)) {
+                if (!pragmas.contains(name)) throw std::runtime_error("Unknown pragma: " + name);
+                if (std::find(handlingModules.begin(), handlingModules.end(), name) != handlingModules.end())
+                    throw std::runtime_error("Circular import: " + name);
+                executePragma(pragmas[name], std::make_shared<Environment>());
+            }
+            env->set(child->children[0]->strValue(), exportData[name]);
+            continue;
+        }
+        if (!maps.contains(name)) throw std::runtime_error("Unknown module: " + name);
+        maps.at(name)(env, &executor);
+    }
+}
+
+void VM::executePragma(const std::shared_ptr<ASTNode> &node, ENV env) {
+    handlingModules.push_back(node->strValue());
+    auto &children = node->children;
+    handleImports(children[0]->children, env);
+    exportData[node->strValue()] = makeRef<ExportData>(node->strValue());
+
+    execute(*modules[node->strValue()], env, top);
+
+    for (auto &exportNode : children[1]->children) {
+        if (!env->has(exportNode->symbol))
+            throw std::runtime_error("Cannot export undefined variable: " + exportNode->strValue());
+        exportData[node->strValue()]->addExport(exportNode->symbol, env);
+    }
+
+    handlingModules.pop_back();
+}
+
+PFunction VM::makeClosure(const std::shared_ptr<Proto> &proto, ENV env) {
+    auto closure = std::make_shared<VMClosure>(VMClosure{proto, env});
+    auto func = makeRef<Function>(Function{
+        [this, closure](const std::vector<std::shared_ptr<TypedValue>> &args) {
+            return std::make_shared<TypedValue>(call(*closure, args));
+        }
+    });
+    func->closure = closure;
+    return func;
+}
+
+void VM::reserve(size_t size) {
+    if (stack.size() < size) stack.resize(std::max(size, stack.size() * 2));
+}
+
+TypedValue VM::call(const VMClosure &closure, const std::vector<std::shared_ptr<TypedValue>> &args) {
+    size_t base = top;
+    reserve(base + args.size());
+    for (size_t i = 0; i < args.size(); ++i) stack[base + i] = *args[i];
+    return invoke(closure, base, args.size());
+}
+
+TypedValue VM::invoke(const VMClosure &closure, size_t base, size_t argc) {
+    const Proto &proto = *closure.proto;
+    reserve(base + std::max<size_t>(proto.maxRegs, proto.signature->params.size()));
+    bindArguments(*proto.signature, stack.data() + base, argc);
+    return execute(proto, closure.env, base);
+}
+
+static std::vector<int> indexList(Executor &executor, const TypedValue &list) {
+    std::vector<int> indices;
+    for (const auto &idx : list.get<PArray>()->elements) indices.push_back(executor.getIntValue(idx));
+    return indices;
+}
+
+static PArray arrayOperand(const TypedValue &val, const char *err) {
+    if (val.kind() != BaseType::Array) throw std::runtime_error(err);
+    return val.get<PArray>();
+}
+
+static int checkedIndex(const PArray &arr, int idx) {
+    if (idx < 0 || static_cast<size_t>(idx) >= arr->elements.size())
+        throw std::runtime_error("Array index out of bounds: " + std::to_string(idx));
+    return idx;
+}
+
+static TypedValue &structField(const TypedValue &target, Symbol prop) {
+    if (!target.is(BaseType::Struct))
+        throw std::runtime_error("Left-hand side of assignment is not a struct or object");
+    TypedValue *field = target.get<PStruct>()->findField(prop);
+    if (!field) throw std::runtime_error("Struct does not have field: " + Symbols::name(prop));
+    return *field;
+}
+
+TypedValue VM::execute(const Proto &proto, ENV env, size_t base) {
+    struct TopGuard {
+        size_t &top;
+        size_t saved;
+        ~TopGuard() { top = saved; }
+    } guard{top, top};
+
+    reserve(base + proto.maxRegs);
+    top = base + proto.maxRegs;
+
+    TypedValue *R = stack.data() + base;
+    const Instr *pc = proto.code.data();
+
+    auto checkReturn = [&proto](const TypedValue &val) {
+        if (proto.signature && !proto.signature->retType.match(val.type()))
+            throw std::runtime_error("Function return type mismatch - got " + val.type().toString() +
+                                     " but expected " + proto.signature->retType.toString());
+    };
+
+    for (;;) {
+        const Instr &in = *pc++;
+        switch (in.op) {
+            case Op::MOVE: R[in.a] = R[in.b]; break;
+            case Op::LOADK: R[in.a] = proto.constants[in.b]; break;
+            case Op::LOADI: R[in.a] = TypedValue(static_cast<int>(in.sx)); break;
+            case Op::LOADNIL: R[in.a] = TypedValue(); break;
+
+            case Op::GETGLOBAL: R[in.a] = env->get(proto.symbols[in.b]); break;
+            case Op::SETGLOBAL: env->modify(proto.symbols[in.b], R[in.a]); break;
+            case Op::DEFGLOBAL: env->set(proto.symbols[in.b], R[in.a]); break;
+
+            case Op::ARITH: R[in.a] = executor.evaluateBinaryOp(R[in.b], R[in.c], static_cast<BinaryOp>(in.sx)); break;
+            case Op::UNARY: R[in.a] = executor.evaluateUnaryOp(R[in.b], static_cast<BinaryOp>(in.sx)); break;
+
+            case Op::ADDI: R[in.a] = TypedValue(R[in.b].get<int>() + R[in.c].get<int>()); break;
+            case Op::SUBI: R[in.a] = TypedValue(R[in.b].get<int>() - R[in.c].get<int>()); break;
+            case Op::MULI: R[in.a] = TypedValue(R[in.b].get<int>() * R[in.c].get<int>()); break;
+            case Op::DIVI: R[in.a] = TypedValue(R[in.b].get<int>() / R[in.c].get<int>()); break;
+            case Op::MODI: R[in.a] = TypedValue(R[in.b].get<int>() % R[in.c].get<int>()); break;
+            case Op::EQI: R[in.a] = TypedValue(R[in.b].get<int>() == R[in.c].get<int>()); break;
+            case Op::LTI: R[in.a] = TypedValue(R[in.b].get<int>() < R[in.c].get<int>()); break;
+            case Op::GTI: R[in.a] = TypedValue(R[in.b].get<int>() > R[in.c].get<int>()); break;
+            case Op::LEI: R[in.a] = TypedValue(R[in.b].get<int>() <= R[in.c].get<int>()); break;
+            case Op::GEI: R[in.a] = TypedValue(R[in.b].get<int>() >= R[in.c].get<int>()); break;
+            case Op::ADDKI: R[in.a] = TypedValue(R[in.b].get<int>() + in.sx); break;
+
+            case Op::JMP: pc += in.sx; break;
+            case Op::JMPF: if (!executor.getBoolValue(R[in.a])) pc += in.sx; break;
+            case Op::JEQI: if (R[in.a].get<int>() == R[in.b].get<int>()) pc += in.sx; break;
+            case Op::JNEI: if (R[in.a].get<int>() != R[in.b].get<int>()) pc += in.sx; break;
+            case Op::JLTI: if (R[in.a].get<int>() < R[in.b].get<int>()) pc += in.sx; break;
+            case Op::JLEI: if (R[in.a].get<int>() <= R[in.b].get<int>()) pc += in.sx; break;
+            case Op::JGTI: if (R[in.a].get<int>() > R[in.b].get<int>()) pc += in.sx; break;
+            case Op::JGEI: if (R[in.a].get<int>() >= R[in.b].get<int>()) pc += in.sx; break;
+
+            case Op::CHECKTYPE: {
+                const Type &expected = proto.types[in.b];
+                if (!R[in.a].type().match(expected))
+                    throw std::runtime_error("Incompatible types for assignment; expected " +
+                                             expected.toString() + " but got " + R[in.a].type().toString());
+                break;
+            }
+            case Op::CHECKSAME: {
+                Type expected = R[in.a].type();
+                if (!R[in.b].type().match(expected))
+                    throw std::runtime_error("Incompatible types for assignment; expected " +
+                                             expected.toString() + " but got " + R[in.b].type().toString() +
+                                             (in.c == NO_REG ? "" : " for field: " + proto.names[in.c]));
+                break;
+            }
+
+            case Op::NEWARRAY: {
+                auto arr = makeRef<Array>();
+                if (static_cast<Primitive>(in.b) != Primitive::NONE) arr->elementType = Type(static_cast<Primitive>(in.b));
+                R[in.a] = TypedValue(arr);
+                break;
+            }
+            case Op::APPEND: {
+                auto arr = R[in.a].get<PArray>();
+                const TypedValue &val = R[in.b];
+                if (!in.sx) {
+                    if (arr->elements.empty()) {
+                        arr->elementType = val.type();
+                    } else if (!val.type().match(arr->elementType)) {
+                        throw std::runtime_error("Array literal elements must have the same type: got " +
+                                                 val.type().toString() + " but expected " + arr->elementType.toString());
+                    }
+                }
+                arr->elements.push_back(val);
+                break;
+            }
+            case Op::APPENDRANGE: {
+                auto arr = R[in.a].get<PArray>();
+                if (!in.sx && !arr->elements.empty() && !arr->elementType.match(BaseType::Int))
+                    throw std::runtime_error("RANGE literal is only allowed for integer arrays");
+                int start = executor.getIntValue(R[in.b]);
+                int end = executor.getIntValue(R[in.c]);
+                for (int i = start; i <= end; ++i) arr->elements.push_back(TypedValue(i));
+                break;
+            }
+            case Op::NEWSIZED: {
+                int size = executor.getIntValue(R[in.b]);
+                TypedValue val = executor.primitiveValue(static_cast<Primitive>(in.c));
+                auto arr = makeRef<Array>();
+                arr->elementType = val.type();
+                arr->elements.assign(std::max(size, 0), val);
+                R[in.a] = TypedValue(arr);
+                break;
+            }
+            case Op::INDEX: {
+                auto arr = arrayOperand(R[in.b], "Attempted array access on non-array");
+                int idx = checkedIndex(arr, executor.getIntValue(R[in.c]));
+                R[in.a] = arr->elements[idx];
+                break;
+            }
+            case Op::INDEXN: {
+                auto arr = arrayOperand(R[in.b], "Attempted array access on non-array");
+                auto indices = indexList(executor, R[in.c]);
+                for (int idx : indices) checkedIndex(arr, idx);
+                R[in.a] = executor.arrayOperation(arr, indices);
+                break;
+            }
+            case Op::SETINDEX:
+            case Op::SETINDEXN: {
+                auto arr = arrayOperand(R[in.a], "Attempted array assignment on non-array");
+                std::vector<int> indices = in.op == Op::SETINDEX
+                    ? std::vector<int>{executor.getIntValue(R[in.b])}
+                    : indexList(executor, R[in.b]);
+                for (int idx : indices) checkedIndex(arr, idx);
+                executor.arrayOperation(arr, indices, R[in.c]);
+                break;
+            }
+            case Op::ITERCHECK:
+                if (R[in.a].kind() != BaseType::Array)
+                    throw std::runtime_error("Expected array for enhanced for loop");
+                break;
+            case Op::LEN: R[in.a] = TypedValue(static_cast<int>(R[in.b].get<PArray>()->elements.size())); break;
+
+            case Op::GETPROP: R[in.a] = executor.evaluateReadProperty(R[in.b], proto.symbols[in.c]); break;
+            case Op::GETFIELD: R[in.a] = structField(R[in.b], proto.symbols[in.c]); break;
+            case Op::SETFIELD: structField(R[in.a], proto.symbols[in.b]) = R[in.c]; break;
+
+            case Op::NEWSTRUCT: {
+                const StructInit &init = proto.structInits[in.c];
+                auto structType = env->getType(init.structSymbol);
+                if (!structType) throw std::runtime_error("Unknown struct type: " + init.structName);
+                if (init.argNames.size() != structType->fields.size())
+                    throw std::runtime_error("Struct assignment has incorrect number of arguments");
+
+                auto instance = makeRef<Struct>(init.structName, structType);
+                for (size_t i = 0; i < structType->fields.size(); ++i) {
+                    auto &field = structType->fields[i];
+                    const TypedValue &val = R[in.b + i];
+                    if (!val.type().match(field.second)) {
+                        throw std::runtime_error(init.argNames[i].empty()
+                            ? "Type mismatch for field at index " + std::to_string(i)
+                            : "Type mismatch for field: " + init.argNames[i]);
+                    }
+                    instance->fields.emplace_back(field.first, val);
+                }
+                R[in.a] = TypedValue(instance);
+                break;
+            }
+            case Op::DEFSTRUCT: env->setType(proto.structs[in.a]->name, proto.structs[in.a]); break;
+
+            case Op::CLOSURE: R[in.a] = TypedValue(makeClosure(proto.protos[in.b], env)); break;
+            case Op::NATIVE: {
+                const NativeDecl &native = proto.natives[in.b];
+                R[in.a] = TypedValue(executor.createNativeFunction(native.name, native.funcData, env));
+                break;
+            }
+            case Op::CALL: {
+                if (!R[in.b].is(BaseType::Function))
+                    throw std::runtime_error("Attempted to call a non-function value");
+                PFunction func = R[in.b].get<PFunction>();
+
+                TypedValue result;
+                if (func->closure) {
+                    result = invoke(*func->closure, base + in.b + 1, in.c);
+                } else {
+                    std::vector<std::shared_ptr<TypedValue>> args;
+                    args.reserve(in.c);
+                    for (uint16_t i = 1; i <= in.c; ++i) args.push_back(std::make_shared<TypedValue>(R[in.b + i]));
+                    result = *func->fn(args);
+                }
+                // the callee may have grown the stack
+                R = stack.data() + base;
+                R[in.a] = std::move(result);
+                break;
+            }
+            case Op::RET: {
+                TypedValue val = R[in.a];
+                checkReturn(val);
+                return val;
+            }
+            case Op::RETNIL:
+                checkReturn(TypedValue());
+                return TypedValue();
+
+            case Op::NDPUSH: {
+                auto result = R[in.a].get<PArray>();
+                const TypedValue &val = R[in.b];
+                if (val.is(BaseType::Array)) {
+                    auto &elements = val.get<PArray>()->elements;
+                    result->elements.push_back(elements.empty()
+                        ? TypedValue(0)
+                        : elements[R[in.c].get<int>() % elements.size()]);
+                } else {
+                    result->elements.push_back(val);
+                }
+                break;
+            }
+            case Op::NDSTEP: {
+                auto &indices = R[in.a].get<PArray>()->elements;
+                auto &shape = R[in.b].get<PArray>()->elements;
+                for (int d = static_cast<int>(shape.size()) - 1; d >= 0; --d) {
+                    int next = indices[d].get<int>() + 1;
+                    indices[d] = TypedValue(next);
+                    if (next < shape[d].get<int>()) break;
+                    indices[d] = TypedValue(0);
+                }
+                break;
+            }
+
+            case Op::ERROR: throw std::runtime_error(proto.constants[in.b].get<std::string>());
+        }
+    }
+}